@@ -1,4 +1,6 @@
-#ifndef DEF_SIPCALLHANDLERORDERS_H
-#define DEF_SIPCALLHANDLERORDERS_H
-
-#endif //DEF_SIPCALLHANDLERORDERS_H
+#ifndef DEF_SIPCALLHANDLERORDERS_H
+#define DEF_SIPCALLHANDLERORDERS_H
+
+#define SCHO_SIPPHONE_LOADBENCHMARK         100
+
+#endif //DEF_SIPCALLHANDLERORDERS_H
@@ -1,9 +1,56 @@
-#ifndef DEF_SIPPHONE_OPTIONVALUES_H
-#define DEF_SIPPHONE_OPTIONVALUES_H
-
-#define OPV_SIPPHONE_UPDPORT                            "sipphone.udp-port"
-#define OPV_SIPPHONE_TCPPORT                            "sipphone.tcp-port"
-#define OPV_SIPPHONE_STUNSERVER                         "sipphone.stun-server"
-#define OPV_SIPPHONE_ICEENABLED                         "sipphone.ice-enabled"
-
-#endif // DEF_SIPPHONE_OPTIONVALUES_H
+#ifndef DEF_SIPPHONE_OPTIONVALUES_H
+#define DEF_SIPPHONE_OPTIONVALUES_H
+
+#define OPV_SIPPHONE_UPDPORT                            "sipphone.udp-port"
+#define OPV_SIPPHONE_TCPPORT                            "sipphone.tcp-port"
+#define OPV_SIPPHONE_STUNSERVER                         "sipphone.stun-server"
+#define OPV_SIPPHONE_ICEENABLED                         "sipphone.ice-enabled"
+#define OPV_SIPPHONE_DTMFMETHOD                         "sipphone.dtmf-method"
+#define OPV_SIPPHONE_MAXCALLS                           "sipphone.max-calls"
+#define OPV_SIPPHONE_ADMISSION_ENABLED                  "sipphone.admission.enabled"
+#define OPV_SIPPHONE_ADMISSION_CPUBUDGET                "sipphone.admission.cpu-budget"
+#define OPV_SIPPHONE_ADMISSION_BANDWIDTHBUDGET          "sipphone.admission.bandwidth-budget"
+#define OPV_SIPPHONE_ADMISSION_AUDIOCPUCOST             "sipphone.admission.audio-cpu-cost"
+#define OPV_SIPPHONE_ADMISSION_VIDEOCPUCOST             "sipphone.admission.video-cpu-cost"
+#define OPV_SIPPHONE_ADMISSION_AUDIOBANDWIDTH           "sipphone.admission.audio-bandwidth"
+#define OPV_SIPPHONE_ADMISSION_REJECTCODE               "sipphone.admission.reject-code"
+#define OPV_SIPPHONE_ADMISSION_RETRYAFTER               "sipphone.admission.retry-after"
+#define OPV_SIPPHONE_SIPTHREADS                         "sipphone.sip-threads"
+#define OPV_SIPPHONE_MEDIA_THREADS                      "sipphone.media.threads"
+#define OPV_SIPPHONE_MEDIA_IOQUEUE                      "sipphone.media.ioqueue-enabled"
+#define OPV_SIPPHONE_MEDIA_CLOCKRATE                    "sipphone.media.clock-rate"
+#define OPV_SIPPHONE_AUDIO_DEVICEMODE                   "sipphone.audio.device-mode"
+#define OPV_SIPPHONE_AUDIO_LATENCYPROFILE               "sipphone.audio.latency-profile"
+#define OPV_SIPPHONE_AUDIO_AUTOCLOSETIME                "sipphone.audio.auto-close-time"
+#define OPV_SIPPHONE_AUDIO_BRIDGEBYPASS                 "sipphone.audio.bridge-bypass"
+#define OPV_SIPPHONE_AUDIO_PLAYFILE                     "sipphone.audio.play-file"
+#define OPV_SIPPHONE_AUDIO_RECORDFILE                   "sipphone.audio.record-file"
+#define OPV_SIPPHONE_AUDIO_EC_ALGORITHM                 "sipphone.audio.ec.algorithm"
+#define OPV_SIPPHONE_AUDIO_EC_TAILLENGTH                "sipphone.audio.ec.tail-length"
+#define OPV_SIPPHONE_AUDIO_EC_NOISESUPPRESSION          "sipphone.audio.ec.noise-suppression"
+#define OPV_SIPPHONE_AUDIO_EC_GAINCONTROL               "sipphone.audio.ec.gain-control"
+#define OPV_SIPPHONE_AUDIO_EC_AUTOFALLBACK              "sipphone.audio.ec.auto-fallback"
+#define OPV_SIPPHONE_AUDIO_CODECPRIORITY                "sipphone.audio.codec-priority"
+#define OPV_SIPPHONE_AUDIO_PTIME                        "sipphone.audio.ptime"
+#define OPV_SIPPHONE_AUDIO_VADENABLED                   "sipphone.audio.vad-enabled"
+#define OPV_SIPPHONE_AUDIO_FECENABLED                   "sipphone.audio.fec-enabled"
+#define OPV_SIPPHONE_AUDIO_OPUSCOMPLEXITY               "sipphone.audio.opus.complexity"
+#define OPV_SIPPHONE_AUDIO_OPUSBITRATE                  "sipphone.audio.opus.bitrate"
+#define OPV_SIPPHONE_AUDIO_CODEC_ITEM                   "sipphone.audio.codecs.codec"
+#define OPV_SIPPHONE_AUDIO_CODEC_PTIME                  "sipphone.audio.codecs.codec.ptime"
+#define OPV_SIPPHONE_AUDIO_CODEC_VAD                    "sipphone.audio.codecs.codec.vad"
+#define OPV_SIPPHONE_CONFERENCE_SILENCETHRESHOLD        "sipphone.conference.silence-threshold"
+#define OPV_SIPPHONE_VIDEO_CODECPRIORITY                "sipphone.video.codec-priority"
+#define OPV_SIPPHONE_VIDEO_PROFILE                      "sipphone.video.profile"
+#define OPV_SIPPHONE_VIDEO_AUTOCALLS                    "sipphone.video.auto-concurrent-calls"
+#define OPV_SIPPHONE_VIDEO_MAXWIDTH                     "sipphone.video.max-width"
+#define OPV_SIPPHONE_VIDEO_MAXHEIGHT                    "sipphone.video.max-height"
+#define OPV_SIPPHONE_VIDEO_MAXFPS                       "sipphone.video.max-fps"
+#define OPV_SIPPHONE_VIDEO_MAXBITRATE                   "sipphone.video.max-bitrate"
+#define OPV_SIPPHONE_EVENTTRACEFILE                     "sipphone.event-trace.record-file"
+#define OPV_SIPPHONE_EVENTREPLAYFILE                    "sipphone.event-trace.replay-file"
+#define OPV_SIPPHONE_EVENTREPLAYMAXSPEED                "sipphone.event-trace.replay-max-speed"
+#define OPV_SIPPHONE_LOADBENCHMARK_CALLS                "sipphone.load-benchmark.calls"
+#define OPV_SIPPHONE_LOADBENCHMARK_STEPTIME             "sipphone.load-benchmark.step-time"
+
+#endif // DEF_SIPPHONE_OPTIONVALUES_H
@@ -1,12 +1,12 @@
-#ifndef DEF_SIPPHONE_STATISTICSPARAMS_H
-#define DEF_SIPPHONE_STATISTICSPARAMS_H
-
-// Hit-Event
-#define SEVP_SIPPHONE_CALL_SUCCESS                           "sipphone|call-success|SIP Call Success"
-#define SEVP_SIPPHONE_CALL_FAILURE                           "sipphone|call-failure|SIP Call Failure"
-
-// Hit-Timing
-#define STMP_SIPPHONE_CALL_DURATION                          "sipphone|call-duration|SIP Call Duration"
-#define STMP_SIPPHONE_CALL_NEGOTIATION                       "sipphone|call-negotiation|SIP Call Negotiation"
-
-#endif // DEF_SIPPHONE_STATISTICSPARAMS_H
+#ifndef DEF_SIPPHONE_STATISTICSPARAMS_H
+#define DEF_SIPPHONE_STATISTICSPARAMS_H
+
+// Hit-Event
+#define SEVP_SIPPHONE_CALL_SUCCESS                           "sipphone|call-success|SIP Call Success"
+#define SEVP_SIPPHONE_CALL_FAILURE                           "sipphone|call-failure|SIP Call Failure"
+
+// Hit-Timing
+#define STMP_SIPPHONE_CALL_DURATION                          "sipphone|call-duration|SIP Call Duration"
+#define STMP_SIPPHONE_CALL_NEGOTIATION                       "sipphone|call-negotiation|SIP Call Negotiation"
+
+#endif // DEF_SIPPHONE_STATISTICSPARAMS_H
@@ -0,0 +1,126 @@
+#include "sipadmission.h"
+
+#include <utils/logger.h>
+
+QMutex SipAdmission::FMutex;
+SipAdmissionBudget SipAdmission::FBudget = { false, 0, 0, 0, 0, 0, 0, PJSIP_SC_SERVICE_UNAVAILABLE, 0 };
+quint32 SipAdmission::FCpuLoad = 0;
+quint32 SipAdmission::FBandwidthLoad = 0;
+quint32 SipAdmission::FCallCpu[PJSUA_MAX_CALLS] = { 0 };
+quint32 SipAdmission::FCallBandwidth[PJSUA_MAX_CALLS] = { 0 };
+
+void SipAdmission::setBudget(const SipAdmissionBudget &ABudget)
+{
+	QMutexLocker locker(&FMutex);
+	FBudget = ABudget;
+	LOG_INFO(QString("Call admission budget changed, enabled=%1, cpu=%2, bandwidth=%3kbps").arg(ABudget.enabled).arg(ABudget.cpuBudget).arg(ABudget.bandwidthBudget));
+}
+
+SipAdmission::Decision SipAdmission::admitCall(pjsua_call_id ACallIndex, bool AWithVideo)
+{
+	QMutexLocker locker(&FMutex);
+	if (ACallIndex<0 || ACallIndex>=PJSUA_MAX_CALLS)
+		return Reject;
+
+	// Stale reservation left by a call whose disconnect was not seen is dropped on slot reuse
+	setCallCost(ACallIndex,0,0);
+
+	quint32 audioCpu = FBudget.audioCpuCost;
+	quint32 audioBandwidth = FBudget.audioBandwidth;
+	quint32 videoCpu = audioCpu + FBudget.videoCpuCost;
+	quint32 videoBandwidth = audioBandwidth + FBudget.videoBandwidth;
+
+	bool audioFits = !FBudget.enabled || ((FBudget.cpuBudget==0 || FCpuLoad+audioCpu<=FBudget.cpuBudget) && (FBudget.bandwidthBudget==0 || FBandwidthLoad+audioBandwidth<=FBudget.bandwidthBudget));
+	bool videoFits = !FBudget.enabled || ((FBudget.cpuBudget==0 || FCpuLoad+videoCpu<=FBudget.cpuBudget) && (FBudget.bandwidthBudget==0 || FBandwidthLoad+videoBandwidth<=FBudget.bandwidthBudget));
+
+	if (AWithVideo && videoFits)
+	{
+		setCallCost(ACallIndex,videoCpu,videoBandwidth);
+		return Accept;
+	}
+	else if (audioFits)
+	{
+		setCallCost(ACallIndex,audioCpu,audioBandwidth);
+		return AWithVideo ? AudioOnly : Accept;
+	}
+	return Reject;
+}
+
+void SipAdmission::reserveCall(pjsua_call_id ACallIndex, bool AWithVideo)
+{
+	QMutexLocker locker(&FMutex);
+	if (ACallIndex>=0 && ACallIndex<PJSUA_MAX_CALLS)
+	{
+		if (AWithVideo)
+			setCallCost(ACallIndex,FBudget.audioCpuCost+FBudget.videoCpuCost,FBudget.audioBandwidth+FBudget.videoBandwidth);
+		else
+			setCallCost(ACallIndex,FBudget.audioCpuCost,FBudget.audioBandwidth);
+	}
+}
+
+bool SipAdmission::isReserved(pjsua_call_id ACallIndex)
+{
+	QMutexLocker locker(&FMutex);
+	return ACallIndex>=0 && ACallIndex<PJSUA_MAX_CALLS && (FCallCpu[ACallIndex]>0 || FCallBandwidth[ACallIndex]>0);
+}
+
+void SipAdmission::releaseCall(pjsua_call_id ACallIndex)
+{
+	QMutexLocker locker(&FMutex);
+	if (ACallIndex>=0 && ACallIndex<PJSUA_MAX_CALLS)
+		setCallCost(ACallIndex,0,0);
+}
+
+void SipAdmission::rejectCall(pjsua_call_id ACallIndex)
+{
+	FMutex.lock();
+	quint16 code = FBudget.rejectCode;
+	quint32 retryAfter = FBudget.retryAfter;
+	FMutex.unlock();
+
+	pjsua_msg_data msgData;
+	pjsua_msg_data_init(&msgData);
+
+	char value[16];
+	pj_str_t hname = pj_str((char *)"Retry-After");
+	pj_str_t hvalue = pj_str(value);
+	hvalue.slen = pj_ansi_snprintf(value,sizeof(value),"%u",retryAfter);
+
+	pjsip_generic_string_hdr retryHdr;
+	if (retryAfter > 0)
+	{
+		pjsip_generic_string_hdr_init2(&retryHdr,&hname,&hvalue);
+		pj_list_push_back(&msgData.hdr_list,&retryHdr);
+	}
+
+	pjsua_call_hangup(ACallIndex,code,NULL,&msgData);
+}
+
+void SipAdmission::reset()
+{
+	QMutexLocker locker(&FMutex);
+	FCpuLoad = 0;
+	FBandwidthLoad = 0;
+	memset(FCallCpu,0,sizeof(FCallCpu));
+	memset(FCallBandwidth,0,sizeof(FCallBandwidth));
+}
+
+quint32 SipAdmission::cpuLoad()
+{
+	QMutexLocker locker(&FMutex);
+	return FCpuLoad;
+}
+
+quint32 SipAdmission::bandwidthLoad()
+{
+	QMutexLocker locker(&FMutex);
+	return FBandwidthLoad;
+}
+
+void SipAdmission::setCallCost(pjsua_call_id ACallIndex, quint32 ACpu, quint32 ABandwidth)
+{
+	FCpuLoad = FCpuLoad - FCallCpu[ACallIndex] + ACpu;
+	FBandwidthLoad = FBandwidthLoad - FCallBandwidth[ACallIndex] + ABandwidth;
+	FCallCpu[ACallIndex] = ACpu;
+	FCallBandwidth[ACallIndex] = ABandwidth;
+}
@@ -0,0 +1,49 @@
+#ifndef SIPADMISSION_H
+#define SIPADMISSION_H
+
+#include <QMutex>
+#include <pjsua.h>
+
+struct SipAdmissionBudget
+{
+	bool enabled;
+	quint32 cpuBudget;
+	quint32 bandwidthBudget;
+	quint32 audioCpuCost;
+	quint32 videoCpuCost;
+	quint32 audioBandwidth;
+	quint32 videoBandwidth;
+	quint16 rejectCode;
+	quint32 retryAfter;
+};
+
+class SipAdmission
+{
+public:
+	enum Decision {
+		Accept,
+		AudioOnly,
+		Reject
+	};
+public:
+	static void setBudget(const SipAdmissionBudget &ABudget);
+	static Decision admitCall(pjsua_call_id ACallIndex, bool AWithVideo);
+	static void reserveCall(pjsua_call_id ACallIndex, bool AWithVideo);
+	static bool isReserved(pjsua_call_id ACallIndex);
+	static void releaseCall(pjsua_call_id ACallIndex);
+	static void rejectCall(pjsua_call_id ACallIndex);
+	static void reset();
+	static quint32 cpuLoad();
+	static quint32 bandwidthLoad();
+protected:
+	static void setCallCost(pjsua_call_id ACallIndex, quint32 ACpu, quint32 ABandwidth);
+private:
+	static QMutex FMutex;
+	static SipAdmissionBudget FBudget;
+	static quint32 FCpuLoad;
+	static quint32 FBandwidthLoad;
+	static quint32 FCallCpu[PJSUA_MAX_CALLS];
+	static quint32 FCallBandwidth[PJSUA_MAX_CALLS];
+};
+
+#endif // SIPADMISSION_H
@@ -0,0 +1,239 @@
+#include "sipaudiodevice.h"
+
+#include <QtEndian>
+#include <utils/logger.h>
+#include "sipbridgebypass.h"
+
+#define FILE_PORT_PTIME          20
+#define WAV_FORMAT_PCM           1
+
+SipAudioDevice::Mode SipAudioDevice::FMode = SipAudioDevice::Sound;
+pj_pool_t *SipAudioDevice::FPool = NULL;
+pjmedia_port *SipAudioDevice::FNullPort = NULL;
+pjmedia_master_port *SipAudioDevice::FMasterPort = NULL;
+QFile SipAudioDevice::FPlayFile;
+pjmedia_port *SipAudioDevice::FPlayPort = NULL;
+pjsua_conf_port_id SipAudioDevice::FPlaySlot = PJSUA_INVALID_ID;
+pjmedia_port *SipAudioDevice::FWritePort = NULL;
+pjsua_conf_port_id SipAudioDevice::FWriteSlot = PJSUA_INVALID_ID;
+
+SipAudioDevice::Mode SipAudioDevice::modeByName(const QString &AName)
+{
+	if (AName == "null")
+		return Null;
+	else if (AName == "none")
+		return None;
+	return Sound;
+}
+
+bool SipAudioDevice::open(Mode AMode, const QString &APlayFile, const QString &ARecordFile)
+{
+	bool wasHeadless = isHeadless();
+	close();
+
+	FPool = pjsua_pool_create("audiodev-pool",1024,1024);
+	if (FPool == NULL)
+	{
+		LOG_ERROR("Failed to open SIP audio device: Not enough memory");
+		return false;
+	}
+
+	bool ok = true;
+	if (AMode == Sound)
+	{
+		if (wasHeadless)
+			pjsua_set_snd_dev(PJMEDIA_AUD_DEFAULT_CAPTURE_DEV,PJMEDIA_AUD_DEFAULT_PLAYBACK_DEV);
+	}
+	else if (AMode == Null)
+	{
+		pj_status_t status = pjsua_set_null_snd_dev();
+		if (status != PJ_SUCCESS)
+		{
+			LOG_ERROR(QString("Failed to set null sound device: %1").arg(resolveSipError(status)));
+			ok = false;
+		}
+	}
+	else if (AMode == None)
+	{
+		ok = createMasterClock();
+	}
+	FMode = ok ? AMode : Sound;
+
+	if (ok && !APlayFile.isEmpty())
+		ok = createFilePlayer(APlayFile);
+	if (ok && !ARecordFile.isEmpty())
+		ok = createFileWriter(ARecordFile);
+
+	if (ok)
+		LOG_INFO(QString("SIP audio device opened, mode=%1, play='%2', record='%3'").arg(FMode).arg(APlayFile,ARecordFile));
+
+	return ok;
+}
+
+void SipAudioDevice::close()
+{
+	if (FPlaySlot != PJSUA_INVALID_ID)
+		pjsua_conf_remove_port(FPlaySlot);
+	if (FPlayPort != NULL)
+		pjmedia_port_destroy(FPlayPort);
+	if (FPlayFile.isOpen())
+		FPlayFile.close();
+	FPlaySlot = PJSUA_INVALID_ID;
+	FPlayPort = NULL;
+
+	if (FWriteSlot != PJSUA_INVALID_ID)
+		pjsua_conf_remove_port(FWriteSlot);
+	if (FWritePort != NULL)
+		pjmedia_port_destroy(FWritePort);
+	FWriteSlot = PJSUA_INVALID_ID;
+	FWritePort = NULL;
+
+	if (FMasterPort != NULL)
+		pjmedia_master_port_destroy(FMasterPort,PJ_FALSE);
+	if (FNullPort != NULL)
+		pjmedia_port_destroy(FNullPort);
+	FMasterPort = NULL;
+	FNullPort = NULL;
+	FMode = Sound;
+
+	if (FPool != NULL)
+		pj_pool_release(FPool);
+	FPool = NULL;
+}
+
+bool SipAudioDevice::isHeadless()
+{
+	return FMode != Sound;
+}
+
+// Opening sound device blocks, so it is called from SipWorker thread only
+pj_status_t SipAudioDevice::wakeup()
+{
+	pj_status_t status = PJ_SUCCESS;
+
+	// Bypassed bridge has no sound device attached while bypass holds it,
+	// both are changed in SipWorker thread only
+	if (FMode==Sound && pjsua_get_state()==PJSUA_STATE_RUNNING && !pjsua_snd_is_active() && !SipBridgeBypass::isActive())
+	{
+		int captureDev, playbackDev;
+		status = pjsua_get_snd_dev(&captureDev,&playbackDev);
+		if (status == PJ_SUCCESS)
+			status = pjsua_set_snd_dev(captureDev,playbackDev);
+	}
+
+	return status;
+}
+
+pjsua_conf_port_id SipAudioDevice::captureSlot()
+{
+	return FPlaySlot!=PJSUA_INVALID_ID ? FPlaySlot : 0;
+}
+
+pjsua_conf_port_id SipAudioDevice::playbackSlot()
+{
+	return FWriteSlot!=PJSUA_INVALID_ID ? FWriteSlot : 0;
+}
+
+bool SipAudioDevice::createMasterClock()
+{
+	// Without sound device conference bridge must be clocked by application
+	pjmedia_port *conf = pjsua_set_no_snd_dev();
+	pj_status_t status = conf!=NULL ? PJ_SUCCESS : PJ_EINVALIDOP;
+	if (status == PJ_SUCCESS)
+		status = pjmedia_null_port_create(FPool,PJMEDIA_PIA_SRATE(&conf->info),PJMEDIA_PIA_CCNT(&conf->info),PJMEDIA_PIA_SPF(&conf->info),PJMEDIA_PIA_BITS(&conf->info),&FNullPort);
+	if (status == PJ_SUCCESS)
+		status = pjmedia_master_port_create(FPool,FNullPort,conf,0,&FMasterPort);
+	if (status == PJ_SUCCESS)
+		status = pjmedia_master_port_start(FMasterPort);
+	if (status != PJ_SUCCESS)
+		LOG_ERROR(QString("Failed to create conference master clock: %1").arg(resolveSipError(status)));
+	return status == PJ_SUCCESS;
+}
+
+bool SipAudioDevice::createFilePlayer(const QString &AFileName)
+{
+	FPlayFile.setFileName(AFileName);
+	if (!FPlayFile.open(QIODevice::ReadOnly))
+	{
+		LOG_ERROR(QString("Failed to open audio play file=%1: %2").arg(AFileName,FPlayFile.errorString()));
+		return false;
+	}
+
+	// File is mapped to memory to avoid file I/O in conference clock thread
+	qint64 fileSize = FPlayFile.size();
+	uchar *data = FPlayFile.map(0,fileSize);
+	if (data==NULL || fileSize<12 || memcmp(data,"RIFF",4)!=0 || memcmp(data+8,"WAVE",4)!=0)
+	{
+		LOG_ERROR(QString("Failed to open audio play file=%1: Not a WAV file").arg(AFileName));
+		return false;
+	}
+
+	quint16 format = 0, channels = 0, bits = 0;
+	quint32 clockRate = 0;
+	uchar *samples = NULL;
+	quint32 samplesSize = 0;
+	for (qint64 offset=12; offset+8<=fileSize && samples==NULL; )
+	{
+		quint32 chunkSize = qFromLittleEndian<quint32>(data+offset+4);
+		if (memcmp(data+offset,"fmt ",4)==0 && chunkSize>=16 && offset+8+16<=fileSize)
+		{
+			format = qFromLittleEndian<quint16>(data+offset+8);
+			channels = qFromLittleEndian<quint16>(data+offset+10);
+			clockRate = qFromLittleEndian<quint32>(data+offset+12);
+			bits = qFromLittleEndian<quint16>(data+offset+22);
+		}
+		else if (memcmp(data+offset,"data",4) == 0)
+		{
+			samples = data+offset+8;
+			samplesSize = (quint32)qMin<qint64>(chunkSize,fileSize-offset-8);
+		}
+		offset += 8 + chunkSize + (chunkSize & 1);
+	}
+
+	if (format!=WAV_FORMAT_PCM || bits!=16 || channels==0 || clockRate==0 || samples==NULL)
+	{
+		LOG_ERROR(QString("Failed to open audio play file=%1: Only 16 bit PCM WAV files are supported").arg(AFileName));
+		return false;
+	}
+
+	unsigned samplesPerFrame = clockRate*channels*FILE_PORT_PTIME/1000;
+	pj_status_t status = pjmedia_mem_player_create(FPool,samples,samplesSize,clockRate,channels,samplesPerFrame,bits,0,&FPlayPort);
+	if (status == PJ_SUCCESS)
+		status = pjsua_conf_add_port(FPool,FPlayPort,&FPlaySlot);
+	if (status != PJ_SUCCESS)
+	{
+		LOG_ERROR(QString("Failed to create audio file player, file=%1: %2").arg(AFileName).arg(resolveSipError(status)));
+		return false;
+	}
+
+	LOG_DEBUG(QString("Audio file player created, file=%1, rate=%2, channels=%3, slot=%4").arg(AFileName).arg(clockRate).arg(channels).arg(FPlaySlot));
+	return true;
+}
+
+bool SipAudioDevice::createFileWriter(const QString &AFileName)
+{
+	pjsua_conf_port_info pi;
+	pj_status_t status = pjsua_conf_get_port_info(0,&pi);
+	if (status == PJ_SUCCESS)
+	{
+		QByteArray fileName = AFileName.toLocal8Bit();
+		status = pjmedia_wav_writer_port_create(FPool,fileName.constData(),pi.clock_rate,pi.channel_count,pi.samples_per_frame,pi.bits_per_sample,0,0,&FWritePort);
+	}
+	if (status == PJ_SUCCESS)
+		status = pjsua_conf_add_port(FPool,FWritePort,&FWriteSlot);
+	if (status != PJ_SUCCESS)
+	{
+		LOG_ERROR(QString("Failed to create audio file writer, file=%1: %2").arg(AFileName).arg(resolveSipError(status)));
+		return false;
+	}
+
+	LOG_DEBUG(QString("Audio file writer created, file=%1, rate=%2, slot=%3").arg(AFileName).arg(pi.clock_rate).arg(FWriteSlot));
+	return true;
+}
+
+QString SipAudioDevice::resolveSipError(int ACode)
+{
+	char errmsg[PJ_ERR_MSG_SIZE];
+	pj_strerror(ACode, errmsg, sizeof(errmsg));
+	return QString(errmsg);
+}
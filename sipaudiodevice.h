@@ -0,0 +1,40 @@
+#ifndef SIPAUDIODEVICE_H
+#define SIPAUDIODEVICE_H
+
+#include <QFile>
+#include <pjsua.h>
+
+class SipAudioDevice
+{
+public:
+	enum Mode {
+		Sound,
+		Null,
+		None
+	};
+public:
+	static Mode modeByName(const QString &AName);
+	static bool open(Mode AMode, const QString &APlayFile, const QString &ARecordFile);
+	static void close();
+	static bool isHeadless();
+	static pj_status_t wakeup();
+	static pjsua_conf_port_id captureSlot();
+	static pjsua_conf_port_id playbackSlot();
+protected:
+	static bool createMasterClock();
+	static bool createFilePlayer(const QString &AFileName);
+	static bool createFileWriter(const QString &AFileName);
+	static QString resolveSipError(int ACode);
+private:
+	static Mode FMode;
+	static pj_pool_t *FPool;
+	static pjmedia_port *FNullPort;
+	static pjmedia_master_port *FMasterPort;
+	static QFile FPlayFile;
+	static pjmedia_port *FPlayPort;
+	static pjsua_conf_port_id FPlaySlot;
+	static pjmedia_port *FWritePort;
+	static pjsua_conf_port_id FWriteSlot;
+};
+
+#endif // SIPAUDIODEVICE_H
@@ -0,0 +1,249 @@
+#include "sipbridgebypass.h"
+
+#include <utils/logger.h>
+#include "sipworker.h"
+
+QMutex SipBridgeBypass::FMutex;
+SipWorker *SipBridgeBypass::FWorker = NULL;
+QMap<pjsua_call_id, SipBypassStream> SipBridgeBypass::FStreams;
+pjsua_call_id SipBridgeBypass::FRequestedCall = PJSUA_INVALID_ID;
+unsigned SipBridgeBypass::FEcOptions = 0;
+
+pj_pool_t *SipBridgeBypass::FPool = NULL;
+pjmedia_snd_port *SipBridgeBypass::FSndPort = NULL;
+pjmedia_port *SipBridgeBypass::FStreamPort = NULL;
+pjsua_call_id SipBridgeBypass::FCallIndex = PJSUA_INVALID_ID;
+int SipBridgeBypass::FCaptureDev = PJMEDIA_AUD_DEFAULT_CAPTURE_DEV;
+int SipBridgeBypass::FPlaybackDev = PJMEDIA_AUD_DEFAULT_PLAYBACK_DEV;
+
+void SipBridgeBypass::setWorker(SipWorker *AWorker)
+{
+	QMutexLocker locker(&FMutex);
+	FWorker = AWorker;
+}
+
+bool SipBridgeBypass::isActive()
+{
+	QMutexLocker locker(&FMutex);
+	return FSndPort != NULL;
+}
+
+pjsua_call_id SipBridgeBypass::requestedCall()
+{
+	QMutexLocker locker(&FMutex);
+	return FRequestedCall;
+}
+
+// Sound device is opened and closed by SipWorker, request is kept until leave even if bypass failed
+void SipBridgeBypass::enter(pjsua_call_id ACallIndex, unsigned AEcOptions)
+{
+	FMutex.lock();
+	bool changed = FRequestedCall!=ACallIndex || FEcOptions!=AEcOptions;
+	FRequestedCall = ACallIndex;
+	FEcOptions = AEcOptions;
+	FMutex.unlock();
+
+	if (changed)
+		requestUpdate();
+}
+
+void SipBridgeBypass::leave(pjsua_call_id ACallIndex)
+{
+	FMutex.lock();
+	bool changed = FRequestedCall!=PJSUA_INVALID_ID && (ACallIndex==PJSUA_INVALID_ID || ACallIndex==FRequestedCall);
+	if (changed)
+		FRequestedCall = PJSUA_INVALID_ID;
+	FMutex.unlock();
+
+	if (changed)
+		requestUpdate();
+}
+
+// Called from pjsua thread before stream port is added to conference bridge
+void SipBridgeBypass::streamCreated(pjsua_call_id ACallIndex, unsigned AStreamIndex, pjmedia_port *APort)
+{
+	FMutex.lock();
+	bool changed = false;
+	QMap<pjsua_call_id,SipBypassStream>::iterator it = FStreams.find(ACallIndex);
+	if (APort!=NULL && (it==FStreams.end() || it->index>=AStreamIndex))
+	{
+		SipBypassStream stream;
+		stream.index = AStreamIndex;
+		stream.port = APort;
+		stream.info = APort->info;
+		FStreams.insert(ACallIndex,stream);
+		changed = FRequestedCall==ACallIndex;
+	}
+	FMutex.unlock();
+
+	if (changed)
+		requestUpdate();
+}
+
+// Called from pjsua thread with call locked, so only stream port is detached here
+void SipBridgeBypass::streamDestroyed(pjsua_call_id ACallIndex, unsigned AStreamIndex)
+{
+	FMutex.lock();
+	bool detached = false;
+	QMap<pjsua_call_id,SipBypassStream>::iterator it = FStreams.find(ACallIndex);
+	if (it!=FStreams.end() && it->index==AStreamIndex)
+	{
+		if (FSndPort!=NULL && FStreamPort==it->port)
+		{
+			pjmedia_snd_port_disconnect(FSndPort);
+			FStreamPort = NULL;
+			detached = true;
+		}
+		FStreams.erase(it);
+	}
+	FMutex.unlock();
+
+	if (detached)
+		requestUpdate();
+}
+
+// Brings sound device in line with requested call, runs in SipWorker thread only
+pj_status_t SipBridgeBypass::update()
+{
+	FMutex.lock();
+	pjsua_call_id callIndex = FRequestedCall;
+	unsigned ecOptions = FEcOptions;
+	bool active = FSndPort != NULL;
+	bool current = active && FStreamPort!=NULL && FCallIndex==callIndex;
+	SipBypassStream stream = FStreams.value(callIndex);
+	bool found = FStreams.contains(callIndex);
+	FMutex.unlock();
+
+	pj_status_t status = PJ_SUCCESS;
+	if (!current)
+	{
+		if (active)
+			status = stop();
+
+		// Stream is not created yet or is being recreated, bypass is started when it appears
+		if (callIndex!=PJSUA_INVALID_ID && found)
+			status = start(callIndex,stream,ecOptions);
+	}
+	return status;
+}
+
+pj_status_t SipBridgeBypass::start(pjsua_call_id ACallIndex, const SipBypassStream &AStream, unsigned AEcOptions)
+{
+	int captureDev, playbackDev;
+	pj_status_t status = pjsua_get_snd_dev(&captureDev,&playbackDev);
+
+	unsigned tailLen = 0;
+	if (status == PJ_SUCCESS)
+		status = pjsua_get_ec_tail(&tailLen);
+
+	pj_pool_t *pool = NULL;
+	if (status == PJ_SUCCESS)
+	{
+		pool = pjsua_pool_create("bypass-pool",512,512);
+		status = pool!=NULL ? PJ_SUCCESS : PJ_ENOMEM;
+	}
+
+	pjmedia_snd_port *sndPort = NULL;
+	if (status == PJ_SUCCESS)
+	{
+		// Bridge is not clocked without sound device, so stream port is driven by bypass sound port only
+		pjsua_set_no_snd_dev();
+
+		status = pjmedia_snd_port_create(pool,captureDev,playbackDev,PJMEDIA_PIA_SRATE(&AStream.info),PJMEDIA_PIA_CCNT(&AStream.info),PJMEDIA_PIA_SPF(&AStream.info),PJMEDIA_PIA_BITS(&AStream.info),0,&sndPort);
+		if (status==PJ_SUCCESS && tailLen>0)
+			pjmedia_snd_port_set_ec(sndPort,pool,tailLen,AEcOptions);
+
+		if (status == PJ_SUCCESS)
+		{
+			// Stream could be destroyed by pjsua while sound device was opening
+			FMutex.lock();
+			QMap<pjsua_call_id,SipBypassStream>::const_iterator it = FStreams.constFind(ACallIndex);
+			if (it!=FStreams.constEnd() && it->port==AStream.port)
+				status = pjmedia_snd_port_connect(sndPort,AStream.port);
+			else
+				status = PJ_ENOTFOUND;
+
+			if (status == PJ_SUCCESS)
+			{
+				FPool = pool;
+				FSndPort = sndPort;
+				FStreamPort = AStream.port;
+				FCallIndex = ACallIndex;
+				FCaptureDev = captureDev;
+				FPlaybackDev = playbackDev;
+			}
+			FMutex.unlock();
+		}
+
+		if (status != PJ_SUCCESS)
+		{
+			if (sndPort != NULL)
+				pjmedia_snd_port_destroy(sndPort);
+
+			pj_status_t reopen = pjsua_set_snd_dev(captureDev,playbackDev);
+			if (reopen != PJ_SUCCESS)
+				LOG_ERROR(QString("Failed to reopen sound device after conference bridge bypass, capture=%1, playback=%2: %3").arg(captureDev).arg(playbackDev).arg(resolveSipError(reopen)));
+		}
+	}
+
+	if (status == PJ_SUCCESS)
+	{
+		LOG_INFO(QString("Conference bridge bypass started, call=%1, stream=%2, rate=%3").arg(ACallIndex).arg(AStream.index).arg(PJMEDIA_PIA_SRATE(&AStream.info)));
+	}
+	else
+	{
+		if (pool != NULL)
+			pj_pool_release(pool);
+		LOG_WARNING(QString("Failed to start conference bridge bypass, call=%1: %2").arg(ACallIndex).arg(resolveSipError(status)));
+	}
+
+	return status;
+}
+
+pj_status_t SipBridgeBypass::stop()
+{
+	// Stream port is detached under lock, so pjsua can not destroy it while it is still clocked
+	FMutex.lock();
+	pj_pool_t *pool = FPool;
+	pjmedia_snd_port *sndPort = FSndPort;
+	pjsua_call_id callIndex = FCallIndex;
+	if (sndPort != NULL)
+		pjmedia_snd_port_disconnect(sndPort);
+	FPool = NULL;
+	FSndPort = NULL;
+	FStreamPort = NULL;
+	FCallIndex = PJSUA_INVALID_ID;
+	FMutex.unlock();
+
+	pj_status_t status = PJ_SUCCESS;
+	if (sndPort != NULL)
+	{
+		pjmedia_snd_port_destroy(sndPort);
+		pj_pool_release(pool);
+
+		status = pjsua_set_snd_dev(FCaptureDev,FPlaybackDev);
+		if (status == PJ_SUCCESS)
+			LOG_INFO(QString("Conference bridge bypass stopped, call=%1").arg(callIndex));
+		else
+			LOG_ERROR(QString("Failed to reopen sound device after conference bridge bypass, capture=%1, playback=%2: %3").arg(FCaptureDev).arg(FPlaybackDev).arg(resolveSipError(status)));
+	}
+	return status;
+}
+
+void SipBridgeBypass::requestUpdate()
+{
+	QMutexLocker locker(&FMutex);
+	if (FWorker != NULL)
+	{
+		SipTaskBridgeBypass *task = new SipTaskBridgeBypass;
+		if (!FWorker->startTask(task))
+			delete task;
+	}
+}
+
+QString SipBridgeBypass::resolveSipError(int ACode)
+{
+	char errmsg[PJ_ERR_MSG_SIZE];
+	pj_strerror(ACode, errmsg, sizeof(errmsg));
+	return QString(errmsg);
+}
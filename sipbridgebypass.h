@@ -0,0 +1,49 @@
+#ifndef SIPBRIDGEBYPASS_H
+#define SIPBRIDGEBYPASS_H
+
+#include <QMap>
+#include <QMutex>
+#include <pjsua.h>
+
+class SipWorker;
+
+struct SipBypassStream
+{
+	unsigned index;
+	pjmedia_port *port;
+	pjmedia_port_info info;
+};
+
+class SipBridgeBypass
+{
+	friend class SipTaskBridgeBypass;
+public:
+	static void setWorker(SipWorker *AWorker);
+	static bool isActive();
+	static pjsua_call_id requestedCall();
+	static void enter(pjsua_call_id ACallIndex, unsigned AEcOptions);
+	static void leave(pjsua_call_id ACallIndex = PJSUA_INVALID_ID);
+	static void streamCreated(pjsua_call_id ACallIndex, unsigned AStreamIndex, pjmedia_port *APort);
+	static void streamDestroyed(pjsua_call_id ACallIndex, unsigned AStreamIndex);
+protected:
+	static pj_status_t update();
+	static pj_status_t start(pjsua_call_id ACallIndex, const SipBypassStream &AStream, unsigned AEcOptions);
+	static pj_status_t stop();
+	static void requestUpdate();
+	static QString resolveSipError(int ACode);
+private:
+	static QMutex FMutex;
+	static SipWorker *FWorker;
+	static QMap<pjsua_call_id, SipBypassStream> FStreams;
+	static pjsua_call_id FRequestedCall;
+	static unsigned FEcOptions;
+private:
+	static pj_pool_t *FPool;
+	static pjmedia_snd_port *FSndPort;
+	static pjmedia_port *FStreamPort;
+	static pjsua_call_id FCallIndex;
+	static int FCaptureDev;
+	static int FPlaybackDev;
+};
+
+#endif // SIPBRIDGEBYPASS_H
@@ -1,944 +1,1552 @@
-#include "sipcall.h"
-
-#include <QTimer>
-#include <QMetaType>
-#include <QDateTime>
-#include <definitions/sipphone/statisticsparams.h>
-#include <utils/logger.h>
-
-#define CLOSE_MEDIA_DELAY  3000
-
-SipCall::SipCall(const QUuid &AAccountId, pjsua_acc_id AAccIndex, const QString &ARemoteUri, QObject *AParent) : QObject(AParent)
-{
-	FAccIndex = AAccIndex;
-	FCallIndex = PJSUA_INVALID_ID;
-	FAccountId = AAccountId;
-	FRemoteUri = ARemoteUri;
-
-	FRole = ISipCall::Caller;
-	FState = ISipCall::Inited;
-	FStatusCode = ISipCall::SC_Undefined;
-
-	initialize();
-}
-
-SipCall::SipCall(const QUuid &AAccountId, pjsua_acc_id AAccIndex, pjsua_call_id ACallIndex, QObject *AParent) : QObject(AParent)
-{
-	FAccIndex = AAccIndex;
-	FCallIndex = ACallIndex;
-	FAccountId = AAccountId;
-
-	pjsua_call_info ci;
-	pjsua_call_get_info(FCallIndex,&ci);
-	FRemoteUri = QString::fromLocal8Bit(ci.remote_info.ptr,ci.remote_info.slen);
-
-	FRole = ISipCall::Receiver;
-	FState = ISipCall::Inited;
-	FStatusCode = ci.last_status;
-
-	initialize();
-	printCallDump(true);
-	setState(ISipCall::Ringing);
-}
-
-SipCall::~SipCall()
-{
-	destroyCall();
-
-	foreach(VideoWindow *widget, FVideoPlaybackWidgets.values())
-		delete widget;
-
-	pjsua_conf_remove_port(FTonegenSlot);
-	pjmedia_port_destroy(FTonegenPort);
-	pj_pool_release(FTonegenPool);
-
-	emit callDestroyed();
-}
-
-QUuid SipCall::accountId() const
-{
-	return FAccountId;
-}
-
-QString SipCall::remoteUri() const
-{
-	return FRemoteUri;
-}
-
-bool SipCall::isActive() const
-{
-	return FCallIndex>PJSUA_INVALID_ID ? pjsua_call_is_active(FCallIndex) : false;
-}
-
-ISipCall::Role SipCall::role() const
-{
-	return FRole;
-}
-
-ISipCall::State SipCall::state() const
-{
-	return FState;
-}
-
-quint32 SipCall::statusCode() const
-{
-	return FStatusCode;
-}
-
-QString SipCall::statusText() const
-{
-	return FStatusText;
-}
-
-quint32 SipCall::durationTime() const
-{
-	pjsua_call_info ci;
-	if (FCallIndex>PJSUA_INVALID_ID && pjsua_call_get_info(FCallIndex,&ci)==PJ_SUCCESS)
-		return ci.connect_duration.sec*1000 + ci.connect_duration.msec;
-	return FTotalDurationTime;
-}
-
-bool SipCall::sendDtmf(const char *ADigits)
-{
-	if (FCallIndex > PJSUA_INVALID_ID)
-	{
-		pjmedia_tone_digit digits[16];
-		pj_bzero(digits, sizeof(digits));
-
-		int count = qMin(strlen(ADigits),PJ_ARRAY_SIZE(digits));
-		for (int i=0; i<count; i++) 
-		{
-			digits[i].digit = ADigits[i];
-			digits[i].on_msec = 120;
-			digits[i].off_msec = 50;
-			digits[i].volume = 0;
-		}
-
-		pj_status_t status = pjmedia_tonegen_play_digits(FTonegenPort,count,digits,0);
-		if (status == PJ_SUCCESS)
-		{
-			LOG_DEBUG(QString("DTMF digits sent '%1', call=%2, uri=%3").arg(ADigits).arg(FCallIndex).arg(FRemoteUri));
-			emit dtmfSent(ADigits);
-			return true;
-		}
-		else
-		{
-			LOG_ERROR(QString("Failed to send DTMF digits '%1', call=%2, uri=%3: %4").arg(ADigits).arg(FCallIndex).arg(FRemoteUri).arg(resolveSipError(status)));
-		}
-	}
-	else
-	{
-		LOG_ERROR(QString("Failed to send DTMF digits '%1', call=%2, uri=%3: Call is not active").arg(ADigits).arg(FCallIndex).arg(FRemoteUri));
-	}
-
-	return false;
-}
-
-bool SipCall::startCall(bool AWithVideo)
-{
-	if (FRole==Caller && FState==Inited)
-	{
-		pjsua_call_setting cs;
-		pjsua_call_setting_default(&cs);
-		cs.vid_cnt = AWithVideo ? 1 : 0;
-
-		QByteArray uri8bit = FRemoteUri.toLocal8Bit();
-		pj_str_t uri = pj_str(uri8bit.data());
-		pj_status_t status = pjsua_call_make_call(FAccIndex,&uri,&cs,NULL,NULL,&FCallIndex);
-		if (status == PJ_SUCCESS)
-		{
-			LOG_INFO(QString("Making outgoing SIP call, call=%1, uri=%2, video=%3").arg(FCallIndex).arg(FRemoteUri).arg(AWithVideo));
-			return true;
-		}
-		else
-		{
-			LOG_ERROR(QString("Failed to make outgoing SIP call, call=%1, uri=%2, video=%3: %4").arg(FCallIndex).arg(FRemoteUri).arg(AWithVideo).arg(resolveSipError(status)));
-			setError(status);
-		}
-	}
-	else if (FRole==Receiver && FState==Ringing)
-	{
-		pjsua_call_setting cs;
-		pjsua_call_setting_default(&cs);
-		cs.vid_cnt = AWithVideo ? 1 : 0;
-
-		pj_status_t status = pjsua_call_answer2(FCallIndex,&cs,PJSIP_SC_OK,NULL,NULL);
-		if (status == PJ_SUCCESS)
-		{
-			LOG_INFO(QString("Accepting incoming SIP call, call=%1, uri=%2, video=%3").arg(FCallIndex).arg(FRemoteUri).arg(AWithVideo));
-			return true;
-		}
-		else
-		{
-			LOG_ERROR(QString("Failed to accept incoming SIP call, call=%1, uri=%2, video=%3: %4").arg(FCallIndex).arg(FRemoteUri).arg(AWithVideo).arg(resolveSipError(status)));
-			setError(status);
-		}
-	}
-	else
-	{
-		REPORT_ERROR("Failed to start SIP call: Invalid call state");
-	}
-	return false;
-}
-
-bool SipCall::hangupCall(quint32 AStatusCode, const QString &AText)
-{
-	if (isActive())
-	{
-		QByteArray reason = AText.toLocal8Bit();
-		pj_str_t pj_reason = pj_str(reason.data());
-		pj_status_t status = pjsua_call_hangup(FCallIndex,AStatusCode,&pj_reason,NULL);
-		if (status == PJ_SUCCESS)
-		{
-			LOG_INFO(QString("Hanging up SIP call, code=%1, call=%2, uri=%3").arg(AStatusCode).arg(FCallIndex).arg(FRemoteUri));
-			return true;
-		}
-		else
-		{
-			LOG_ERROR(QString("Failed to hangup SIP call, code=%1, call=%2, uri=%3: %4").arg(AStatusCode).arg(FCallIndex).arg(FRemoteUri).arg(resolveSipError(status)));
-			setError(status);
-		}
-	}
-	return false;
-}
-
-bool SipCall::destroyCall(unsigned long AWaitForDisconnected)
-{
-	if (hangupCall(ISipCall::SC_Decline))
-	{
-		unsigned long waitTime = AWaitForDisconnected;
-		QDateTime startTime = QDateTime::currentDateTime();
-		
-		while (isActive() && waitTime>0)
-		{
-			FDestroyLock.lock();
-			FEventWait.wait(&FDestroyLock,qMin(waitTime,1000UL));
-			FDestroyLock.unlock();
-
-			unsigned long passedMsecs = startTime.msecsTo(QDateTime::currentDateTime());
-			waitTime = AWaitForDisconnected>passedMsecs ? AWaitForDisconnected-passedMsecs : 0;
-		}
-
-		if (isActive())
-		{
-			LOG_DEBUG(QString("Waiting for SIP call disconnection, call=%1, uri=%2").arg(FCallIndex).arg(FRemoteUri));
-			FDelayedDestroy = true;
-			return false;
-		}
-	}
-
-	LOG_INFO(QString("Destroying SIP call, call=%1, uri=%2").arg(FCallIndex).arg(FRemoteUri));
-	int delayDestroy = qMax(FDestroyWaitTime-QDateTime::currentMSecsSinceEpoch(),(qint64)0);
-	QTimer::singleShot(delayDestroy,this,SLOT(deleteLater()));
-
-	return true;
-}
-
-bool SipCall::hasActiveMediaStream() const
-{
-	return FCallIndex!=PJSUA_INVALID_ID ? pjsua_call_has_media(FCallIndex) : false;
-}
-
-ISipMediaStream SipCall::findMediaStream(int AMediaIndex) const
-{
-	return AMediaIndex>=0 ? mediaStreams().value(AMediaIndex) : ISipMediaStream();
-}
-
-QList<ISipMediaStream> SipCall::mediaStreams(ISipMedia::Type AType) const
-{
-	QList<ISipMediaStream> streams;
-	if (isActive())
-	{
-		pjsua_call_info ci;
-		if (pjsua_call_get_info(FCallIndex,&ci) == PJ_SUCCESS)
-		{
-			for (unsigned index = 0; index<ci.media_cnt; index++)
-			{
-				ISipMediaStream stream;
-				switch (ci.media[index].type)
-				{
-				case PJMEDIA_TYPE_AUDIO:
-					stream.type = ISipMedia::Audio;
-					break;
-				case PJMEDIA_TYPE_VIDEO:
-					stream.type = ISipMedia::Video;
-					break;
-				default:
-					stream.type = ISipMedia::Unknown;
-				}
-
-				switch(ci.media[index].dir)
-				{
-				case PJMEDIA_DIR_CAPTURE:
-					stream.dir = ISipMedia::Capture;
-					break;
-				case PJMEDIA_DIR_PLAYBACK:
-					stream.dir = ISipMedia::Playback;
-					break;
-				case PJMEDIA_DIR_CAPTURE_PLAYBACK:
-					stream.dir = ISipMedia::CaptureAndPlayback;
-					break;
-				default:
-					stream.dir = ISipMedia::None;
-				}
-				
-				if (AType==ISipMedia::Null || stream.type==AType)
-				{
-					stream.index = index;
-					stream.state = (ISipMediaStream::State)ci.media[index].status;
-
-					pjsua_stream_info si;
-					if (ci.media[index].dir!=PJMEDIA_DIR_NONE && pjsua_call_get_stream_info(FCallIndex,index,&si)==PJ_SUCCESS)
-					{
-						if (si.type == PJMEDIA_TYPE_AUDIO)
-						{
-							stream.format.type = ISipMedia::Audio;
-							stream.format.details.aud.clockRate = si.info.aud.param->info.clock_rate;
-							stream.format.details.aud.channelCount = si.info.aud.param->info.channel_cnt;
-							stream.format.details.aud.frameTimeUsec = si.info.aud.param->info.frm_ptime;
-							stream.format.details.aud.bitsPerSample = si.info.aud.param->info.pcm_bits_per_sample;
-							stream.format.details.aud.avgBitrate = si.info.aud.param->info.avg_bps;
-							stream.format.details.aud.maxBitrate = si.info.aud.param->info.max_bps;
-						}
-						else if (si.type == PJMEDIA_TYPE_VIDEO)
-						{
-							if (si.info.vid.codec_param->dir == PJMEDIA_DIR_ENCODING)
-							{
-								stream.format.type = ISipMedia::Video;
-								stream.format.details.vid.fpsNum = si.info.vid.codec_param->enc_fmt.det.vid.fps.num;
-								stream.format.details.vid.fpsDenum = si.info.vid.codec_param->enc_fmt.det.vid.fps.denum;
-								stream.format.details.vid.avgBitrate = si.info.vid.codec_param->enc_fmt.det.vid.avg_bps;
-								stream.format.details.vid.maxBitrate = si.info.vid.codec_param->enc_fmt.det.vid.max_bps;
-								stream.format.details.vid.width = si.info.vid.codec_param->enc_fmt.det.vid.size.w;
-								stream.format.details.vid.height = si.info.vid.codec_param->enc_fmt.det.vid.size.h;
-							}
-							else if (si.info.vid.codec_param->dir == PJMEDIA_DIR_DECODING)
-							{
-								stream.format.type = ISipMedia::Video;
-								stream.format.details.vid.fpsNum = si.info.vid.codec_param->dec_fmt.det.vid.fps.num;
-								stream.format.details.vid.fpsDenum = si.info.vid.codec_param->dec_fmt.det.vid.fps.denum;
-								stream.format.details.vid.avgBitrate = si.info.vid.codec_param->dec_fmt.det.vid.avg_bps;
-								stream.format.details.vid.maxBitrate = si.info.vid.codec_param->dec_fmt.det.vid.max_bps;
-								stream.format.details.vid.width = si.info.vid.codec_param->dec_fmt.det.vid.size.w;
-								stream.format.details.vid.height = si.info.vid.codec_param->dec_fmt.det.vid.size.h;
-							}
-						}
-					}
-
-					streams.append(stream);
-				}
-			}
-		}
-	}
-	return streams;
-}
-
-QVariant SipCall::mediaStreamProperty(int AMediaIndex, ISipMedia::Direction ADir, ISipMediaStream::Property AProperty) const
-{
-	pjsua_call_info ci;
-	if (AMediaIndex>=0 && isActive() && pjsua_call_get_info(FCallIndex,&ci)==PJ_SUCCESS && AMediaIndex<(int)ci.media_cnt)
-	{
-		if (ci.media[AMediaIndex].type == PJMEDIA_TYPE_AUDIO)
-		{
-			switch (AProperty)
-			{
-			case ISipMediaStream::Enabled:
-				{
-					pjsua_conf_port_id sink = -1;
-					pjsua_conf_port_id source =-1;
-					if (ADir == ISipMedia::Capture)
-					{
-						source = 0;
-						sink = ci.media[AMediaIndex].stream.aud.conf_slot;
-					}
-					else if (ADir == ISipMedia::Playback)
-					{
-						source = ci.media[AMediaIndex].stream.aud.conf_slot;
-						sink = 0;
-					}
-
-					pjsua_conf_port_info pi;
-					if (source>=0 && pjsua_conf_get_port_info(source,&pi)==PJ_SUCCESS)
-					{
-						for(unsigned int i=0; i<pi.listener_cnt; i++)
-							if (pi.listeners[i] == sink)
-								return QVariant(true);
-						return QVariant(false);
-					}
-				}
-				break;
-			case ISipMediaStream::Volume:
-				{
-					if (ADir==ISipMedia::Capture || ADir==ISipMedia::Playback)
-					{
-						static const QVariant defVolume = 1.0;
-						return FStreamProperties.value(AMediaIndex).value(ADir).value(AProperty,defVolume);
-					}
-				}
-				break;
-			default:
-				break;
-			}
-		}
-		else if (ci.media[AMediaIndex].type == PJMEDIA_TYPE_VIDEO)
-		{
-			switch (AProperty)
-			{
-			case ISipMediaStream::Enabled:
-				{
-					if (ADir == ISipMedia::Capture)
-						return QVariant((ci.media[AMediaIndex].dir & PJMEDIA_DIR_CAPTURE) > 0);
-					else if (ADir == ISipMedia::Playback)
-						return QVariant((ci.media[AMediaIndex].dir & PJMEDIA_DIR_PLAYBACK) > 0);
-				}
-				break;
-			case ISipMediaStream::Volume:
-				{
-					if (ADir==ISipMedia::Capture || ADir==ISipMedia::Playback)
-					{
-						static const QVariant defVolume = 1.0;
-						return FStreamProperties.value(AMediaIndex).value(ADir).value(AProperty,defVolume);
-					}
-				}
-				break;
-			default:
-				break;
-			}
-		}
-	}
-	return QVariant();
-}
-
-bool SipCall::setMediaStreamProperty(int AMediaIndex, ISipMedia::Direction ADir, ISipMediaStream::Property AProperty, const QVariant &AValue)
-{
-	pjsua_call_info ci;
-	QVariant curValue = mediaStreamProperty(AMediaIndex,ADir,AProperty);
-	if (curValue!=AValue && isActive() && pjsua_call_get_info(FCallIndex,&ci)==PJ_SUCCESS && AMediaIndex!=PJSUA_INVALID_ID && AMediaIndex<(int)ci.media_cnt)
-	{
-		pjmedia_dir pj_dir;
-		switch(ADir)
-		{
-		case ISipMedia::Capture:
-			pj_dir = PJMEDIA_DIR_CAPTURE;
-			break;
-		case ISipMedia::Playback:
-			pj_dir = PJMEDIA_DIR_PLAYBACK;
-			break;
-		case ISipMedia::CaptureAndPlayback:
-			pj_dir = PJMEDIA_DIR_CAPTURE_PLAYBACK;
-			break;
-		default:
-			pj_dir = PJMEDIA_DIR_NONE;
-		}
-
-		if (ci.media[AMediaIndex].type == PJMEDIA_TYPE_AUDIO)
-		{
-			switch (AProperty)
-			{
-			case ISipMediaStream::Enabled:
-				{
-					pj_status_t status = PJ_SUCCESS;
-					if ((ADir & ISipMedia::Capture) > 0)
-					{
-						if (AValue.toBool())
-							status = pjsua_conf_connect(0,ci.media[AMediaIndex].stream.aud.conf_slot);
-						else
-							status = pjsua_conf_disconnect(0,ci.media[AMediaIndex].stream.aud.conf_slot);
-					}
-					if ((ADir & ISipMedia::Playback) > 0)
-					{
-						if (AValue.toBool())
-							status = pjsua_conf_connect(ci.media[AMediaIndex].stream.aud.conf_slot,0);
-						else
-							status = pjsua_conf_disconnect(ci.media[AMediaIndex].stream.aud.conf_slot,0);
-					}
-
-					if (status == PJ_SUCCESS)
-						LOG_DEBUG(QString("SIP media stream property changed, call=%1, media=%2, dir=%3, property=%4, value=%5").arg(FCallIndex).arg(AMediaIndex).arg(pj_dir).arg(AProperty).arg(AValue.toString()));
-					else
-						LOG_ERROR(QString("Failed to change SIP media stream property, call=%1, media=%2, dir=%3, property=%4, value=%5: %6").arg(FCallIndex).arg(AMediaIndex).arg(pj_dir).arg(AProperty).arg(AValue.toString()).arg(resolveSipError(status)));
-
-					emit mediaChanged();
-					return status == PJ_SUCCESS;
-				}
-			case ISipMediaStream::Volume:
-				{
-					pj_status_t status_cap = PJ_SUCCESS;
-					if ((ADir & ISipMedia::Capture) > 0)
-					{
-						status_cap = pjsua_conf_adjust_tx_level(ci.media[AMediaIndex].stream.aud.conf_slot,AValue.toFloat());
-						if (status_cap == PJ_SUCCESS)
-							FStreamProperties[AMediaIndex][ISipMedia::Capture][ISipMediaStream::Volume] = AValue;
-					}
-
-					pj_status_t status_play = PJ_SUCCESS;
-					if ((ADir & ISipMedia::Playback) > 0)
-					{
-						status_play = pjsua_conf_adjust_rx_level(ci.media[AMediaIndex].stream.aud.conf_slot,AValue.toFloat());
-						if (status_play == PJ_SUCCESS)
-							FStreamProperties[AMediaIndex][ISipMedia::Playback][ISipMediaStream::Volume] = AValue;
-					}
-
-					if (status_cap==PJ_SUCCESS && status_play==PJ_SUCCESS)
-						LOG_DEBUG(QString("SIP media stream property changed, call=%1, media=%2, dir=%3, property=%4, value=%5").arg(FCallIndex).arg(AMediaIndex).arg(pj_dir).arg(AProperty).arg(AValue.toString()));
-					else
-						LOG_ERROR(QString("Failed to change SIP media stream property, call=%1, media=%2, dir=%3, property=%4, value=%5: %6").arg(FCallIndex).arg(AMediaIndex).arg(pj_dir).arg(AProperty).arg(AValue.toString()).arg(resolveSipError(status_play==PJ_SUCCESS ? status_cap : status_play)));
-
-					emit mediaChanged();
-					return status_cap==PJ_SUCCESS && status_play==PJ_SUCCESS;
-				}
-			default:
-				LOG_ERROR(QString("Failed to change SIP media stream property, call=%1, media=%2, dir=%3, property=%4, value=%5: Unsupported audio property").arg(FCallIndex).arg(AMediaIndex).arg(pj_dir).arg(AProperty).arg(AValue.toString()));
-				break;
-			}
-		}
-		else if (ci.media[AMediaIndex].type == PJMEDIA_TYPE_VIDEO)
-		{
-			switch (AProperty)
-			{
-			case ISipMediaStream::Enabled:
-				{
-					pjsua_call_vid_strm_op_param param;
-					pjsua_call_vid_strm_op_param_default(&param);
-
-					param.med_idx = AMediaIndex;
-					if (AValue.toBool())
-						param.dir = (pjmedia_dir)(ci.media[AMediaIndex].dir | pj_dir);
-					else
-						param.dir = (pjmedia_dir)(ci.media[AMediaIndex].dir & ~pj_dir);
-
-					pj_status_t status = pjsua_call_set_vid_strm(FCallIndex,PJSUA_CALL_VID_STRM_CHANGE_DIR,&param);
-
-					if (status == PJ_SUCCESS)
-						LOG_DEBUG(QString("SIP media stream property changed, call=%1, media=%2, dir=%3, property=%4, value=%5").arg(FCallIndex).arg(AMediaIndex).arg(pj_dir).arg(AProperty).arg(AValue.toString()));
-					else
-						LOG_ERROR(QString("Failed to change SIP media stream property, call=%1, media=%2, dir=%3, property=%4, value=%5: %6").arg(FCallIndex).arg(AMediaIndex).arg(pj_dir).arg(AProperty).arg(AValue.toString()).arg(resolveSipError(status)));
-
-					emit mediaChanged();
-					return status == PJ_SUCCESS;
-				}
-			case ISipMediaStream::Volume:
-				{
-					pjsua_call_vid_strm_op_param param;
-					pjsua_call_vid_strm_op_param_default(&param);
-
-					param.med_idx = AMediaIndex;
-					param.dir = pj_dir;
-
-					pj_status_t status = -1;
-					if (AValue.toFloat() < 0.1)
-						status = pjsua_call_set_vid_strm(FCallIndex,PJSUA_CALL_VID_STRM_STOP_TRANSMIT,&param);
-					else if (AValue.toFloat() > 0.9)
-						status = pjsua_call_set_vid_strm(FCallIndex,PJSUA_CALL_VID_STRM_START_TRANSMIT,&param);
-
-					if (status == PJ_SUCCESS)
-					{
-						if ((ADir & ISipMedia::Capture) > 0)
-							FStreamProperties[AMediaIndex][ISipMedia::Capture][ISipMediaStream::Volume] = AValue;
-						if ((ADir & ISipMedia::Playback) > 0)
-							FStreamProperties[AMediaIndex][ISipMedia::Playback][ISipMediaStream::Volume] = AValue;
-						LOG_DEBUG(QString("SIP media stream property changed, call=%1, media=%2, dir=%3, property=%4, value=%5").arg(FCallIndex).arg(AMediaIndex).arg(pj_dir).arg(AProperty).arg(AValue.toString()));
-					}
-					else
-					{
-						LOG_ERROR(QString("Failed to change SIP media stream property, call=%1, media=%2, dir=%3, property=%4, value=%5: %6").arg(FCallIndex).arg(AMediaIndex).arg(pj_dir).arg(AProperty).arg(AValue.toString()).arg(resolveSipError(status)));
-					}
-
-					emit mediaChanged();
-					return status == PJ_SUCCESS;
-				}
-			default:
-				LOG_ERROR(QString("Failed to change SIP media stream property, call=%1, media=%2, dir=%3, property=%4, value=%5: Unsupported video property").arg(FCallIndex).arg(AMediaIndex).arg(pj_dir).arg(AProperty).arg(AValue.toString()));
-				break;
-			}
-		}
-		else
-		{
-			LOG_ERROR(QString("Failed to change SIP media stream property, call=%1, media=%2, dir=%3, property=%4, value=%5: Invalid media type").arg(FCallIndex).arg(AMediaIndex).arg(pj_dir).arg(AProperty).arg(AValue.toString()));
-		}
-	}
-	else if (curValue!=AValue && isActive())
-	{
-		LOG_ERROR(QString("Failed to change SIP media stream property, call=%1, media=%2, property=%3, value=%4: Invalid media index").arg(FCallIndex).arg(AMediaIndex).arg(AProperty).arg(AValue.toString()));
-	}
-	return false;
-}
-
-QWidget *SipCall::getVideoPlaybackWidget(int AMediaIndex, QWidget *AParent)
-{
-	VideoWindow *widget = NULL;
-	ISipMediaStream stream = findMediaStream(AMediaIndex);
-	if (stream.index==AMediaIndex && stream.type==ISipMedia::Video && (stream.dir & ISipMedia::Playback)>0)
-	{
-		pjsua_call_info ci;
-		if (FCallIndex>=0 && pjsua_call_get_info(FCallIndex,&ci)==PJ_SUCCESS && AMediaIndex<(int)ci.media_cnt && ci.media[AMediaIndex].stream.vid.win_in!=PJSUA_INVALID_ID)
-		{
-			pjsua_vid_win_info wi;
-			if (pjsua_vid_win_get_info(ci.media[AMediaIndex].stream.vid.win_in,&wi) == PJ_SUCCESS)
-			{
-				if (wi.hwnd.type == QT_RENDER_VID_DEV_TYPE)
-				{
-					widget = new VideoWindow(AParent);
-					widget->setSurface((VideoSurface *)wi.hwnd.info.window);
-					connect(widget,SIGNAL(windowDestroyed()),SLOT(onVideoPlaybackWidgetDestroyed()));
-					FVideoPlaybackWidgets.insertMulti(AMediaIndex,widget);
-					LOG_DEBUG(QString("SIP video playback widget created: call=%1, media=%2").arg(FCallIndex).arg(AMediaIndex));
-				}
-				else
-				{
-					LOG_ERROR(QString("Failed to create SIP video playback widget, call=%1, media=%2: Incompatible render device type (%3)").arg(FCallIndex).arg(AMediaIndex).arg(wi.hwnd.type));
-				}
-			}
-			else
-			{
-				LOG_ERROR(QString("Failed to create SIP video playback widget, call=%1, media=%2: Media stream window info not found").arg(FCallIndex).arg(AMediaIndex));
-			}
-		}
-		else
-		{
-			LOG_ERROR(QString("Failed to create SIP video playback widget, call=%1, media=%2: Invalid media index").arg(FCallIndex).arg(AMediaIndex));
-		}
-	}
-	else if (stream.index!=AMediaIndex)
-	{
-		LOG_ERROR(QString("Failed to create SIP video playback widget, call=%1, media=%2: Media stream not found").arg(FCallIndex).arg(AMediaIndex));
-	}
-	else
-	{
-		LOG_ERROR(QString("Failed to create SIP video playback widget, call=%1, media=%2: Invalid media stream").arg(FCallIndex).arg(AMediaIndex));
-	}
-	return widget;
-}
-
-void SipCall::initialize()
-{
-	FDestroyWaitTime = 0;
-	FDelayedDestroy = false;
-	FTotalDurationTime = 0;
-
-	FTonegenPool = pjsua_pool_create("tonegen-pool", 512, 512);
-	pjmedia_tonegen_create(FTonegenPool, 8000, 1, 160, 16, 0, &FTonegenPort);
-	pjsua_conf_add_port(FTonegenPool, FTonegenPort, &FTonegenSlot);
-	pjsua_conf_connect(FTonegenSlot,0);
-}
-
-void SipCall::setState(State AState)
-{
-	if (FState < AState)
-	{
-		LOG_DEBUG(QString("Call state changed, state=%1, call=%2, uri=%3").arg(AState).arg(FCallIndex).arg(FRemoteUri));
-
-		FState = AState;
-
-		switch (AState)
-		{
-		case ISipCall::Connecting:
-			Logger::startTiming(STMP_SIPPHONE_CALL_NEGOTIATION,FRemoteUri);
-			break;
-		case ISipCall::Confirmed:
-			REPORT_TIMING(STMP_SIPPHONE_CALL_NEGOTIATION,Logger::finishTiming(STMP_SIPPHONE_CALL_NEGOTIATION,FRemoteUri));
-			Logger::startTiming(STMP_SIPPHONE_CALL_DURATION,FRemoteUri);
-			REPORT_EVENT(SEVP_SIPPHONE_CALL_SUCCESS,1);
-			break;
-		case Disconnected:
-			REPORT_TIMING(STMP_SIPPHONE_CALL_DURATION,Logger::finishTiming(STMP_SIPPHONE_CALL_DURATION,FRemoteUri));
-			Logger::finishTiming(STMP_SIPPHONE_CALL_NEGOTIATION,FRemoteUri);
-			break;
-		case Aborted:
-			Logger::finishTiming(STMP_SIPPHONE_CALL_NEGOTIATION,FRemoteUri);
-			Logger::finishTiming(STMP_SIPPHONE_CALL_DURATION,FRemoteUri);
-			REPORT_EVENT(SEVP_SIPPHONE_CALL_FAILURE,1);
-			break;
-		default:
-			break;
-		}
-
-		if (FState==Disconnected || FState==Aborted)
-		{
-			FCallIndex = PJSUA_INVALID_ID;
-			if (FDelayedDestroy)
-				destroyCall(0);
-		}
-
-		emit stateChanged();
-	}
-}
-
-void SipCall::setError(pj_status_t AStatus)
-{
-	if (FState != Aborted)
-	{
-		setStatus(PJSIP_SC_INTERNAL_SERVER_ERROR,resolveSipError(AStatus));
-		setState(Aborted);
-	}
-}
-
-bool SipCall::isErrorStatus(pjsip_status_code ACode)
-{
-	switch (ACode)
-	{
-	case PJSIP_SC_TRYING:
-	case PJSIP_SC_RINGING:
-	case PJSIP_SC_CALL_BEING_FORWARDED:
-	case PJSIP_SC_QUEUED:
-	case PJSIP_SC_PROGRESS:
-	case PJSIP_SC_OK:
-	case PJSIP_SC_ACCEPTED:
-	case PJSIP_SC_BUSY_HERE:
-	case PJSIP_SC_BUSY_EVERYWHERE:
-	case PJSIP_SC_DECLINE:
-		return false;
-	default:
-		return true;
-	}
-}
-
-void SipCall::setStatus(quint32 ACode, const QString &AText)
-{
-	if (FStatusCode != ACode)
-	{
-		FStatusCode = ACode;
-		FStatusText = AText;
-		LOG_DEBUG(QString("Call status changed, code=%1, message=%2, call=%3, uri=%4").arg(FStatusCode).arg(FStatusText).arg(FCallIndex).arg(FRemoteUri));
-		emit statusChanged();
-	}
-}
-
-QString SipCall::resolveSipError(int ACode) const
-{
-	char errmsg[PJ_ERR_MSG_SIZE];
-	pj_strerror(ACode, errmsg, sizeof(errmsg));
-	return QString(errmsg);
-}
-
-void SipCall::printCallDump(bool AWithMedia) const
-{
-	char buf[PJ_LOG_MAX_SIZE];
-	if (FCallIndex>=0 && pjsua_call_dump(FCallIndex,(AWithMedia ? PJ_TRUE : PJ_FALSE),buf,sizeof(buf)," ") == PJ_SUCCESS)
-	{
-		pjsua_call_info ci;
-		if (pjsua_call_get_info(FCallIndex,&ci) == PJ_SUCCESS)
-		{
-			unsigned pos = strlen(buf);
-			unsigned end= sizeof(buf);
-
-			buf[end--]='\0';
-			pos += pj_ansi_snprintf(buf+pos,end-pos," Call Info:\n");
-
-			pos += pj_ansi_snprintf(buf+pos,end-pos,
-				"   local_info=%s, local_contact=%s\n"
-				"   remote_info=%s, remote_contact=%s\n"
-				"   flags=%d, aud_cnt=%d, vid_cnt=%d, rem_aud=%d, rem_vid=%d\n"
-				"   media_status=%d, media_dir=%d, conf_slot=%d\n",
-				ci.local_info.ptr, ci.local_contact.ptr,
-				ci.remote_info.ptr, ci.remote_contact.ptr,
-				ci.setting.flag, ci.setting.aud_cnt, ci.setting.vid_cnt, ci.rem_aud_cnt, ci.rem_vid_cnt,
-				ci.media_status, ci.media_dir, ci.conf_slot);
-
-			if (AWithMedia)
-			{
-				pos += pj_ansi_snprintf(buf+pos,end-pos,"   media_cnt=%d\n",ci.media_cnt);
-				for (unsigned i=0; i<ci.media_cnt; i++)
-				{
-					pjsua_call_media_info *mi = &ci.media[i];
-
-					pos += pj_ansi_snprintf(buf+pos,end-pos,
-						"     #%d type=%d, dir=%d, status=%d\n",
-						mi->index, mi->type, mi->dir, mi->status);
-				}
-
-				pos += pj_ansi_snprintf(buf+pos,end-pos,"   prov_media_cnt=%d\n",ci.prov_media_cnt);
-				for (unsigned i=0; i<ci.prov_media_cnt; i++)
-				{
-					pjsua_call_media_info *mi = &ci.prov_media[i];
-
-					pos += pj_ansi_snprintf(buf+pos,end-pos,
-						"     #%d type=%d, dir=%d, status=%d\n",
-						mi->index, mi->type, mi->dir, mi->status);
-				}
-			}
-		}
-
-		LOG_DEBUG(QString("Call dump, call=%1\n%2").arg(FCallIndex).arg(buf));
-	}
-}
-
-void SipCall::updateVideoPlaybackWidgets(const QList<int> &AMediaIndexes)
-{
-	if (!FVideoPlaybackWidgets.isEmpty())
-	{
-		pjsua_call_info ci;
-		pj_status_t status = FCallIndex!=PJSUA_INVALID_ID ? pjsua_call_get_info(FCallIndex,&ci) : -1;
-		foreach(int mediaIndex, AMediaIndexes)
-		{
-			foreach(VideoWindow *widget, FVideoPlaybackWidgets.values(mediaIndex))
-			{
-				if (status==PJ_SUCCESS && mediaIndex<(int)ci.media_cnt && ci.media[mediaIndex].stream.vid.win_in!=PJSUA_INVALID_ID)
-				{
-					pjsua_vid_win_info wi;
-					if (pjsua_vid_win_get_info(ci.media[mediaIndex].stream.vid.win_in,&wi)==PJ_SUCCESS && wi.hwnd.type==QT_RENDER_VID_DEV_TYPE)
-						widget->setSurface((VideoSurface *)wi.hwnd.info.window);
-					else
-						widget->setSurface(NULL);
-				}
-				else
-				{
-					widget->setSurface(NULL);
-				}
-			}
-		}
-	}
-}
-
-void SipCall::processSipEvent(SipEvent *AEvent)
-{
-	switch (AEvent->type)
-	{
-	case SipEvent::CallState:
-		{
-			SipEventCallState *se = static_cast<SipEventCallState *>(AEvent);
-
-			FTotalDurationTime = se->duration;
-			FDestroyWaitTime = se->destroyWaitTime;
-			setStatus(se->status,pjsip_get_status_text(se->status)->ptr);
-
-			switch (se->state)
-			{
-			case PJSIP_INV_STATE_NULL:
-				setState(Inited);
-				break;
-			case PJSIP_INV_STATE_CALLING:
-			case PJSIP_INV_STATE_INCOMING:
-				setState(Calling);
-				break;
-			case PJSIP_INV_STATE_EARLY:
-				setState(Ringing);
-				break;
-			case PJSIP_INV_STATE_CONNECTING:
-				setState(Connecting);
-				break;
-			case PJSIP_INV_STATE_CONFIRMED:
-				setState(Confirmed);
-				break;
-			case PJSIP_INV_STATE_DISCONNECTED:
-				setState(isErrorStatus(se->status) ? Aborted : Disconnected);
-				break;
-			default:
-				break;
-			};
-			delete se;
-		}
-		break;
-	case SipEvent::CallMediaState:
-		{
-			SipEventCallMediaState *se = static_cast<SipEventCallMediaState *>(AEvent);
-			switch (se->mediaStatus)
-			{
-			case PJSUA_CALL_MEDIA_ACTIVE:
-				{
-					pjsua_conf_port_id conf = 0;
-					pjsua_conf_connect(se->confSlot,conf);
-					pjsua_conf_connect(conf,se->confSlot);
-					pjsua_conf_connect(FTonegenSlot,se->confSlot);
-				}
-				break;
-			case PJSUA_CALL_MEDIA_ERROR:
-				{
-					if (isActive())
-					{
-						pj_str_t reason = pj_str((char *)"ICE negotiation failed");
-						pjsua_call_hangup(FCallIndex,PJSIP_SC_INTERNAL_SERVER_ERROR,&reason,NULL);
-					}
-				}
-				break;
-			default:
-				break;
-			}
-			delete se;
-
-			updateVideoPlaybackWidgets(FVideoPlaybackWidgets.keys());
-			emit mediaChanged();
-		}
-		break;
-	case SipEvent::Error:
-		{
-			SipEventError *se = static_cast<SipEventError *>(AEvent);
-			setError(se->error);
-			delete se;
-		}
-		break;
-	default:
-		REPORT_ERROR(QString("Received unexpected SIP event, call=%1, uri=%2, type=%3").arg(FCallIndex).arg(FRemoteUri).arg(AEvent->type));
-		delete AEvent;
-	}
-}
-
-void SipCall::onVideoPlaybackWidgetDestroyed()
-{
-	VideoWindow *widget = qobject_cast<VideoWindow *>(sender());
-	if (widget)
-	{
-		int mediaIndex = FVideoPlaybackWidgets.key(widget);
-		FVideoPlaybackWidgets.remove(mediaIndex,widget);
-		LOG_DEBUG(QString("Video playback widget destroyed: call=%1, uri=%2, media=%3").arg(FCallIndex).arg(FRemoteUri).arg(mediaIndex));
-	}
-}
-
-void SipCall::pjcbOnCallState()
-{
-	pjsua_call_info ci;
-	pj_status_t status = pjsua_call_get_info(FCallIndex,&ci);
-
-	printCallDump(true);
-
-	if (status == PJ_SUCCESS)
-	{
-		SipEventCallState *se = new SipEventCallState;
-		se->type = SipEvent::CallState;
-		se->state = ci.state;
-		se->status = ci.last_status;
-		se->duration = ci.connect_duration.sec*1000 + ci.connect_duration.msec;
-		se->destroyWaitTime = ci.media_status!=PJSUA_CALL_MEDIA_NONE ? QDateTime::currentMSecsSinceEpoch()+CLOSE_MEDIA_DELAY : 0;
-		QMetaObject::invokeMethod(this,"processSipEvent",Qt::QueuedConnection,Q_ARG(SipEvent *,se));
-	}
-	else
-	{
-		SipEventError *se = new SipEventError;
-		se->type = SipEvent::Error;
-		se->error = status;
-		QMetaObject::invokeMethod(this,"processSipEvent",Qt::QueuedConnection,Q_ARG(SipEvent *,se));
-	}
-	
-	FEventWait.wakeAll();
-}
-
-void SipCall::pjcbOnCallMediaState()
-{
-	pjsua_call_info ci;
-	pj_status_t status = pjsua_call_get_info(FCallIndex, &ci);
-
-	printCallDump(true);
-
-	if (status == PJ_SUCCESS)
-	{
-		SipEventCallMediaState *se = new SipEventCallMediaState;
-		se->type = SipEvent::CallMediaState;
-		se->confSlot = ci.conf_slot;
-		se->mediaStatus = ci.media_status;
-		QMetaObject::invokeMethod(this,"processSipEvent",Qt::QueuedConnection,Q_ARG(SipEvent *,se));
-	}
-	else
-	{
-		SipEventError *se = new SipEventError;
-		se->type = SipEvent::Error;
-		se->error = status;
-		QMetaObject::invokeMethod(this,"processSipEvent",Qt::QueuedConnection,Q_ARG(SipEvent *,se));
-	}
-
-	FEventWait.wakeAll();
-}
-
-void SipCall::pjcbOnCallMediaEvent(unsigned AMediaIndex, pjmedia_event *AEvent)
-{
-	Q_UNUSED(AMediaIndex); Q_UNUSED(AEvent);
-}
+#include "sipcall.h"
+
+#include <QTimer>
+#include <QMetaType>
+#include <QDateTime>
+#include <pjmedia-codec.h>
+#include <definitions/sipphone/optionvalues.h>
+#include <definitions/sipphone/statisticsparams.h>
+#include <utils/options.h>
+#include <utils/logger.h>
+#include "sipeventtrace.h"
+#include "sipadmission.h"
+#include "sipaudiodevice.h"
+#include "sipbridgebypass.h"
+
+#define CLOSE_MEDIA_DELAY  3000
+#define MEDIA_VOLUME_DELAY 20
+#define MEDIA_PROBE_DELAY  250
+#define MEDIA_PROBE_TIMEOUT 10000
+#define TONEGEN_CHECK_DELAY 50
+#define DTMF_ON_MSEC       120
+#define DTMF_OFF_MSEC      50
+#define DTMF_CHUNK_SIZE    16
+#define DTMF_RETRY_DELAY   100
+#define VIDEO_ADAPT_INTERVAL 2000
+
+SipCall::SipCall(const QUuid &AAccountId, pjsua_acc_id AAccIndex, const QString &ARemoteUri, QObject *AParent) : QObject(AParent)
+{
+	FAccIndex = AAccIndex;
+	FCallIndex = PJSUA_INVALID_ID;
+	FAccountId = AAccountId;
+	FRemoteUri = ARemoteUri;
+
+	FRole = ISipCall::Caller;
+	FState = ISipCall::Inited;
+	FStatusCode = ISipCall::SC_Undefined;
+
+	initialize();
+}
+
+SipCall::SipCall(const QUuid &AAccountId, pjsua_acc_id AAccIndex, pjsua_call_id ACallIndex, QObject *AParent) : QObject(AParent)
+{
+	FAccIndex = AAccIndex;
+	FCallIndex = ACallIndex;
+	FAccountId = AAccountId;
+
+	pjsua_call_info ci;
+	pjsua_call_get_info(FCallIndex,&ci);
+	FRemoteUri = QString::fromLocal8Bit(ci.remote_info.ptr,ci.remote_info.slen);
+
+	FRole = ISipCall::Receiver;
+	FState = ISipCall::Inited;
+	FStatusCode = ci.last_status;
+
+	initialize();
+
+	SipEventCallInfo info;
+	fillCallInfo(ci,&info);
+	updateCallInfo(&info);
+	updateMediaStreams();
+	FActive = info.active ? 1 : 0;
+
+	printCallDump(true);
+	FStateTimes[ISipCall::Calling] = info.timestamp;
+	setState(ISipCall::Ringing,info.timestamp);
+}
+
+SipCall::~SipCall()
+{
+	destroyCall();
+
+	foreach(VideoWindow *widget, FVideoPlaybackWidgets.values())
+		delete widget;
+
+	releaseTonegen();
+
+	emit callDestroyed();
+}
+
+QUuid SipCall::accountId() const
+{
+	return FAccountId;
+}
+
+QString SipCall::remoteUri() const
+{
+	return FRemoteUri;
+}
+
+bool SipCall::isActive() const
+{
+	return FActive > 0;
+}
+
+ISipCall::Role SipCall::role() const
+{
+	return FRole;
+}
+
+bool SipCall::isVideoAllowed() const
+{
+	return FVideoAllowed;
+}
+
+ISipCall::State SipCall::state() const
+{
+	return FState;
+}
+
+quint32 SipCall::statusCode() const
+{
+	return FStatusCode;
+}
+
+QString SipCall::statusText() const
+{
+	return FStatusText;
+}
+
+quint32 SipCall::durationTime() const
+{
+	qint64 confirmed = FStateTimes[Confirmed];
+	if (confirmed > 0)
+	{
+		qint64 finished = qMax(FStateTimes[Disconnected],FStateTimes[Aborted]);
+		return qMax((finished>0 ? finished : sipEventTimestamp())-confirmed,(qint64)0);
+	}
+	return 0;
+}
+
+qint64 SipCall::setupLatency(SetupLatency ALatency) const
+{
+	qint64 invite = FStateTimes[Calling];
+	qint64 answer = FStateTimes[Connecting]>0 ? FStateTimes[Connecting] : FStateTimes[Confirmed];
+	switch (ALatency)
+	{
+	case SL_Ringing:
+		// Receiver sends 180 Ringing itself, there is nothing to measure
+		return FRole==Caller && invite>0 && FStateTimes[Ringing]>0 ? FStateTimes[Ringing]-invite : -1;
+	case SL_Answered:
+		return invite>0 && answer>0 ? answer-invite : -1;
+	case SL_FirstMedia:
+		return answer>0 && FFirstMediaTime>0 ? qMax(FFirstMediaTime-answer,(qint64)0) : -1;
+	case SL_FirstVideoFrame:
+		return answer>0 && FFirstVideoFrameTime>0 ? qMax(FFirstVideoFrameTime-answer,(qint64)0) : -1;
+	}
+	return -1;
+}
+
+bool SipCall::sendDtmf(const char *ADigits)
+{
+	if (FCallIndex > PJSUA_INVALID_ID)
+	{
+		QByteArray digits;
+		for (const char *digit=ADigits; digit!=NULL && *digit!=0; digit++)
+		{
+			char upper = QChar::fromLatin1(*digit).toUpper().toLatin1();
+			if (strchr("0123456789*#ABCD",upper) != NULL)
+				digits.append(upper);
+		}
+
+		if (!digits.isEmpty())
+		{
+			if (FDtmfQueue.isEmpty())
+			{
+				QString method = Options::node(OPV_SIPPHONE_DTMFMETHOD).value().toString();
+				FDtmfMethod = method=="info" ? DtmfInfo : (method=="inband" ? DtmfInband : DtmfRfc2833);
+				FDtmfFallback = method!="rfc2833" && FDtmfMethod==DtmfRfc2833;
+			}
+
+			FDtmfQueue.append(digits);
+			LOG_DEBUG(QString("DTMF digits queued '%1', call=%2, uri=%3, queue=%4").arg(digits.constData()).arg(FCallIndex).arg(FRemoteUri).arg(FDtmfQueue.size()));
+
+			if (!FDtmfTimer.isActive())
+				sendQueuedDtmf();
+			return true;
+		}
+		else
+		{
+			LOG_ERROR(QString("Failed to send DTMF digits '%1', call=%2, uri=%3: No valid digits").arg(ADigits).arg(FCallIndex).arg(FRemoteUri));
+		}
+	}
+	else
+	{
+		LOG_ERROR(QString("Failed to send DTMF digits '%1', call=%2, uri=%3: Call is not active").arg(ADigits).arg(FCallIndex).arg(FRemoteUri));
+	}
+
+	return false;
+}
+
+bool SipCall::startCall(bool AWithVideo)
+{
+	if (FReplayMode)
+	{
+		LOG_ERROR(QString("Failed to start SIP call, uri=%1: Call is replayed").arg(FRemoteUri));
+	}
+	else if (FRole==Caller && FState==Inited)
+	{
+		pjsua_call_setting cs;
+		pjsua_call_setting_default(&cs);
+		cs.vid_cnt = AWithVideo ? 1 : 0;
+
+		// Second call needs conference bridge, so bypass is left before sound device is touched
+		SipBridgeBypass::leave();
+
+		QByteArray uri8bit = FRemoteUri.toLocal8Bit();
+		pj_str_t uri = pj_str(uri8bit.data());
+		pj_status_t status = pjsua_call_make_call(FAccIndex,&uri,&cs,NULL,NULL,&FCallIndex);
+		if (status == PJ_SUCCESS)
+		{
+			SipAdmission::reserveCall(FCallIndex,AWithVideo);
+			FActive = pjsua_call_is_active(FCallIndex) ? 1 : 0;
+			LOG_INFO(QString("Making outgoing SIP call, call=%1, uri=%2, video=%3").arg(FCallIndex).arg(FRemoteUri).arg(AWithVideo));
+			return true;
+		}
+		else
+		{
+			LOG_ERROR(QString("Failed to make outgoing SIP call, call=%1, uri=%2, video=%3: %4").arg(FCallIndex).arg(FRemoteUri).arg(AWithVideo).arg(resolveSipError(status)));
+			setError(status);
+		}
+	}
+	else if (FRole==Receiver && FState==Ringing)
+	{
+		// Video may be refused by admission control before the call was created
+		AWithVideo = AWithVideo && FVideoAllowed;
+
+		pjsua_call_setting cs;
+		pjsua_call_setting_default(&cs);
+		cs.vid_cnt = AWithVideo ? 1 : 0;
+
+		SipBridgeBypass::leave();
+		pj_status_t status = pjsua_call_answer2(FCallIndex,&cs,PJSIP_SC_OK,NULL,NULL);
+		if (status == PJ_SUCCESS)
+		{
+			LOG_INFO(QString("Accepting incoming SIP call, call=%1, uri=%2, video=%3").arg(FCallIndex).arg(FRemoteUri).arg(AWithVideo));
+			return true;
+		}
+		else
+		{
+			LOG_ERROR(QString("Failed to accept incoming SIP call, call=%1, uri=%2, video=%3: %4").arg(FCallIndex).arg(FRemoteUri).arg(AWithVideo).arg(resolveSipError(status)));
+			setError(status);
+		}
+	}
+	else
+	{
+		REPORT_ERROR("Failed to start SIP call: Invalid call state");
+	}
+	return false;
+}
+
+bool SipCall::hangupCall(quint32 AStatusCode, const QString &AText)
+{
+	if (isActive() && !FReplayMode)
+	{
+		QByteArray reason = AText.toLocal8Bit();
+		pj_str_t pj_reason = pj_str(reason.data());
+		pj_status_t status = pjsua_call_hangup(FCallIndex,AStatusCode,&pj_reason,NULL);
+		if (status == PJ_SUCCESS)
+		{
+			LOG_INFO(QString("Hanging up SIP call, code=%1, call=%2, uri=%3").arg(AStatusCode).arg(FCallIndex).arg(FRemoteUri));
+			return true;
+		}
+		else
+		{
+			LOG_ERROR(QString("Failed to hangup SIP call, code=%1, call=%2, uri=%3: %4").arg(AStatusCode).arg(FCallIndex).arg(FRemoteUri).arg(resolveSipError(status)));
+			setError(status);
+		}
+	}
+	return false;
+}
+
+bool SipCall::destroyCall(unsigned long AWaitForDisconnected)
+{
+	if (hangupCall(ISipCall::SC_Decline))
+	{
+		unsigned long waitTime = AWaitForDisconnected;
+		QDateTime startTime = QDateTime::currentDateTime();
+		
+		while (isActive() && waitTime>0)
+		{
+			FDestroyLock.lock();
+			FEventWait.wait(&FDestroyLock,qMin(waitTime,1000UL));
+			FDestroyLock.unlock();
+
+			unsigned long passedMsecs = startTime.msecsTo(QDateTime::currentDateTime());
+			waitTime = AWaitForDisconnected>passedMsecs ? AWaitForDisconnected-passedMsecs : 0;
+		}
+
+		if (isActive())
+		{
+			LOG_DEBUG(QString("Waiting for SIP call disconnection, call=%1, uri=%2").arg(FCallIndex).arg(FRemoteUri));
+			FDelayedDestroy = true;
+			return false;
+		}
+	}
+
+	LOG_INFO(QString("Destroying SIP call, call=%1, uri=%2").arg(FCallIndex).arg(FRemoteUri));
+	int delayDestroy = qMax(FDestroyWaitTime-sipEventTimestamp(),(qint64)0);
+	QTimer::singleShot(delayDestroy,this,SLOT(deleteLater()));
+
+	return true;
+}
+
+bool SipCall::hasActiveMediaStream() const
+{
+	return isActive() && FMediaStatus!=PJSUA_CALL_MEDIA_NONE && FMediaStatus!=PJSUA_CALL_MEDIA_ERROR;
+}
+
+ISipMediaStream SipCall::findMediaStream(int AMediaIndex) const
+{
+	return AMediaIndex>=0 && isActive() ? FMediaStreams.value(AMediaIndex) : ISipMediaStream();
+}
+
+quint32 SipCall::mediaVersion() const
+{
+	return FMediaVersion;
+}
+
+QList<ISipMediaStream> SipCall::mediaStreams(ISipMedia::Type AType) const
+{
+	QList<ISipMediaStream> streams;
+	if (isActive())
+	{
+		if (AType == ISipMedia::Null)
+			return FMediaStreams;
+
+		for (QList<ISipMediaStream>::const_iterator it=FMediaStreams.constBegin(); it!=FMediaStreams.constEnd(); ++it)
+			if (it->type == AType)
+				streams.append(*it);
+	}
+	return streams;
+}
+
+QVariant SipCall::mediaStreamProperty(int AMediaIndex, ISipMedia::Direction ADir, ISipMediaStream::Property AProperty) const
+{
+	if (AMediaIndex>=0 && isActive() && AMediaIndex<FMediaInfo.count() && (ADir==ISipMedia::Capture || ADir==ISipMedia::Playback))
+	{
+		switch (AProperty)
+		{
+		case ISipMediaStream::Enabled:
+			return QVariant(isMediaStreamEnabled(AMediaIndex,ADir));
+		case ISipMediaStream::Volume:
+			return QVariant(mediaStreamVolume(AMediaIndex,ADir));
+		default:
+			break;
+		}
+	}
+	return QVariant();
+}
+
+bool SipCall::setMediaStreamProperty(int AMediaIndex, ISipMedia::Direction ADir, ISipMediaStream::Property AProperty, const QVariant &AValue)
+{
+	switch (AProperty)
+	{
+	case ISipMediaStream::Enabled:
+		return setMediaStreamEnabled(AMediaIndex,ADir,AValue.toBool());
+	case ISipMediaStream::Volume:
+		return setMediaStreamVolume(AMediaIndex,ADir,AValue.toFloat());
+	default:
+		LOG_ERROR(QString("Failed to change SIP media stream property, call=%1, media=%2, property=%3, value=%4: Unsupported property").arg(FCallIndex).arg(AMediaIndex).arg(AProperty).arg(AValue.toString()));
+	}
+	return false;
+}
+
+bool SipCall::isMediaStreamEnabled(int AMediaIndex, ISipMedia::Direction ADir) const
+{
+	if (AMediaIndex>=0 && isActive() && !FReplayMode && AMediaIndex<FMediaInfo.count() && ADir!=ISipMedia::None)
+	{
+		const SipEventMediaInfo &mi = FMediaInfo.at(AMediaIndex);
+		if (mi.type == PJMEDIA_TYPE_AUDIO)
+		{
+			bool enabled = true;
+			for (int i=0; enabled && i<2; i++)
+			{
+				ISipMedia::Direction dir = i==0 ? ISipMedia::Capture : ISipMedia::Playback;
+				if ((ADir & dir) > 0)
+				{
+					pjsua_conf_port_id source = dir==ISipMedia::Capture ? SipAudioDevice::captureSlot() : mi.confSlot;
+					pjsua_conf_port_id sink = dir==ISipMedia::Capture ? mi.confSlot : SipAudioDevice::playbackSlot();
+
+					enabled = false;
+					pjsua_conf_port_info pi;
+					if (source>=0 && pjsua_conf_get_port_info(source,&pi)==PJ_SUCCESS)
+					{
+						for(unsigned int l=0; !enabled && l<pi.listener_cnt; l++)
+							enabled = pi.listeners[l] == sink;
+					}
+				}
+			}
+			return enabled;
+		}
+		else if (mi.type == PJMEDIA_TYPE_VIDEO)
+		{
+			if ((ADir & ISipMedia::Capture)>0 && (mi.dir & PJMEDIA_DIR_CAPTURE)==0)
+				return false;
+			if ((ADir & ISipMedia::Playback)>0 && (mi.dir & PJMEDIA_DIR_PLAYBACK)==0)
+				return false;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool SipCall::setMediaStreamEnabled(int AMediaIndex, ISipMedia::Direction ADir, bool AEnabled)
+{
+	if (isActive() && !FReplayMode && AMediaIndex>=0 && AMediaIndex<FMediaInfo.count())
+	{
+		if (isMediaStreamEnabled(AMediaIndex,ADir) == AEnabled)
+			return false;
+
+		const SipEventMediaInfo &mi = FMediaInfo.at(AMediaIndex);
+		pjmedia_dir pj_dir = (pjmedia_dir)(((ADir & ISipMedia::Capture)>0 ? PJMEDIA_DIR_CAPTURE : 0) | ((ADir & ISipMedia::Playback)>0 ? PJMEDIA_DIR_PLAYBACK : 0));
+
+		pj_status_t status = PJ_SUCCESS;
+		if (mi.type == PJMEDIA_TYPE_AUDIO)
+		{
+			SipBridgeBypass::leave(FCallIndex);
+			if ((ADir & ISipMedia::Capture) > 0)
+				status = AEnabled ? pjsua_conf_connect(SipAudioDevice::captureSlot(),mi.confSlot) : pjsua_conf_disconnect(SipAudioDevice::captureSlot(),mi.confSlot);
+			if ((ADir & ISipMedia::Playback) > 0)
+				status = AEnabled ? pjsua_conf_connect(mi.confSlot,SipAudioDevice::playbackSlot()) : pjsua_conf_disconnect(mi.confSlot,SipAudioDevice::playbackSlot());
+		}
+		else if (mi.type == PJMEDIA_TYPE_VIDEO)
+		{
+			pjsua_call_vid_strm_op_param param;
+			pjsua_call_vid_strm_op_param_default(&param);
+
+			param.med_idx = AMediaIndex;
+			param.dir = (pjmedia_dir)(AEnabled ? (mi.dir | pj_dir) : (mi.dir & ~pj_dir));
+
+			status = pjsua_call_set_vid_strm(FCallIndex,PJSUA_CALL_VID_STRM_CHANGE_DIR,&param);
+		}
+		else
+		{
+			LOG_ERROR(QString("Failed to change SIP media stream state, call=%1, media=%2, dir=%3, enabled=%4: Invalid media type").arg(FCallIndex).arg(AMediaIndex).arg(pj_dir).arg(AEnabled));
+			return false;
+		}
+
+		if (status == PJ_SUCCESS)
+			LOG_DEBUG(QString("SIP media stream state changed, call=%1, media=%2, dir=%3, enabled=%4").arg(FCallIndex).arg(AMediaIndex).arg(pj_dir).arg(AEnabled));
+		else
+			LOG_ERROR(QString("Failed to change SIP media stream state, call=%1, media=%2, dir=%3, enabled=%4: %5").arg(FCallIndex).arg(AMediaIndex).arg(pj_dir).arg(AEnabled).arg(resolveSipError(status)));
+
+		emit mediaChanged();
+		return status == PJ_SUCCESS;
+	}
+	else if (isActive())
+	{
+		LOG_ERROR(QString("Failed to change SIP media stream state, call=%1, media=%2, enabled=%3: Invalid media index").arg(FCallIndex).arg(AMediaIndex).arg(AEnabled));
+	}
+	return false;
+}
+
+float SipCall::mediaStreamVolume(int AMediaIndex, ISipMedia::Direction ADir) const
+{
+	if (AMediaIndex>=0 && AMediaIndex<FMediaInfo.count())
+	{
+		if (ADir == ISipMedia::Capture)
+			return FMediaLevels[AMediaIndex].volume[0];
+		else if (ADir == ISipMedia::Playback)
+			return FMediaLevels[AMediaIndex].volume[1];
+	}
+	return 1.0f;
+}
+
+bool SipCall::setMediaStreamVolume(int AMediaIndex, ISipMedia::Direction ADir, float AVolume)
+{
+	if (isActive() && !FReplayMode && AMediaIndex>=0 && AMediaIndex<FMediaInfo.count())
+	{
+		const SipEventMediaInfo &mi = FMediaInfo.at(AMediaIndex);
+		SipMediaStreamLevel &level = FMediaLevels[AMediaIndex];
+		bool captureSet = (ADir & ISipMedia::Capture)==0 || level.volume[0]==AVolume;
+		bool playbackSet = (ADir & ISipMedia::Playback)==0 || level.volume[1]==AVolume;
+		if (captureSet && playbackSet)
+		{
+			return false;
+		}
+		else if (mi.type == PJMEDIA_TYPE_AUDIO)
+		{
+			// Conference bridge levels are applied once per tick for all pending changes
+			if (AVolume != 1.0f)
+				SipBridgeBypass::leave(FCallIndex);
+			if ((ADir & ISipMedia::Capture) > 0)
+				level.volume[0] = AVolume;
+			if ((ADir & ISipMedia::Playback) > 0)
+				level.volume[1] = AVolume;
+			if (!FMediaVolumeTimer.isActive())
+				FMediaVolumeTimer.start();
+			return true;
+		}
+		else if (mi.type == PJMEDIA_TYPE_VIDEO)
+		{
+			pjsua_call_vid_strm_op_param param;
+			pjsua_call_vid_strm_op_param_default(&param);
+
+			param.med_idx = AMediaIndex;
+			param.dir = (pjmedia_dir)(((ADir & ISipMedia::Capture)>0 ? PJMEDIA_DIR_CAPTURE : 0) | ((ADir & ISipMedia::Playback)>0 ? PJMEDIA_DIR_PLAYBACK : 0));
+
+			pj_status_t status = -1;
+			if (AVolume < 0.1)
+				status = pjsua_call_set_vid_strm(FCallIndex,PJSUA_CALL_VID_STRM_STOP_TRANSMIT,&param);
+			else if (AVolume > 0.9)
+				status = pjsua_call_set_vid_strm(FCallIndex,PJSUA_CALL_VID_STRM_START_TRANSMIT,&param);
+
+			if (status == PJ_SUCCESS)
+			{
+				if ((ADir & ISipMedia::Capture) > 0)
+					level.volume[0] = level.appliedVolume[0] = AVolume;
+				if ((ADir & ISipMedia::Playback) > 0)
+					level.volume[1] = level.appliedVolume[1] = AVolume;
+				LOG_DEBUG(QString("SIP media stream volume changed, call=%1, media=%2, dir=%3, volume=%4").arg(FCallIndex).arg(AMediaIndex).arg(param.dir).arg(AVolume));
+			}
+			else
+			{
+				LOG_ERROR(QString("Failed to change SIP media stream volume, call=%1, media=%2, dir=%3, volume=%4: %5").arg(FCallIndex).arg(AMediaIndex).arg(param.dir).arg(AVolume).arg(resolveSipError(status)));
+			}
+
+			emit mediaChanged();
+			return status == PJ_SUCCESS;
+		}
+		LOG_ERROR(QString("Failed to change SIP media stream volume, call=%1, media=%2, volume=%3: Invalid media type").arg(FCallIndex).arg(AMediaIndex).arg(AVolume));
+	}
+	else if (isActive())
+	{
+		LOG_ERROR(QString("Failed to change SIP media stream volume, call=%1, media=%2, volume=%3: Invalid media index").arg(FCallIndex).arg(AMediaIndex).arg(AVolume));
+	}
+	return false;
+}
+
+ISipMediaStats SipCall::mediaStats(int AMediaIndex) const
+{
+	ISipMediaStats stats;
+	pjsua_stream_stat ss;
+	if (isActive() && FCallIndex!=PJSUA_INVALID_ID && AMediaIndex>=0 && AMediaIndex<FMediaInfo.count() && pjsua_call_get_stream_stat(FCallIndex,AMediaIndex,&ss)==PJ_SUCCESS)
+	{
+		stats.index = AMediaIndex;
+		stats.timestamp = sipEventTimestamp();
+		stats.rxPackets = ss.rtcp.rx.pkt;
+		stats.txPackets = ss.rtcp.tx.pkt;
+		stats.rxLost = ss.rtcp.rx.loss;
+		stats.txLost = ss.rtcp.tx.loss;
+		stats.rxDiscarded = ss.rtcp.rx.discard;
+		stats.rxJitter = ss.rtcp.rx.jitter.last;
+		stats.txJitter = ss.rtcp.tx.jitter.last;
+		stats.rtt = ss.rtcp.rtt.last;
+		stats.jbufDelay = ss.jbuf.avg_delay;
+		stats.jbufFrames = ss.jbuf.size;
+		stats.jbufDiscarded = ss.jbuf.discard;
+		stats.rxLossRate = stats.rxPackets+stats.rxLost>0 ? 100.0*stats.rxLost/(stats.rxPackets+stats.rxLost) : 0.0;
+
+		// Simplified ITU-T G.107 E-model
+		double delay = stats.rtt/2000.0 + 2.0*stats.rxJitter/1000.0 + 10.0;
+		double r = 93.2 - (delay<160.0 ? delay/40.0 : (delay-120.0)/10.0) - 2.5*stats.rxLossRate;
+		r = qBound(0.0,r,100.0);
+		stats.mos = qBound(1.0,1.0 + 0.035*r + 0.000007*r*(r-60.0)*(100.0-r),4.5);
+
+		if (FMediaInfo.at(AMediaIndex).type == PJMEDIA_TYPE_VIDEO)
+			FVideoAdapter.fillStats(stats);
+	}
+	return stats;
+}
+
+qint64 SipCall::audioDelay() const
+{
+	for (int index=0; isActive() && FCallIndex!=PJSUA_INVALID_ID && index<FMediaInfo.count(); index++)
+	{
+		const SipEventMediaInfo &mi = FMediaInfo.at(index);
+		if (mi.type==PJMEDIA_TYPE_AUDIO && mi.status==PJSUA_CALL_MEDIA_ACTIVE)
+		{
+			pjsua_stream_info si;
+			pjsua_stream_stat ss;
+			if (pjsua_call_get_stream_info(FCallIndex,index,&si)==PJ_SUCCESS && pjsua_call_get_stream_stat(FCallIndex,index,&ss)==PJ_SUCCESS)
+			{
+				// Mouth-to-ear: capture, packetization, network one way, jitter buffer and playback
+				unsigned recLatency = 0, playLatency = 0;
+				if (pjsua_snd_is_active())
+				{
+					pjsua_snd_get_setting(PJMEDIA_AUD_DEV_CAP_INPUT_LATENCY,&recLatency);
+					pjsua_snd_get_setting(PJMEDIA_AUD_DEV_CAP_OUTPUT_LATENCY,&playLatency);
+				}
+				unsigned ptime = si.info.aud.param!=NULL ? si.info.aud.param->info.frm_ptime*si.info.aud.param->setting.frm_per_pkt : 0;
+				return recLatency + ptime + ss.rtcp.rtt.last/2000 + ss.jbuf.avg_delay + playLatency;
+			}
+		}
+	}
+	return -1;
+}
+
+int SipCall::mediaStatsHistory(int AMediaIndex, ISipMediaStats *ASamples, int ACount) const
+{
+	int copied = 0;
+	if (AMediaIndex>=0 && AMediaIndex<FStatsRings.count() && ASamples!=NULL)
+	{
+		const SipMediaStatsRing &ring = FStatsRings.at(AMediaIndex);
+		int count = qMin(ring.count,ACount);
+		int first = (ring.head - count + MEDIA_STATS_RING_SIZE) % MEDIA_STATS_RING_SIZE;
+		for (; copied<count; copied++)
+			ASamples[copied] = ring.samples[(first+copied) % MEDIA_STATS_RING_SIZE];
+	}
+	return copied;
+}
+
+int SipCall::statsSamplingInterval() const
+{
+	return FStatsTimer.isActive() ? FStatsTimer.interval() : 0;
+}
+
+void SipCall::setStatsSamplingInterval(int AMsecs)
+{
+	if (AMsecs > 0)
+	{
+		LOG_DEBUG(QString("Media statistics sampling started, call=%1, interval=%2").arg(FCallIndex).arg(AMsecs));
+		FStatsTimer.start(AMsecs);
+	}
+	else if (FStatsTimer.isActive())
+	{
+		LOG_DEBUG(QString("Media statistics sampling stopped, call=%1").arg(FCallIndex));
+		FStatsTimer.stop();
+	}
+}
+
+QWidget *SipCall::getVideoPlaybackWidget(int AMediaIndex, QWidget *AParent)
+{
+	VideoWindow *widget = NULL;
+	ISipMediaStream stream = findMediaStream(AMediaIndex);
+	if (stream.index==AMediaIndex && stream.type==ISipMedia::Video && (stream.dir & ISipMedia::Playback)>0)
+	{
+		pjsua_vid_win_id winId = AMediaIndex<FMediaInfo.count() ? FMediaInfo.at(AMediaIndex).videoWindow : PJSUA_INVALID_ID;
+		if (FCallIndex>=0 && winId!=PJSUA_INVALID_ID)
+		{
+			pjsua_vid_win_info wi;
+			if (pjsua_vid_win_get_info(winId,&wi) == PJ_SUCCESS)
+			{
+				if (wi.hwnd.type == QT_RENDER_VID_DEV_TYPE)
+				{
+					widget = new VideoWindow(AParent);
+					widget->setSurface((VideoSurface *)wi.hwnd.info.window);
+					connect(widget,SIGNAL(windowDestroyed()),SLOT(onVideoPlaybackWidgetDestroyed()));
+					FVideoPlaybackWidgets.insertMulti(AMediaIndex,widget);
+					LOG_DEBUG(QString("SIP video playback widget created: call=%1, media=%2").arg(FCallIndex).arg(AMediaIndex));
+				}
+				else
+				{
+					LOG_ERROR(QString("Failed to create SIP video playback widget, call=%1, media=%2: Incompatible render device type (%3)").arg(FCallIndex).arg(AMediaIndex).arg(wi.hwnd.type));
+				}
+			}
+			else
+			{
+				LOG_ERROR(QString("Failed to create SIP video playback widget, call=%1, media=%2: Media stream window info not found").arg(FCallIndex).arg(AMediaIndex));
+			}
+		}
+		else
+		{
+			LOG_ERROR(QString("Failed to create SIP video playback widget, call=%1, media=%2: Invalid media index").arg(FCallIndex).arg(AMediaIndex));
+		}
+	}
+	else if (stream.index!=AMediaIndex)
+	{
+		LOG_ERROR(QString("Failed to create SIP video playback widget, call=%1, media=%2: Media stream not found").arg(FCallIndex).arg(AMediaIndex));
+	}
+	else
+	{
+		LOG_ERROR(QString("Failed to create SIP video playback widget, call=%1, media=%2: Invalid media stream").arg(FCallIndex).arg(AMediaIndex));
+	}
+	return widget;
+}
+
+void SipCall::initialize()
+{
+	FDestroyWaitTime = 0;
+	FDelayedDestroy = false;
+	FVideoAllowed = true;
+	FReplayMode = false;
+
+	FActive = 0;
+	FConfSlot = PJSUA_INVALID_ID;
+	FMediaStatus = PJSUA_CALL_MEDIA_NONE;
+	FMediaVersion = 0;
+
+	FFirstMediaTime = 0;
+	FFirstVideoFrameTime = 0;
+	for (int i=0; i<=Aborted; i++)
+		FStateTimes[i] = 0;
+
+	FMediaProbeTimer.setSingleShot(true);
+	FMediaProbeTimer.setInterval(MEDIA_PROBE_DELAY);
+	connect(&FMediaProbeTimer,SIGNAL(timeout()),SLOT(onMediaProbeTimerTimeout()));
+
+	for (int i=0; i<PJMEDIA_MAX_SDP_MEDIA; i++)
+	{
+		FMediaLevels[i].volume[0] = FMediaLevels[i].appliedVolume[0] = 1.0f;
+		FMediaLevels[i].volume[1] = FMediaLevels[i].appliedVolume[1] = 1.0f;
+	}
+
+	FMediaVolumeTimer.setSingleShot(true);
+	FMediaVolumeTimer.setInterval(MEDIA_VOLUME_DELAY);
+	connect(&FMediaVolumeTimer,SIGNAL(timeout()),SLOT(onMediaVolumeTimerTimeout()));
+
+	FTonegen = NULL;
+	FTonegenTimer.setSingleShot(true);
+	connect(&FTonegenTimer,SIGNAL(timeout()),SLOT(onTonegenTimerTimeout()));
+
+	FDtmfMethod = DtmfRfc2833;
+	FDtmfFallback = true;
+	FDtmfTimer.setSingleShot(true);
+	connect(&FDtmfTimer,SIGNAL(timeout()),SLOT(onDtmfTimerTimeout()));
+
+	connect(&FStatsTimer,SIGNAL(timeout()),SLOT(onStatsTimerTimeout()));
+
+	FVideoAdaptTimer.setInterval(VIDEO_ADAPT_INTERVAL);
+	connect(&FVideoAdaptTimer,SIGNAL(timeout()),SLOT(onVideoAdaptTimerTimeout()));
+}
+
+void SipCall::sendQueuedDtmf()
+{
+	while (!FDtmfQueue.isEmpty() && FCallIndex!=PJSUA_INVALID_ID)
+	{
+		QByteArray digits;
+		pj_status_t status;
+		switch (FDtmfMethod)
+		{
+		case DtmfRfc2833:
+			{
+				digits = FDtmfQueue.left(DTMF_CHUNK_SIZE);
+				pj_str_t str = pj_str(digits.data());
+				status = pjsua_call_dial_dtmf(FCallIndex,&str);
+			}
+			break;
+		case DtmfInfo:
+			digits = FDtmfQueue.left(1);
+			status = sendDtmfInfo(digits.at(0));
+			break;
+		default:
+			digits = FDtmfQueue.left(DTMF_CHUNK_SIZE);
+			status = sendDtmfInband(digits);
+		}
+
+		if (status == PJ_SUCCESS)
+		{
+			LOG_DEBUG(QString("DTMF digits sent '%1', call=%2, uri=%3, method=%4").arg(digits.constData()).arg(FCallIndex).arg(FRemoteUri).arg(FDtmfMethod));
+			FDtmfQueue.remove(0,digits.size());
+			FDtmfTimer.start(digits.size()*(DTMF_ON_MSEC+DTMF_OFF_MSEC));
+			emit dtmfSent(digits.constData());
+			return;
+		}
+		else if (status == PJ_ETOOMANY)
+		{
+			// Stream digit buffer is full, wait for previous digits to be transmitted
+			FDtmfTimer.start(DTMF_RETRY_DELAY);
+			return;
+		}
+		else if (FDtmfFallback)
+		{
+			LOG_INFO(QString("RFC 2833 DTMF is not available, falling back to SIP INFO, call=%1, uri=%2: %3").arg(FCallIndex).arg(FRemoteUri).arg(resolveSipError(status)));
+			FDtmfMethod = DtmfInfo;
+			FDtmfFallback = false;
+		}
+		else
+		{
+			LOG_ERROR(QString("Failed to send DTMF digits '%1', call=%2, uri=%3, method=%4: %5").arg(FDtmfQueue.constData()).arg(FCallIndex).arg(FRemoteUri).arg(FDtmfMethod).arg(resolveSipError(status)));
+			FDtmfQueue.clear();
+		}
+	}
+}
+
+pj_status_t SipCall::sendDtmfInfo(char ADigit)
+{
+	QByteArray body = QString("Signal=%1\r\nDuration=%2\r\n").arg(QChar::fromLatin1(ADigit)).arg(DTMF_ON_MSEC).toLatin1();
+
+	pjsua_msg_data md;
+	pjsua_msg_data_init(&md);
+	md.content_type = pj_str((char *)"application/dtmf-relay");
+	md.msg_body = pj_str(body.data());
+
+	pj_str_t method = pj_str((char *)"INFO");
+	return pjsua_call_send_request(FCallIndex,&method,&md);
+}
+
+pj_status_t SipCall::sendDtmfInband(const QByteArray &ADigits)
+{
+	pjmedia_tone_digit digits[DTMF_CHUNK_SIZE];
+	pj_bzero(digits, sizeof(digits));
+
+	int count = qMin(ADigits.size(),(int)PJ_ARRAY_SIZE(digits));
+	for (int i=0; i<count; i++) 
+	{
+		digits[i].digit = ADigits.at(i);
+		digits[i].on_msec = DTMF_ON_MSEC;
+		digits[i].off_msec = DTMF_OFF_MSEC;
+		digits[i].volume = 0;
+	}
+
+	// Shared generator is mixed by conference bridge only while digits are playing
+	if (FTonegen == NULL)
+	{
+		SipBridgeBypass::leave(FCallIndex);
+		FTonegen = SipTonegen::acquire();
+		if (FTonegen != NULL)
+		{
+			pjsua_conf_connect(FTonegen->confSlot(),SipAudioDevice::playbackSlot());
+			if (FConfSlot != PJSUA_INVALID_ID)
+				pjsua_conf_connect(FTonegen->confSlot(),FConfSlot);
+		}
+	}
+
+	pj_status_t status = PJ_ENOMEM;
+	if (FTonegen!=NULL && FTonegen->playDigits(digits,count,&status))
+		FTonegenTimer.start(count*(DTMF_ON_MSEC+DTMF_OFF_MSEC));
+	else if (FTonegen!=NULL && !FTonegen->isBusy())
+		releaseTonegen();
+	return status;
+}
+
+void SipCall::applyVideoLevel(int AMediaIndex)
+{
+	SipVideoLevel vl = SipVideoAdapter::videoLevel(FVideoAdapter.level());
+	LOG_INFO(QString("Applying video level, call=%1, media=%2, level=%3, size=%4x%5, fps=%6, bitrate=%7").arg(FCallIndex).arg(AMediaIndex).arg(FVideoAdapter.level()).arg(vl.width).arg(vl.height).arg(vl.fps).arg(vl.bitrate));
+
+	pj_status_t status = SipVideoAdapter::applyStreamParams(FCallIndex,AMediaIndex,vl);
+	if (status != PJ_SUCCESS)
+		LOG_WARNING(QString("Failed to change video encoder parameters, call=%1, media=%2: %3").arg(FCallIndex).arg(AMediaIndex).arg(resolveSipError(status)));
+
+	emit mediaChanged();
+}
+
+bool SipCall::isBridgeBypassAllowed() const
+{
+	if (FState!=Confirmed || FTonegen!=NULL || FCallIndex==PJSUA_INVALID_ID)
+		return false;
+
+	int audioCount = 0;
+	for (int index=0; index<FMediaInfo.count(); index++)
+	{
+		const SipEventMediaInfo &mi = FMediaInfo.at(index);
+		if (mi.type == PJMEDIA_TYPE_AUDIO)
+		{
+			const SipMediaStreamLevel &level = FMediaLevels[index];
+			if (mi.status!=PJSUA_CALL_MEDIA_ACTIVE || mi.dir!=PJMEDIA_DIR_ENCODING_DECODING || level.volume[0]!=1.0f || level.volume[1]!=1.0f)
+				return false;
+			audioCount++;
+		}
+	}
+	return audioCount == 1;
+}
+
+void SipCall::releaseTonegen()
+{
+	if (FTonegen != NULL)
+	{
+		FTonegenTimer.stop();
+		SipTonegen::release(FTonegen);
+		FTonegen = NULL;
+	}
+}
+
+void SipCall::setState(State AState, qint64 ATimestamp)
+{
+	if (FState < AState)
+	{
+		LOG_DEBUG(QString("Call state changed, state=%1, call=%2, uri=%3").arg(AState).arg(FCallIndex).arg(FRemoteUri));
+
+		FState = AState;
+		FStateTimes[AState] = ATimestamp>0 ? ATimestamp : sipEventTimestamp();
+
+		// Replayed calls must not be counted in call statistics
+		switch (FReplayMode ? ISipCall::Inited : AState)
+		{
+		case ISipCall::Connecting:
+			Logger::startTiming(STMP_SIPPHONE_CALL_NEGOTIATION,FRemoteUri);
+			if (FCallIndex != PJSUA_INVALID_ID)
+				FMediaProbeTimer.start();
+			break;
+		case ISipCall::Confirmed:
+			if (FCallIndex!=PJSUA_INVALID_ID && FFirstMediaTime==0 && !FMediaProbeTimer.isActive())
+				FMediaProbeTimer.start();
+			REPORT_TIMING(STMP_SIPPHONE_CALL_NEGOTIATION,Logger::finishTiming(STMP_SIPPHONE_CALL_NEGOTIATION,FRemoteUri));
+			Logger::startTiming(STMP_SIPPHONE_CALL_DURATION,FRemoteUri);
+			REPORT_EVENT(SEVP_SIPPHONE_CALL_SUCCESS,1);
+			break;
+		case Disconnected:
+			REPORT_TIMING(STMP_SIPPHONE_CALL_DURATION,Logger::finishTiming(STMP_SIPPHONE_CALL_DURATION,FRemoteUri));
+			Logger::finishTiming(STMP_SIPPHONE_CALL_NEGOTIATION,FRemoteUri);
+			break;
+		case Aborted:
+			Logger::finishTiming(STMP_SIPPHONE_CALL_NEGOTIATION,FRemoteUri);
+			Logger::finishTiming(STMP_SIPPHONE_CALL_DURATION,FRemoteUri);
+			REPORT_EVENT(SEVP_SIPPHONE_CALL_FAILURE,1);
+			break;
+		default:
+			break;
+		}
+
+		if (FState==Disconnected || FState==Aborted)
+		{
+			LOG_DEBUG(QString("Call setup latency, call=%1, ringing=%2, answered=%3, first-media=%4, first-video=%5, duration=%6").arg(FCallIndex).arg(setupLatency(SL_Ringing)).arg(setupLatency(SL_Answered)).arg(setupLatency(SL_FirstMedia)).arg(setupLatency(SL_FirstVideoFrame)).arg(durationTime()));
+
+			FActive = 0;
+			FMediaProbeTimer.stop();
+			FDtmfTimer.stop();
+			FDtmfQueue.clear();
+			FStatsTimer.stop();
+			FVideoAdaptTimer.stop();
+			releaseTonegen();
+			FCallIndex = PJSUA_INVALID_ID;
+
+			FMediaStreams.clear();
+			FMediaVersion++;
+			if (FDelayedDestroy)
+				destroyCall(0);
+		}
+
+		emit stateChanged();
+	}
+}
+
+void SipCall::setError(pj_status_t AStatus)
+{
+	if (FState != Aborted)
+	{
+		setStatus(PJSIP_SC_INTERNAL_SERVER_ERROR,resolveSipError(AStatus));
+		setState(Aborted);
+	}
+}
+
+bool SipCall::isErrorStatus(pjsip_status_code ACode)
+{
+	switch (ACode)
+	{
+	case PJSIP_SC_TRYING:
+	case PJSIP_SC_RINGING:
+	case PJSIP_SC_CALL_BEING_FORWARDED:
+	case PJSIP_SC_QUEUED:
+	case PJSIP_SC_PROGRESS:
+	case PJSIP_SC_OK:
+	case PJSIP_SC_ACCEPTED:
+	case PJSIP_SC_BUSY_HERE:
+	case PJSIP_SC_BUSY_EVERYWHERE:
+	case PJSIP_SC_DECLINE:
+		return false;
+	default:
+		return true;
+	}
+}
+
+void SipCall::setStatus(quint32 ACode, const QString &AText)
+{
+	if (FStatusCode != ACode)
+	{
+		FStatusCode = ACode;
+		FStatusText = AText;
+		LOG_DEBUG(QString("Call status changed, code=%1, message=%2, call=%3, uri=%4").arg(FStatusCode).arg(FStatusText).arg(FCallIndex).arg(FRemoteUri));
+		emit statusChanged();
+	}
+}
+
+QString SipCall::resolveSipError(int ACode) const
+{
+	char errmsg[PJ_ERR_MSG_SIZE];
+	pj_strerror(ACode, errmsg, sizeof(errmsg));
+	return QString(errmsg);
+}
+
+void SipCall::printCallDump(bool AWithMedia) const
+{
+	char buf[PJ_LOG_MAX_SIZE];
+	if (FCallIndex>=0 && pjsua_call_dump(FCallIndex,(AWithMedia ? PJ_TRUE : PJ_FALSE),buf,sizeof(buf)," ") == PJ_SUCCESS)
+	{
+		pjsua_call_info ci;
+		if (pjsua_call_get_info(FCallIndex,&ci) == PJ_SUCCESS)
+		{
+			unsigned pos = strlen(buf);
+			unsigned end= sizeof(buf);
+
+			buf[end--]='\0';
+			pos += pj_ansi_snprintf(buf+pos,end-pos," Call Info:\n");
+
+			pos += pj_ansi_snprintf(buf+pos,end-pos,
+				"   local_info=%s, local_contact=%s\n"
+				"   remote_info=%s, remote_contact=%s\n"
+				"   flags=%d, aud_cnt=%d, vid_cnt=%d, rem_aud=%d, rem_vid=%d\n"
+				"   media_status=%d, media_dir=%d, conf_slot=%d\n",
+				ci.local_info.ptr, ci.local_contact.ptr,
+				ci.remote_info.ptr, ci.remote_contact.ptr,
+				ci.setting.flag, ci.setting.aud_cnt, ci.setting.vid_cnt, ci.rem_aud_cnt, ci.rem_vid_cnt,
+				ci.media_status, ci.media_dir, ci.conf_slot);
+
+			if (AWithMedia)
+			{
+				pos += pj_ansi_snprintf(buf+pos,end-pos,"   media_cnt=%d\n",ci.media_cnt);
+				for (unsigned i=0; i<ci.media_cnt; i++)
+				{
+					pjsua_call_media_info *mi = &ci.media[i];
+
+					pos += pj_ansi_snprintf(buf+pos,end-pos,
+						"     #%d type=%d, dir=%d, status=%d\n",
+						mi->index, mi->type, mi->dir, mi->status);
+				}
+
+				pos += pj_ansi_snprintf(buf+pos,end-pos,"   prov_media_cnt=%d\n",ci.prov_media_cnt);
+				for (unsigned i=0; i<ci.prov_media_cnt; i++)
+				{
+					pjsua_call_media_info *mi = &ci.prov_media[i];
+
+					pos += pj_ansi_snprintf(buf+pos,end-pos,
+						"     #%d type=%d, dir=%d, status=%d\n",
+						mi->index, mi->type, mi->dir, mi->status);
+				}
+			}
+		}
+
+		LOG_DEBUG(QString("Call dump, call=%1\n%2").arg(FCallIndex).arg(buf));
+	}
+}
+
+void SipCall::fillCallInfo(const pjsua_call_info &AInfo, SipEventCallInfo *AEvent) const
+{
+	AEvent->active = pjsua_call_is_active(AInfo.id);
+	AEvent->timestamp = sipEventTimestamp();
+	AEvent->confSlot = AInfo.conf_slot;
+	AEvent->mediaStatus = AInfo.media_status;
+	AEvent->mediaCount = qMin(AInfo.media_cnt,(unsigned)PJ_ARRAY_SIZE(AEvent->media));
+	for (unsigned index=0; index<AEvent->mediaCount; index++)
+	{
+		const pjsua_call_media_info &cmi = AInfo.media[index];
+		SipEventMediaInfo &mi = AEvent->media[index];
+		mi.type = cmi.type;
+		mi.dir = cmi.dir;
+		mi.status = cmi.status;
+		mi.confSlot = cmi.type==PJMEDIA_TYPE_AUDIO ? cmi.stream.aud.conf_slot : PJSUA_INVALID_ID;
+		mi.videoWindow = cmi.type==PJMEDIA_TYPE_VIDEO ? cmi.stream.vid.win_in : PJSUA_INVALID_ID;
+		mi.captureDev = cmi.type==PJMEDIA_TYPE_VIDEO ? cmi.stream.vid.cap_dev : PJMEDIA_VID_INVALID_DEV;
+	}
+}
+
+void SipCall::updateCallInfo(const SipEventCallInfo *AInfo)
+{
+	FConfSlot = AInfo->confSlot;
+	FMediaStatus = AInfo->mediaStatus;
+
+	// Detached calls have no pjsua callbacks to track activity
+	if (FCallIndex == PJSUA_INVALID_ID)
+		FActive = AInfo->active ? 1 : 0;
+
+	// Renegotiated media gets new conference port or stream with default levels
+	for (unsigned index=0; index<AInfo->mediaCount && index<PJMEDIA_MAX_SDP_MEDIA; index++)
+	{
+		const SipEventMediaInfo &mi = AInfo->media[index];
+		const SipEventMediaInfo *old = (int)index<FMediaInfo.count() ? &FMediaInfo.at(index) : NULL;
+		if (old==NULL || old->type!=mi.type || old->confSlot!=mi.confSlot || (old->status==PJSUA_CALL_MEDIA_NONE && mi.status!=PJSUA_CALL_MEDIA_NONE))
+		{
+			FMediaLevels[index].volume[0] = FMediaLevels[index].appliedVolume[0] = 1.0f;
+			FMediaLevels[index].volume[1] = FMediaLevels[index].appliedVolume[1] = 1.0f;
+		}
+	}
+
+	FMediaInfo.resize(AInfo->mediaCount);
+	for (unsigned index=0; index<AInfo->mediaCount; index++)
+		FMediaInfo[index] = AInfo->media[index];
+}
+
+void SipCall::updateMediaStreams()
+{
+	FMediaStreams.clear();
+	for (int index = 0; index<FMediaInfo.count(); index++)
+	{
+		ISipMediaStream stream;
+		const SipEventMediaInfo &mi = FMediaInfo.at(index);
+		switch (mi.type)
+		{
+		case PJMEDIA_TYPE_AUDIO:
+			stream.type = ISipMedia::Audio;
+			break;
+		case PJMEDIA_TYPE_VIDEO:
+			stream.type = ISipMedia::Video;
+			break;
+		default:
+			stream.type = ISipMedia::Unknown;
+		}
+
+		switch(mi.dir)
+		{
+		case PJMEDIA_DIR_CAPTURE:
+			stream.dir = ISipMedia::Capture;
+			break;
+		case PJMEDIA_DIR_PLAYBACK:
+			stream.dir = ISipMedia::Playback;
+			break;
+		case PJMEDIA_DIR_CAPTURE_PLAYBACK:
+			stream.dir = ISipMedia::CaptureAndPlayback;
+			break;
+		default:
+			stream.dir = ISipMedia::None;
+		}
+
+		stream.index = index;
+		stream.state = (ISipMediaStream::State)mi.status;
+
+		pjsua_stream_info si;
+		if (FCallIndex!=PJSUA_INVALID_ID && mi.dir!=PJMEDIA_DIR_NONE && pjsua_call_get_stream_info(FCallIndex,index,&si)==PJ_SUCCESS)
+		{
+			if (si.type == PJMEDIA_TYPE_AUDIO)
+			{
+				stream.format.type = ISipMedia::Audio;
+				stream.format.details.aud.clockRate = si.info.aud.param->info.clock_rate;
+				stream.format.details.aud.channelCount = si.info.aud.param->info.channel_cnt;
+				stream.format.details.aud.frameTimeUsec = si.info.aud.param->info.frm_ptime;
+				stream.format.details.aud.bitsPerSample = si.info.aud.param->info.pcm_bits_per_sample;
+				stream.format.details.aud.avgBitrate = si.info.aud.param->info.avg_bps;
+				stream.format.details.aud.maxBitrate = si.info.aud.param->info.max_bps;
+				stream.format.details.aud.packetTimeMsec = si.info.aud.param->info.frm_ptime*si.info.aud.param->setting.frm_per_pkt;
+				stream.format.details.aud.vadEnabled = si.info.aud.param->setting.vad!=0;
+				stream.format.details.aud.plcEnabled = si.info.aud.param->setting.plc!=0;
+				stream.format.details.aud.cngEnabled = si.info.aud.param->setting.cng!=0;
+				stream.format.details.aud.fecEnabled = false;
+				stream.format.details.aud.complexity = -1;
+				stream.format.details.aud.encoderBitrate = 0;
+				stream.format.details.aud.packetLossPercent = 0;
+#if defined(PJMEDIA_HAS_OPUS_CODEC) && PJMEDIA_HAS_OPUS_CODEC!=0
+				if (pj_stricmp2(&si.info.aud.fmt.encoding_name,"opus") == 0)
+				{
+					// Opus in-band FEC follows codec PLC setting, encoder tuning is taken from codec config
+					pjmedia_codec_opus_config opus;
+					if (pjmedia_codec_opus_get_config(&opus) == PJ_SUCCESS)
+					{
+						stream.format.details.aud.complexity = opus.complexity;
+						stream.format.details.aud.encoderBitrate = opus.bit_rate;
+						stream.format.details.aud.packetLossPercent = opus.packet_loss;
+					}
+					stream.format.details.aud.fecEnabled = si.info.aud.param->setting.plc!=0;
+				}
+#endif
+			}
+			else if (si.type == PJMEDIA_TYPE_VIDEO)
+			{
+				if (si.info.vid.codec_param->dir == PJMEDIA_DIR_ENCODING)
+				{
+					stream.format.type = ISipMedia::Video;
+					stream.format.details.vid.fpsNum = si.info.vid.codec_param->enc_fmt.det.vid.fps.num;
+					stream.format.details.vid.fpsDenum = si.info.vid.codec_param->enc_fmt.det.vid.fps.denum;
+					stream.format.details.vid.avgBitrate = si.info.vid.codec_param->enc_fmt.det.vid.avg_bps;
+					stream.format.details.vid.maxBitrate = si.info.vid.codec_param->enc_fmt.det.vid.max_bps;
+					stream.format.details.vid.width = si.info.vid.codec_param->enc_fmt.det.vid.size.w;
+					stream.format.details.vid.height = si.info.vid.codec_param->enc_fmt.det.vid.size.h;
+				}
+				else if (si.info.vid.codec_param->dir == PJMEDIA_DIR_DECODING)
+				{
+					stream.format.type = ISipMedia::Video;
+					stream.format.details.vid.fpsNum = si.info.vid.codec_param->dec_fmt.det.vid.fps.num;
+					stream.format.details.vid.fpsDenum = si.info.vid.codec_param->dec_fmt.det.vid.fps.denum;
+					stream.format.details.vid.avgBitrate = si.info.vid.codec_param->dec_fmt.det.vid.avg_bps;
+					stream.format.details.vid.maxBitrate = si.info.vid.codec_param->dec_fmt.det.vid.max_bps;
+					stream.format.details.vid.width = si.info.vid.codec_param->dec_fmt.det.vid.size.w;
+					stream.format.details.vid.height = si.info.vid.codec_param->dec_fmt.det.vid.size.h;
+				}
+			}
+		}
+
+		FMediaStreams.append(stream);
+	}
+	FMediaVersion++;
+}
+
+void SipCall::updateVideoPlaybackWidgets(const QList<int> &AMediaIndexes)
+{
+	if (!FVideoPlaybackWidgets.isEmpty())
+	{
+		foreach(int mediaIndex, AMediaIndexes)
+		{
+			pjsua_vid_win_id winId = mediaIndex<FMediaInfo.count() ? FMediaInfo.at(mediaIndex).videoWindow : PJSUA_INVALID_ID;
+			foreach(VideoWindow *widget, FVideoPlaybackWidgets.values(mediaIndex))
+			{
+				if (FCallIndex!=PJSUA_INVALID_ID && winId!=PJSUA_INVALID_ID)
+				{
+					pjsua_vid_win_info wi;
+					if (pjsua_vid_win_get_info(winId,&wi)==PJ_SUCCESS && wi.hwnd.type==QT_RENDER_VID_DEV_TYPE)
+						widget->setSurface((VideoSurface *)wi.hwnd.info.window);
+					else
+						widget->setSurface(NULL);
+				}
+				else
+				{
+					widget->setSurface(NULL);
+				}
+			}
+		}
+	}
+}
+
+void SipCall::processSipEvent(SipEvent *AEvent)
+{
+	if (FCallIndex != PJSUA_INVALID_ID)
+		SipEventTrace::recordEvent(FCallIndex,AEvent);
+
+	switch (AEvent->type)
+	{
+	case SipEvent::CallState:
+		{
+			SipEventCallState *se = static_cast<SipEventCallState *>(AEvent);
+
+			updateCallInfo(se);
+			FDestroyWaitTime = se->destroyWaitTime;
+			setStatus(se->status,pjsip_get_status_text(se->status)->ptr);
+
+			switch (se->state)
+			{
+			case PJSIP_INV_STATE_NULL:
+				setState(Inited,se->timestamp);
+				break;
+			case PJSIP_INV_STATE_CALLING:
+			case PJSIP_INV_STATE_INCOMING:
+				setState(Calling,se->timestamp);
+				break;
+			case PJSIP_INV_STATE_EARLY:
+				setState(Ringing,se->timestamp);
+				break;
+			case PJSIP_INV_STATE_CONNECTING:
+				setState(Connecting,se->timestamp);
+				break;
+			case PJSIP_INV_STATE_CONFIRMED:
+				setState(Confirmed,se->timestamp);
+				break;
+			case PJSIP_INV_STATE_DISCONNECTED:
+				setState(isErrorStatus(se->status) ? Aborted : Disconnected,se->timestamp);
+				break;
+			default:
+				break;
+			};
+			delete se;
+		}
+		break;
+	case SipEvent::CallMediaState:
+		{
+			SipEventCallMediaState *se = static_cast<SipEventCallMediaState *>(AEvent);
+			updateCallInfo(se);
+			switch (se->mediaStatus)
+			{
+			case PJSUA_CALL_MEDIA_ACTIVE:
+				if (FCallIndex != PJSUA_INVALID_ID)
+				{
+					pjsua_conf_connect(se->confSlot,SipAudioDevice::playbackSlot());
+					pjsua_conf_connect(SipAudioDevice::captureSlot(),se->confSlot);
+					if (FTonegen != NULL)
+						pjsua_conf_connect(FTonegen->confSlot(),se->confSlot);
+
+					// Video adaptation samples statistics on its own fixed interval
+					for (int index=0; SipVideoAdapter::isStreamParamsSupported() && FVideoAdapter.level()>=0 && !FVideoAdaptTimer.isActive() && index<FMediaInfo.count(); index++)
+					{
+						const SipEventMediaInfo &mi = FMediaInfo.at(index);
+						if (mi.type==PJMEDIA_TYPE_VIDEO && mi.status==PJSUA_CALL_MEDIA_ACTIVE && (mi.dir & PJMEDIA_DIR_ENCODING)>0)
+							FVideoAdaptTimer.start();
+					}
+				}
+				break;
+			case PJSUA_CALL_MEDIA_ERROR:
+				{
+					if (isActive() && FCallIndex!=PJSUA_INVALID_ID)
+					{
+						pj_str_t reason = pj_str((char *)"ICE negotiation failed");
+						pjsua_call_hangup(FCallIndex,PJSIP_SC_INTERNAL_SERVER_ERROR,&reason,NULL);
+					}
+				}
+				break;
+			default:
+				break;
+			}
+			delete se;
+
+			updateMediaStreams();
+			updateVideoPlaybackWidgets(FVideoPlaybackWidgets.keys());
+			emit mediaChanged();
+		}
+		break;
+	case SipEvent::CallMediaFormat:
+		{
+			SipEventCallMediaFormat *se = static_cast<SipEventCallMediaFormat *>(AEvent);
+			int mediaIndex = se->mediaIndex;
+			if (FFirstVideoFrameTime==0 && (se->eventType==PJMEDIA_EVENT_KEYFRAME_FOUND || (se->eventType==PJMEDIA_EVENT_FMT_CHANGED && (se->dir & PJMEDIA_DIR_DECODING)>0)))
+				FFirstVideoFrameTime = se->timestamp;
+			switch (se->eventType)
+			{
+			case PJMEDIA_EVENT_FMT_CHANGED:
+				{
+					if (mediaIndex<FMediaStreams.count() && se->format.type==PJMEDIA_TYPE_VIDEO)
+					{
+						ISipMediaFormat &format = FMediaStreams[mediaIndex].format;
+						format.type = ISipMedia::Video;
+						format.details.vid.fpsNum = se->format.det.vid.fps.num;
+						format.details.vid.fpsDenum = se->format.det.vid.fps.denum;
+						format.details.vid.width = se->format.det.vid.size.w;
+						format.details.vid.height = se->format.det.vid.size.h;
+						FMediaVersion++;
+					}
+					LOG_DEBUG(QString("SIP media format changed, call=%1, media=%2, dir=%3, size=%4x%5").arg(FCallIndex).arg(mediaIndex).arg(se->dir).arg(se->format.det.vid.size.w).arg(se->format.det.vid.size.h));
+					updateVideoPlaybackWidgets(QList<int>() << mediaIndex);
+					emit mediaFormatChanged(mediaIndex);
+				}
+				break;
+			case PJMEDIA_EVENT_KEYFRAME_FOUND:
+				emit mediaKeyframeChanged(mediaIndex,true);
+				break;
+			case PJMEDIA_EVENT_KEYFRAME_MISSING:
+				LOG_DEBUG(QString("SIP media keyframe missing, call=%1, media=%2").arg(FCallIndex).arg(mediaIndex));
+				emit mediaKeyframeChanged(mediaIndex,false);
+				break;
+#if PJ_VERSION_NUM >= 0x02080000
+			case PJMEDIA_EVENT_RX_RTCP_FB:
+				emit mediaRtcpFeedbackReceived(mediaIndex);
+				break;
+#endif
+			default:
+				break;
+			}
+			delete se;
+		}
+		break;
+	case SipEvent::CallDtmfDigit:
+		{
+			SipEventCallDtmfDigit *se = static_cast<SipEventCallDtmfDigit *>(AEvent);
+			LOG_DEBUG(QString("DTMF digit received '%1', call=%2, uri=%3").arg(QChar::fromLatin1(se->digit)).arg(FCallIndex).arg(FRemoteUri));
+			emit dtmfReceived((char)se->digit);
+			delete se;
+		}
+		break;
+	case SipEvent::Error:
+		{
+			SipEventError *se = static_cast<SipEventError *>(AEvent);
+			setError(se->error);
+			delete se;
+		}
+		break;
+	default:
+		REPORT_ERROR(QString("Received unexpected SIP event, call=%1, uri=%2, type=%3").arg(FCallIndex).arg(FRemoteUri).arg(AEvent->type));
+		delete AEvent;
+	}
+}
+
+void SipCall::onVideoPlaybackWidgetDestroyed()
+{
+	VideoWindow *widget = qobject_cast<VideoWindow *>(sender());
+	if (widget)
+	{
+		int mediaIndex = FVideoPlaybackWidgets.key(widget);
+		FVideoPlaybackWidgets.remove(mediaIndex,widget);
+		LOG_DEBUG(QString("Video playback widget destroyed: call=%1, uri=%2, media=%3").arg(FCallIndex).arg(FRemoteUri).arg(mediaIndex));
+	}
+}
+
+void SipCall::onMediaProbeTimerTimeout()
+{
+	if (FFirstMediaTime==0 && isActive() && FCallIndex!=PJSUA_INVALID_ID)
+	{
+		for (int index=0; FFirstMediaTime==0 && index<FMediaInfo.count(); index++)
+		{
+			pjsua_stream_stat stat;
+			if (FMediaInfo.at(index).status==PJSUA_CALL_MEDIA_ACTIVE && pjsua_call_get_stream_stat(FCallIndex,index,&stat)==PJ_SUCCESS && stat.rtcp.rx.pkt>0)
+				FFirstMediaTime = sipEventTimestamp();
+		}
+
+		if (FFirstMediaTime > 0)
+			LOG_DEBUG(QString("First RTP packet received, call=%1, latency=%2").arg(FCallIndex).arg(setupLatency(SL_FirstMedia)));
+		else if (sipEventTimestamp()-qMax(FStateTimes[Connecting],FStateTimes[Confirmed]) < MEDIA_PROBE_TIMEOUT)
+			FMediaProbeTimer.start();
+	}
+}
+
+void SipCall::onTonegenTimerTimeout()
+{
+	if (FTonegen!=NULL && FTonegen->isBusy())
+		FTonegenTimer.start(TONEGEN_CHECK_DELAY);
+	else
+		releaseTonegen();
+}
+
+void SipCall::onStatsTimerTimeout()
+{
+	if (FStatsRings.count() != FMediaInfo.count())
+	{
+		int oldCount = FStatsRings.count();
+		FStatsRings.resize(FMediaInfo.count());
+		for (int index=oldCount; index<FStatsRings.count(); index++)
+			FStatsRings[index].head = FStatsRings[index].count = 0;
+	}
+
+	for (int index=0; index<FMediaInfo.count(); index++)
+	{
+		const SipEventMediaInfo &mi = FMediaInfo.at(index);
+		if (mi.status == PJSUA_CALL_MEDIA_ACTIVE)
+		{
+			ISipMediaStats stats = mediaStats(index);
+			if (stats.index == index)
+			{
+				SipMediaStatsRing &ring = FStatsRings[index];
+				ring.samples[ring.head] = stats;
+				ring.head = (ring.head+1) % MEDIA_STATS_RING_SIZE;
+				ring.count = qMin(ring.count+1,MEDIA_STATS_RING_SIZE);
+				emit mediaStatsSampled(index);
+			}
+		}
+	}
+}
+
+void SipCall::onVideoAdaptTimerTimeout()
+{
+	for (int index=0; index<FMediaInfo.count(); index++)
+	{
+		const SipEventMediaInfo &mi = FMediaInfo.at(index);
+		if (mi.type==PJMEDIA_TYPE_VIDEO && mi.status==PJSUA_CALL_MEDIA_ACTIVE && (mi.dir & PJMEDIA_DIR_ENCODING)>0)
+		{
+			ISipMediaStats stats = mediaStats(index);
+			if (stats.index==index && FVideoAdapter.processSample(stats))
+				applyVideoLevel(index);
+			break;
+		}
+	}
+}
+
+void SipCall::onDtmfTimerTimeout()
+{
+	sendQueuedDtmf();
+}
+
+void SipCall::onMediaVolumeTimerTimeout()
+{
+	if (isActive() && FCallIndex!=PJSUA_INVALID_ID)
+	{
+		bool changed = false;
+		for (int index=0; index<FMediaInfo.count(); index++)
+		{
+			const SipEventMediaInfo &mi = FMediaInfo.at(index);
+			SipMediaStreamLevel &level = FMediaLevels[index];
+			if (mi.type==PJMEDIA_TYPE_AUDIO && mi.confSlot!=PJSUA_INVALID_ID)
+			{
+				for (int i=0; i<2; i++)
+				{
+					if (level.volume[i] != level.appliedVolume[i])
+					{
+						pj_status_t status = i==0 ? pjsua_conf_adjust_tx_level(mi.confSlot,level.volume[i]) : pjsua_conf_adjust_rx_level(mi.confSlot,level.volume[i]);
+						if (status == PJ_SUCCESS)
+						{
+							LOG_DEBUG(QString("SIP media stream volume changed, call=%1, media=%2, dir=%3, volume=%4").arg(FCallIndex).arg(index).arg(i==0 ? PJMEDIA_DIR_CAPTURE : PJMEDIA_DIR_PLAYBACK).arg(level.volume[i]));
+							level.appliedVolume[i] = level.volume[i];
+							changed = true;
+						}
+						else
+						{
+							LOG_ERROR(QString("Failed to change SIP media stream volume, call=%1, media=%2, dir=%3, volume=%4: %5").arg(FCallIndex).arg(index).arg(i==0 ? PJMEDIA_DIR_CAPTURE : PJMEDIA_DIR_PLAYBACK).arg(level.volume[i]).arg(resolveSipError(status)));
+							level.volume[i] = level.appliedVolume[i];
+						}
+					}
+				}
+			}
+		}
+		if (changed)
+			emit mediaChanged();
+	}
+}
+
+void SipCall::pjcbOnCallState()
+{
+	pjsua_call_info ci;
+	pj_status_t status = pjsua_call_get_info(FCallIndex,&ci);
+
+	printCallDump(true);
+
+	if (status == PJ_SUCCESS)
+	{
+		SipEventCallState *se = new SipEventCallState;
+		se->type = SipEvent::CallState;
+		fillCallInfo(ci,se);
+		FActive = se->active ? 1 : 0;
+		se->state = ci.state;
+		se->status = ci.last_status;
+		se->destroyWaitTime = ci.media_status!=PJSUA_CALL_MEDIA_NONE ? se->timestamp+CLOSE_MEDIA_DELAY : 0;
+		QMetaObject::invokeMethod(this,"processSipEvent",Qt::QueuedConnection,Q_ARG(SipEvent *,se));
+	}
+	else
+	{
+		SipEventError *se = new SipEventError;
+		se->type = SipEvent::Error;
+		se->error = status;
+		QMetaObject::invokeMethod(this,"processSipEvent",Qt::QueuedConnection,Q_ARG(SipEvent *,se));
+	}
+	
+	FEventWait.wakeAll();
+}
+
+void SipCall::pjcbOnCallMediaState()
+{
+	pjsua_call_info ci;
+	pj_status_t status = pjsua_call_get_info(FCallIndex, &ci);
+
+	printCallDump(true);
+
+	if (status == PJ_SUCCESS)
+	{
+		SipEventCallMediaState *se = new SipEventCallMediaState;
+		se->type = SipEvent::CallMediaState;
+		fillCallInfo(ci,se);
+		QMetaObject::invokeMethod(this,"processSipEvent",Qt::QueuedConnection,Q_ARG(SipEvent *,se));
+	}
+	else
+	{
+		SipEventError *se = new SipEventError;
+		se->type = SipEvent::Error;
+		se->error = status;
+		QMetaObject::invokeMethod(this,"processSipEvent",Qt::QueuedConnection,Q_ARG(SipEvent *,se));
+	}
+
+	FEventWait.wakeAll();
+}
+
+void SipCall::pjcbOnCallMediaEvent(unsigned AMediaIndex, pjmedia_event *AEvent)
+{
+	switch (AEvent->type)
+	{
+	case PJMEDIA_EVENT_FMT_CHANGED:
+	case PJMEDIA_EVENT_KEYFRAME_FOUND:
+	case PJMEDIA_EVENT_KEYFRAME_MISSING:
+#if PJ_VERSION_NUM >= 0x02080000
+	case PJMEDIA_EVENT_RX_RTCP_FB:
+#endif
+		{
+			SipEventCallMediaFormat *se = new SipEventCallMediaFormat;
+			se->type = SipEvent::CallMediaFormat;
+			se->timestamp = sipEventTimestamp();
+			se->mediaIndex = AMediaIndex;
+			se->eventType = AEvent->type;
+			if (AEvent->type == PJMEDIA_EVENT_FMT_CHANGED)
+			{
+				se->dir = AEvent->data.fmt_changed.dir;
+				pjmedia_format_copy(&se->format,&AEvent->data.fmt_changed.new_fmt);
+			}
+			else
+			{
+				se->dir = PJMEDIA_DIR_NONE;
+				pj_bzero(&se->format,sizeof(se->format));
+			}
+			QMetaObject::invokeMethod(this,"processSipEvent",Qt::QueuedConnection,Q_ARG(SipEvent *,se));
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+void SipCall::pjcbOnDtmfDigit(int ADigit)
+{
+	SipEventCallDtmfDigit *se = new SipEventCallDtmfDigit;
+	se->type = SipEvent::CallDtmfDigit;
+	se->digit = ADigit;
+	QMetaObject::invokeMethod(this,"processSipEvent",Qt::QueuedConnection,Q_ARG(SipEvent *,se));
+}
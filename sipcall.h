@@ -1,93 +1,182 @@
-#ifndef SIPCALL_H
-#define SIPCALL_H
-
-#include <QMutex>
-#include <QWaitCondition>
-#include <interfaces/isipphone.h>
-#include "sipevent.h"
-#include "renderdev.h"
-
-class SipCall : 
-	public QObject,
-	public ISipCall
-{
-	Q_OBJECT;
-	Q_INTERFACES(ISipCall);
-	friend class SipPhone;
-public:
-	SipCall(const QUuid &AAccountId, pjsua_acc_id AAccIndex, const QString &ARemoteUri, QObject *AParent);
-	SipCall(const QUuid &AAccountId, pjsua_acc_id AAccIndex, pjsua_call_id ACallIndex, QObject *AParent);
-	~SipCall();
-	virtual QObject *instance() { return this; }
-	// Call
-	virtual QUuid accountId() const;
-	virtual QString remoteUri() const;
-	virtual bool isActive() const;
-	virtual Role role() const;
-	virtual State state() const;
-	virtual quint32 statusCode() const;
-	virtual QString statusText() const;
-	virtual quint32 durationTime() const;
-	virtual bool sendDtmf(const char *ADigits);
-	virtual bool startCall(bool AWithVideo = false);
-	virtual bool hangupCall(quint32 AStatusCode=SC_Decline, const QString &AText=QString::null);
-	virtual bool destroyCall(unsigned long AWaitForDisconnected = ULONG_MAX);
-	// Media
-	virtual bool hasActiveMediaStream() const;
-	virtual ISipMediaStream findMediaStream(int AMediaIndex) const;
-	virtual QList<ISipMediaStream> mediaStreams(ISipMedia::Type AType=ISipMedia::Null) const;
-	virtual QVariant mediaStreamProperty(int AMediaIndex, ISipMedia::Direction ADir, ISipMediaStream::Property AProperty) const;
-	virtual bool setMediaStreamProperty(int AMediaIndex, ISipMedia::Direction ADir, ISipMediaStream::Property AProperty, const QVariant &AValue);
-	virtual QWidget *getVideoPlaybackWidget(int AMediaIndex, QWidget *AParent);
-signals:
-	// Call
-	void stateChanged();
-	void statusChanged();
-	void mediaChanged();
-	void callDestroyed();
-	void dtmfSent(const char *ADigits);
-protected:
-	void initialize();
-	void initTonegen();
-	void setState(State AState);
-	void setError(pj_status_t AStatus);
-	bool isErrorStatus(pjsip_status_code ACode);
-	void setStatus(quint32 ACode, const QString &AText);
+#ifndef SIPCALL_H
+#define SIPCALL_H
+
+#include <QTimer>
+#include <QMutex>
+#include <QVector>
+#include <QAtomicInt>
+#include <QWaitCondition>
+#include <interfaces/isipphone.h>
+#include "sipevent.h"
+#include "renderdev.h"
+#include "siptonegen.h"
+#include "sipvideoadapter.h"
+
+#define MEDIA_STATS_RING_SIZE    60
+
+struct SipMediaStatsRing
+{
+	int head;
+	int count;
+	ISipMediaStats samples[MEDIA_STATS_RING_SIZE];
+};
+
+struct SipMediaStreamLevel
+{
+	float volume[2];         // requested level, capture and playback
+	float appliedVolume[2];  // level set in conference bridge
+};
+
+class SipCall : 
+	public QObject,
+	public ISipCall
+{
+	Q_OBJECT;
+	Q_INTERFACES(ISipCall);
+	friend class SipPhone;
+	friend class SipEventReplay;
+	friend class SipConference;
+public:
+	SipCall(const QUuid &AAccountId, pjsua_acc_id AAccIndex, const QString &ARemoteUri, QObject *AParent);
+	SipCall(const QUuid &AAccountId, pjsua_acc_id AAccIndex, pjsua_call_id ACallIndex, QObject *AParent);
+	~SipCall();
+	virtual QObject *instance() { return this; }
+	// Call
+	virtual QUuid accountId() const;
+	virtual QString remoteUri() const;
+	virtual bool isActive() const;
+	virtual Role role() const;
+	virtual bool isVideoAllowed() const;
+	virtual State state() const;
+	virtual quint32 statusCode() const;
+	virtual QString statusText() const;
+	virtual quint32 durationTime() const;
+	virtual qint64 setupLatency(SetupLatency ALatency) const;
+	virtual bool sendDtmf(const char *ADigits);
+	virtual bool startCall(bool AWithVideo = false);
+	virtual bool hangupCall(quint32 AStatusCode=SC_Decline, const QString &AText=QString::null);
+	virtual bool destroyCall(unsigned long AWaitForDisconnected = ULONG_MAX);
+	// Media
+	virtual bool hasActiveMediaStream() const;
+	virtual ISipMediaStream findMediaStream(int AMediaIndex) const;
+	virtual QList<ISipMediaStream> mediaStreams(ISipMedia::Type AType=ISipMedia::Null) const;
+	virtual quint32 mediaVersion() const;
+	virtual QVariant mediaStreamProperty(int AMediaIndex, ISipMedia::Direction ADir, ISipMediaStream::Property AProperty) const;
+	virtual bool setMediaStreamProperty(int AMediaIndex, ISipMedia::Direction ADir, ISipMediaStream::Property AProperty, const QVariant &AValue);
+	virtual bool isMediaStreamEnabled(int AMediaIndex, ISipMedia::Direction ADir) const;
+	virtual bool setMediaStreamEnabled(int AMediaIndex, ISipMedia::Direction ADir, bool AEnabled);
+	virtual float mediaStreamVolume(int AMediaIndex, ISipMedia::Direction ADir) const;
+	virtual bool setMediaStreamVolume(int AMediaIndex, ISipMedia::Direction ADir, float AVolume);
+	virtual QWidget *getVideoPlaybackWidget(int AMediaIndex, QWidget *AParent);
+	// Statistics
+	virtual ISipMediaStats mediaStats(int AMediaIndex) const;
+	virtual qint64 audioDelay() const;
+	virtual int mediaStatsHistory(int AMediaIndex, ISipMediaStats *ASamples, int ACount) const;
+	virtual int statsSamplingInterval() const;
+	virtual void setStatsSamplingInterval(int AMsecs);
+signals:
+	// Call
+	void stateChanged();
+	void statusChanged();
+	void mediaChanged();
+	void mediaFormatChanged(int AMediaIndex);
+	void mediaKeyframeChanged(int AMediaIndex, bool AFound);
+	void mediaRtcpFeedbackReceived(int AMediaIndex);
+	void mediaStatsSampled(int AMediaIndex);
+	void callDestroyed();
+	void dtmfSent(const char *ADigits);
+	void dtmfReceived(char ADigit);
+protected:
+	void initialize();
+	void releaseTonegen();
+	bool isBridgeBypassAllowed() const;
+	void applyVideoLevel(int AMediaIndex);
+	void sendQueuedDtmf();
+	pj_status_t sendDtmfInfo(char ADigit);
+	pj_status_t sendDtmfInband(const QByteArray &ADigits);
+	void setState(State AState, qint64 ATimestamp = 0);
+	void setError(pj_status_t AStatus);
+	bool isErrorStatus(pjsip_status_code ACode);
+	void setStatus(quint32 ACode, const QString &AText);
 	QString resolveSipError(int ACode) const;
-	void printCallDump(bool AWithMedia) const;
-	void updateVideoPlaybackWidgets(const QList<int> &AMediaIndexes);
-protected slots:
-	void processSipEvent(SipEvent *AEvent);
-protected slots:
-	void onVideoPlaybackWidgetDestroyed();
-protected:
-	void pjcbOnCallState();
-	void pjcbOnCallMediaState();
-	void pjcbOnCallMediaEvent(unsigned AMediaIndex, pjmedia_event *AEvent);
-	inline pjsua_call_id callIndex() const { return FCallIndex; }
-	inline pjsua_acc_id accountIndex() const { return FAccIndex; }
-private:
-	Role FRole;
-	State FState;
-	QUuid FAccountId;
-	QString FRemoteUri;
-	quint32 FStatusCode;
-	QString FStatusText;
-	bool FDelayedDestroy;
-	qint64 FDestroyWaitTime;
-	quint32 FTotalDurationTime;
-private:
-	pjsua_acc_id FAccIndex;
-	pjsua_call_id FCallIndex;
-	mutable QMutex FDestroyLock;
-	mutable QWaitCondition FEventWait;
-private:
-	pj_pool_t *FTonegenPool;
-	pjmedia_port *FTonegenPort;
-	pjsua_conf_port_id FTonegenSlot;
-private:
-	QMultiMap<int, VideoWindow *> FVideoPlaybackWidgets;
-	QMap<int, QMap<ISipMedia::Direction, QMap<ISipMediaStream::Property,QVariant> > > FStreamProperties;
-};
-
-#endif // SIPCALL_H
+	void printCallDump(bool AWithMedia) const;
+	void fillCallInfo(const pjsua_call_info &AInfo, SipEventCallInfo *AEvent) const;
+	void updateCallInfo(const SipEventCallInfo *AInfo);
+	void updateMediaStreams();
+	void updateVideoPlaybackWidgets(const QList<int> &AMediaIndexes);
+protected slots:
+	void processSipEvent(SipEvent *AEvent);
+protected slots:
+	void onVideoPlaybackWidgetDestroyed();
+	void onMediaVolumeTimerTimeout();
+	void onMediaProbeTimerTimeout();
+	void onTonegenTimerTimeout();
+	void onDtmfTimerTimeout();
+	void onStatsTimerTimeout();
+	void onVideoAdaptTimerTimeout();
+protected:
+	void pjcbOnCallState();
+	void pjcbOnCallMediaState();
+	void pjcbOnCallMediaEvent(unsigned AMediaIndex, pjmedia_event *AEvent);
+	void pjcbOnDtmfDigit(int ADigit);
+	inline pjsua_call_id callIndex() const { return FCallIndex; }
+	inline pjsua_acc_id accountIndex() const { return FAccIndex; }
+	inline QString dialogId() const { return FDialogId; }
+	inline void setDialogId(const QString &ADialogId) { FDialogId = ADialogId; }
+	inline void setVideoAllowed(bool AAllowed) { FVideoAllowed = AAllowed; }
+	inline void setReplayMode(bool AReplay) { FReplayMode = AReplay; }
+private:
+	Role FRole;
+	State FState;
+	QUuid FAccountId;
+	QString FRemoteUri;
+	quint32 FStatusCode;
+	QString FStatusText;
+	bool FDelayedDestroy;
+	bool FVideoAllowed;
+	bool FReplayMode;
+	qint64 FDestroyWaitTime;
+private:
+	pjsua_acc_id FAccIndex;
+	pjsua_call_id FCallIndex;
+	QString FDialogId;
+	mutable QMutex FDestroyLock;
+	mutable QWaitCondition FEventWait;
+private:
+	QAtomicInt FActive;
+	pjsua_conf_port_id FConfSlot;
+	pjsua_call_media_status FMediaStatus;
+	QVector<SipEventMediaInfo> FMediaInfo;
+private:
+	quint32 FMediaVersion;
+	QList<ISipMediaStream> FMediaStreams;
+private:
+	QTimer FTonegenTimer;
+	SipTonegen *FTonegen;
+private:
+	enum DtmfMethod {
+		DtmfRfc2833,
+		DtmfInfo,
+		DtmfInband
+	};
+	QTimer FDtmfTimer;
+	QByteArray FDtmfQueue;
+	DtmfMethod FDtmfMethod;
+	bool FDtmfFallback;
+private:
+	QMultiMap<int, VideoWindow *> FVideoPlaybackWidgets;
+	QTimer FMediaProbeTimer;
+	qint64 FFirstMediaTime;
+	qint64 FFirstVideoFrameTime;
+	qint64 FStateTimes[Aborted+1];
+private:
+	QTimer FStatsTimer;
+	QVector<SipMediaStatsRing> FStatsRings;
+	QTimer FVideoAdaptTimer;
+	SipVideoAdapter FVideoAdapter;
+private:
+	QTimer FMediaVolumeTimer;
+	SipMediaStreamLevel FMediaLevels[PJMEDIA_MAX_SDP_MEDIA];
+};
+
+#endif // SIPCALL_H
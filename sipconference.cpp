@@ -0,0 +1,278 @@
+#include "sipconference.h"
+
+#include <definitions/sipphone/optionvalues.h>
+#include <utils/options.h>
+#include <utils/logger.h>
+#include "sipbridgebypass.h"
+
+#define LEVEL_POLL_INTERVAL      20       // one audio frame
+#define LEVEL_REPORT_TICKS       5
+#define SILENCE_HANGOVER_TICKS   25
+#define ONSET_THRESHOLD_FACTOR   0.5f
+#define ONSET_RISE_FACTOR        2.0f
+#define MAX_SIGNAL_LEVEL         255.0f
+
+SipConference::SipConference(QObject *AParent) : QObject(AParent)
+{
+	FDestroyed = false;
+	FLevelTicks = 0;
+	FLevelsChanged = false;
+	FSilenceThreshold = Options::node(OPV_SIPPHONE_CONFERENCE_SILENCETHRESHOLD).value().toFloat();
+
+	FLevelTimer.setInterval(LEVEL_POLL_INTERVAL);
+	connect(&FLevelTimer,SIGNAL(timeout()),SLOT(onLevelTimerTimeout()));
+}
+
+SipConference::~SipConference()
+{
+	destroyConference();
+}
+
+QList<ISipCall *> SipConference::participants() const
+{
+	QList<ISipCall *> calls;
+	foreach(SipCall *call, FCalls)
+		calls.append(call);
+	return calls;
+}
+
+bool SipConference::appendParticipant(ISipCall *ACall)
+{
+	SipCall *call = ACall!=NULL ? qobject_cast<SipCall *>(ACall->instance()) : NULL;
+	if (!FDestroyed && call!=NULL && !FCalls.contains(call))
+	{
+		if (call->isActive() && call->FCallIndex!=PJSUA_INVALID_ID)
+		{
+			// New participant is mixed until its first silent period is detected
+			SipConferenceParticipant participant;
+			participant.level = 0.0f;
+			participant.speaking = true;
+			participant.silentTicks = 0;
+
+			// Participants must be mixed by conference bridge
+			SipBridgeBypass::leave(call->FCallIndex);
+
+			FCalls.append(call);
+			FParticipants.insert(call,participant);
+			connect(call,SIGNAL(mediaChanged()),SLOT(onCallMediaChanged()));
+			connect(call,SIGNAL(stateChanged()),SLOT(onCallMediaChanged()));
+			connect(call,SIGNAL(callDestroyed()),SLOT(onCallDestroyed()));
+
+			LOG_INFO(QString("Participant appended to SIP conference, call=%1, uri=%2, participants=%3").arg(call->FCallIndex).arg(call->remoteUri()).arg(FCalls.count()));
+
+			updateRouting();
+			FLevelTimer.start();
+
+			emit participantAppended(call);
+			return true;
+		}
+		else
+		{
+			LOG_WARNING(QString("Failed to append participant to SIP conference, call=%1: Call is not active").arg(call->FCallIndex));
+		}
+	}
+	return false;
+}
+
+bool SipConference::removeParticipant(ISipCall *ACall)
+{
+	SipCall *call = ACall!=NULL ? qobject_cast<SipCall *>(ACall->instance()) : NULL;
+	if (call!=NULL && FCalls.contains(call))
+	{
+		// Links of slot released by pjsua are forgotten, links of active slot are disconnected below
+		pjsua_conf_port_id slot = FSlots.take(call);
+		if (slot != participantSlot(call))
+			dropLinks(slot);
+
+		FCalls.removeAll(call);
+		FParticipants.remove(call);
+		disconnect(call,0,this,0);
+
+		LOG_INFO(QString("Participant removed from SIP conference, call=%1, uri=%2, participants=%3").arg(call->FCallIndex).arg(call->remoteUri()).arg(FCalls.count()));
+
+		updateRouting();
+		if (FCalls.isEmpty())
+			FLevelTimer.stop();
+
+		emit participantRemoved(call);
+		return true;
+	}
+	return false;
+}
+
+float SipConference::participantLevel(ISipCall *ACall) const
+{
+	SipCall *call = ACall!=NULL ? qobject_cast<SipCall *>(ACall->instance()) : NULL;
+	return FParticipants.value(call).level;
+}
+
+bool SipConference::isParticipantSpeaking(ISipCall *ACall) const
+{
+	SipCall *call = ACall!=NULL ? qobject_cast<SipCall *>(ACall->instance()) : NULL;
+	QMap<SipCall *,SipConferenceParticipant>::const_iterator it = FParticipants.constFind(call);
+	return it!=FParticipants.constEnd() && it->speaking;
+}
+
+float SipConference::silenceThreshold() const
+{
+	return FSilenceThreshold;
+}
+
+void SipConference::setSilenceThreshold(float AThreshold)
+{
+	FSilenceThreshold = qBound(0.0f,AThreshold,1.0f);
+}
+
+void SipConference::destroyConference()
+{
+	if (!FDestroyed)
+	{
+		LOG_INFO(QString("SIP conference destroyed, participants=%1").arg(FCalls.count()));
+
+		foreach(SipCall *call, FCalls)
+		{
+			if (FSlots.value(call) != participantSlot(call))
+				dropLinks(FSlots.value(call));
+			disconnect(call,0,this,0);
+		}
+		FCalls.clear();
+		FSlots.clear();
+		FParticipants.clear();
+		FLevelTimer.stop();
+		updateRouting();
+
+		FDestroyed = true;
+		emit conferenceDestroyed();
+	}
+}
+
+void SipConference::updateRouting()
+{
+	// Slot of reinitialized or disconnected media may already belong to another port
+	foreach(SipCall *call, FCalls)
+	{
+		pjsua_conf_port_id slot = participantSlot(call);
+		QMap<SipCall *,pjsua_conf_port_id>::iterator it = FSlots.find(call);
+		if (it!=FSlots.end() && it.value()!=slot)
+			dropLinks(it.value());
+		FSlots.insert(call,slot);
+	}
+
+	// Mix-minus: every participant hears local user and all speaking participants except itself
+	QSet< QPair<pjsua_conf_port_id,pjsua_conf_port_id> > links;
+	foreach(SipCall *source, FCalls)
+	{
+		pjsua_conf_port_id sourceSlot = participantSlot(source);
+		if (sourceSlot!=PJSUA_INVALID_ID && FParticipants.value(source).speaking)
+		{
+			foreach(SipCall *sink, FCalls)
+			{
+				pjsua_conf_port_id sinkSlot = participantSlot(sink);
+				if (sink!=source && sinkSlot!=PJSUA_INVALID_ID)
+					links.insert(qMakePair(sourceSlot,sinkSlot));
+			}
+		}
+	}
+
+	foreach(const QPair<pjsua_conf_port_id,pjsua_conf_port_id> &link, FLinks - links)
+		pjsua_conf_disconnect(link.first,link.second);
+	foreach(const QPair<pjsua_conf_port_id,pjsua_conf_port_id> &link, links - FLinks)
+	{
+		pj_status_t status = pjsua_conf_connect(link.first,link.second);
+		if (status != PJ_SUCCESS)
+			LOG_WARNING(QString("Failed to connect SIP conference slots, source=%1, sink=%2: %3").arg(link.first).arg(link.second).arg(resolveSipError(status)));
+	}
+	FLinks = links;
+}
+
+void SipConference::dropLinks(pjsua_conf_port_id ASlot)
+{
+	if (ASlot != PJSUA_INVALID_ID)
+	{
+		QSet< QPair<pjsua_conf_port_id,pjsua_conf_port_id> >::iterator it = FLinks.begin();
+		while (it != FLinks.end())
+		{
+			if (it->first==ASlot || it->second==ASlot)
+				it = FLinks.erase(it);
+			else
+				++it;
+		}
+	}
+}
+
+pjsua_conf_port_id SipConference::participantSlot(SipCall *ACall) const
+{
+	return ACall->isActive() ? ACall->FConfSlot : PJSUA_INVALID_ID;
+}
+
+QString SipConference::resolveSipError(int ACode) const
+{
+	char errmsg[PJ_ERR_MSG_SIZE];
+	pj_strerror(ACode, errmsg, sizeof(errmsg));
+	return QString(errmsg);
+}
+
+// Levels are polled every frame, so silent participant is relinked at speech onset:
+// either above threshold or above its lower part while level is rising quickly
+void SipConference::onLevelTimerTimeout()
+{
+	bool routingChanged = false;
+	for (QMap<SipCall *,SipConferenceParticipant>::iterator it=FParticipants.begin(); it!=FParticipants.end(); ++it)
+	{
+		unsigned txLevel = 0, rxLevel = 0;
+		pjsua_conf_port_id slot = participantSlot(it.key());
+		if (slot!=PJSUA_INVALID_ID && pjsua_conf_get_signal_level(slot,&txLevel,&rxLevel)==PJ_SUCCESS)
+		{
+			// Silent participant stays connected to local user only, so its level is still measured
+			float level = rxLevel/MAX_SIGNAL_LEVEL;
+			bool onset = !it->speaking && level>=FSilenceThreshold*ONSET_THRESHOLD_FACTOR && level>=it->level*ONSET_RISE_FACTOR;
+			if (level>=FSilenceThreshold || onset)
+			{
+				it->silentTicks = 0;
+				if (!it->speaking)
+				{
+					it->speaking = true;
+					routingChanged = true;
+				}
+			}
+			else if (it->speaking && ++it->silentTicks>=SILENCE_HANGOVER_TICKS)
+			{
+				it->speaking = false;
+				routingChanged = true;
+			}
+
+			if (!qFuzzyCompare(it->level+1.0f,level+1.0f))
+			{
+				it->level = level;
+				FLevelsChanged = true;
+			}
+		}
+	}
+
+	if (routingChanged)
+		updateRouting();
+
+	// Level changes are reported at lower rate than they are polled
+	if (++FLevelTicks >= LEVEL_REPORT_TICKS)
+	{
+		FLevelTicks = 0;
+		if (FLevelsChanged)
+		{
+			FLevelsChanged = false;
+			emit participantLevelsChanged();
+		}
+	}
+}
+
+void SipConference::onCallMediaChanged()
+{
+	// Conference slot is changed when call media is reinitialized or call is disconnected
+	updateRouting();
+}
+
+void SipConference::onCallDestroyed()
+{
+	SipCall *call = qobject_cast<SipCall *>(sender());
+	if (call)
+		removeParticipant(call);
+}
@@ -0,0 +1,62 @@
+#ifndef SIPCONFERENCE_H
+#define SIPCONFERENCE_H
+
+#include <QMap>
+#include <QSet>
+#include <QPair>
+#include <QTimer>
+#include <interfaces/isipphone.h>
+#include "sipcall.h"
+
+struct SipConferenceParticipant
+{
+	float level;
+	bool speaking;
+	int silentTicks;
+};
+
+class SipConference :
+	public QObject,
+	public ISipConference
+{
+	Q_OBJECT;
+	Q_INTERFACES(ISipConference);
+public:
+	SipConference(QObject *AParent);
+	~SipConference();
+	virtual QObject *instance() { return this; }
+	virtual QList<ISipCall *> participants() const;
+	virtual bool appendParticipant(ISipCall *ACall);
+	virtual bool removeParticipant(ISipCall *ACall);
+	virtual float participantLevel(ISipCall *ACall) const;
+	virtual bool isParticipantSpeaking(ISipCall *ACall) const;
+	virtual float silenceThreshold() const;
+	virtual void setSilenceThreshold(float AThreshold);
+	virtual void destroyConference();
+signals:
+	void participantAppended(ISipCall *ACall);
+	void participantRemoved(ISipCall *ACall);
+	void participantLevelsChanged();
+	void conferenceDestroyed();
+protected:
+	void updateRouting();
+	void dropLinks(pjsua_conf_port_id ASlot);
+	pjsua_conf_port_id participantSlot(SipCall *ACall) const;
+	QString resolveSipError(int ACode) const;
+protected slots:
+	void onLevelTimerTimeout();
+	void onCallMediaChanged();
+	void onCallDestroyed();
+private:
+	bool FDestroyed;
+	QTimer FLevelTimer;
+	int FLevelTicks;
+	bool FLevelsChanged;
+	float FSilenceThreshold;
+	QList<SipCall *> FCalls;
+	QMap<SipCall *, SipConferenceParticipant> FParticipants;
+	QMap<SipCall *, pjsua_conf_port_id> FSlots;
+	QSet< QPair<pjsua_conf_port_id,pjsua_conf_port_id> > FLinks;
+};
+
+#endif // SIPCONFERENCE_H
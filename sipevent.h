@@ -1,61 +1,104 @@
-#ifndef SIPEVENT_H
-#define SIPEVENT_H
-
-#include <pjsua.h>
-
-struct SipEvent 
-{
-	enum Type {
-		Null,
-		Error,
-		RegState,
-		IncomingCall,
-		CallState,
-		CallMediaState,
-		CallMediaFormat
-	};
-	Type type;
-};
-
-struct SipEventError : 
-	public SipEvent
-{
-	pj_status_t error;
-};
-
-struct SipEventRegState :
-	public SipEvent
-{
-	pjsua_acc_id accIndex;
-};
-
-struct SipEventIncomingCall : 
-	public SipEvent
-{
-	pjsua_acc_id accIndex;
-	pjsua_call_id callIndex;
-};
-
-struct SipEventCallState :
-	public SipEvent
-{
-	pjsip_inv_state state;
-	pjsip_status_code status;
-	quint32 duration;
-	qint64 destroyWaitTime;
-};
-
-struct SipEventCallMediaState :
-	public SipEvent
-{
-	pjsua_conf_port_id confSlot;
-	pjsua_call_media_status mediaStatus;
-};
-
-struct SipEventCallMediaFormat :
-	public SipEvent
-{
-	unsigned mediaIndex;
-};
-
-#endif // SIPEVENT_H
+#ifndef SIPEVENT_H
+#define SIPEVENT_H
+
+#include <QElapsedTimer>
+#include <pjsua.h>
+
+// Monotonic clock in milliseconds used for all event and call timestamps
+inline qint64 sipEventTimestamp()
+{
+	QElapsedTimer clock;
+	clock.start();
+	return clock.msecsSinceReference();
+}
+
+struct SipEvent 
+{
+	enum Type {
+		Null,
+		Error,
+		RegState,
+		IncomingCall,
+		CallState,
+		CallMediaState,
+		CallMediaFormat,
+		CallDtmfDigit
+	};
+	Type type;
+};
+
+struct SipEventError : 
+	public SipEvent
+{
+	pj_status_t error;
+};
+
+struct SipEventRegState :
+	public SipEvent
+{
+	pjsua_acc_id accIndex;
+	pj_bool_t registered;
+	pjsip_status_code status;
+};
+
+struct SipEventIncomingCall : 
+	public SipEvent
+{
+	pjsua_acc_id accIndex;
+	pjsua_call_id callIndex;
+	char callId[256];
+	char fromTag[64];
+	pj_bool_t audioOnly;
+};
+
+struct SipEventMediaInfo
+{
+	pjmedia_type type;
+	pjmedia_dir dir;
+	pjsua_call_media_status status;
+	pjsua_conf_port_id confSlot;
+	pjsua_vid_win_id videoWindow;
+	pjmedia_vid_dev_index captureDev;
+};
+
+struct SipEventCallInfo :
+	public SipEvent
+{
+	pj_bool_t active;
+	qint64 timestamp;
+	pjsua_conf_port_id confSlot;
+	pjsua_call_media_status mediaStatus;
+	unsigned mediaCount;
+	SipEventMediaInfo media[PJMEDIA_MAX_SDP_MEDIA];
+};
+
+struct SipEventCallState :
+	public SipEventCallInfo
+{
+	pjsip_inv_state state;
+	pjsip_status_code status;
+	qint64 destroyWaitTime;
+};
+
+struct SipEventCallMediaState :
+	public SipEventCallInfo
+{
+};
+
+struct SipEventCallMediaFormat :
+	public SipEvent
+{
+	qint64 timestamp;
+	unsigned mediaIndex;
+	pjmedia_event_type eventType;
+	pjmedia_dir dir;
+	pjmedia_format format;
+};
+
+struct SipEventCallDtmfDigit :
+	public SipEvent
+{
+	int digit;
+};
+
+#endif // SIPEVENT_H
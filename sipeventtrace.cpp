@@ -0,0 +1,509 @@
+#include "sipeventtrace.h"
+
+#include <utils/logger.h>
+#include "sipcall.h"
+
+#define TRACE_MAGIC          "SIPTRACE"
+#define TRACE_VERSION        5
+#define REPLAY_BATCH_SIZE    256
+
+// SipEventTrace
+SipEventTrace *SipEventTrace::FRecorder = NULL;
+
+SipEventTrace::SipEventTrace()
+{
+
+}
+
+SipEventTrace::~SipEventTrace()
+{
+	close();
+}
+
+bool SipEventTrace::isOpen() const
+{
+	return FFile.isOpen();
+}
+
+QString SipEventTrace::fileName() const
+{
+	return FFile.fileName();
+}
+
+bool SipEventTrace::open(const QString &AFileName, QIODevice::OpenMode AMode)
+{
+	close();
+	FFile.setFileName(AFileName);
+	if (AMode & QIODevice::WriteOnly)
+	{
+		if (FFile.open(QIODevice::WriteOnly|QIODevice::Truncate))
+		{
+			QDataStream stream(&FFile);
+			stream.setByteOrder(QDataStream::LittleEndian);
+			stream.writeRawData(TRACE_MAGIC,sizeof(TRACE_MAGIC)-1);
+			stream << (quint16)TRACE_VERSION;
+			FClock.start();
+			return true;
+		}
+		LOG_ERROR(QString("Failed to open SIP event trace for writing, file=%1: %2").arg(AFileName,FFile.errorString()));
+	}
+	else if (AMode & QIODevice::ReadOnly)
+	{
+		if (FFile.open(QIODevice::ReadOnly))
+		{
+			char magic[sizeof(TRACE_MAGIC)-1];
+			quint16 version = 0;
+			QDataStream stream(&FFile);
+			stream.setByteOrder(QDataStream::LittleEndian);
+			stream.readRawData(magic,sizeof(magic));
+			stream >> version;
+			if (memcmp(magic,TRACE_MAGIC,sizeof(magic))==0 && version==TRACE_VERSION)
+				return true;
+			LOG_ERROR(QString("Failed to open SIP event trace for reading, file=%1: Invalid trace header").arg(AFileName));
+			FFile.close();
+		}
+		else
+		{
+			LOG_ERROR(QString("Failed to open SIP event trace for reading, file=%1: %2").arg(AFileName,FFile.errorString()));
+		}
+	}
+	return false;
+}
+
+void SipEventTrace::close()
+{
+	if (FFile.isOpen())
+		FFile.close();
+}
+
+// Events are stored field by field with payload size, so readers skip unknown
+// types and ignore fields appended to known ones by newer writers
+bool SipEventTrace::writeEvent(int ACallIndex, const SipEvent *AEvent)
+{
+	if (FFile.isWritable() && isKnownType(AEvent->type))
+	{
+		QByteArray data;
+		QDataStream dataStream(&data,QIODevice::WriteOnly);
+		dataStream.setByteOrder(QDataStream::LittleEndian);
+		writeEventData(dataStream,AEvent);
+
+		QDataStream stream(&FFile);
+		stream.setByteOrder(QDataStream::LittleEndian);
+		stream << (qint64)(FClock.nsecsElapsed()/1000) << (qint32)ACallIndex << (quint16)AEvent->type << (quint16)data.size();
+		stream.writeRawData(data.constData(),data.size());
+		return stream.status() == QDataStream::Ok;
+	}
+	return false;
+}
+
+SipEvent *SipEventTrace::readEvent(int &ACallIndex, qint64 &ATimestamp)
+{
+	QDataStream stream(&FFile);
+	stream.setByteOrder(QDataStream::LittleEndian);
+	while (FFile.isReadable() && !stream.atEnd())
+	{
+		qint64 timestamp;
+		qint32 callIndex;
+		quint16 type, size;
+		stream >> timestamp >> callIndex >> type >> size;
+		if (stream.status() != QDataStream::Ok)
+			break;
+
+		QByteArray data(size,0);
+		if (stream.readRawData(data.data(),size) != size)
+			break;
+
+		SipEvent *event = createEvent(type);
+		if (event != NULL)
+		{
+			QDataStream dataStream(data);
+			dataStream.setByteOrder(QDataStream::LittleEndian);
+			if (readEventData(dataStream,event))
+			{
+				ACallIndex = callIndex;
+				ATimestamp = timestamp;
+				return event;
+			}
+			LOG_WARNING(QString("Skipped malformed SIP event in trace, type=%1, size=%2").arg(type).arg(size));
+			delete event;
+		}
+	}
+	return NULL;
+}
+
+SipEventTrace *SipEventTrace::recorder()
+{
+	return FRecorder;
+}
+
+void SipEventTrace::setRecorder(SipEventTrace *ATrace)
+{
+	FRecorder = ATrace;
+}
+
+void SipEventTrace::recordEvent(int ACallIndex, const SipEvent *AEvent)
+{
+	if (FRecorder != NULL)
+		FRecorder->writeEvent(ACallIndex,AEvent);
+}
+
+bool SipEventTrace::isKnownType(int AType)
+{
+	switch (AType)
+	{
+	case SipEvent::Error:
+	case SipEvent::RegState:
+	case SipEvent::IncomingCall:
+	case SipEvent::CallState:
+	case SipEvent::CallMediaState:
+	case SipEvent::CallMediaFormat:
+	case SipEvent::CallDtmfDigit:
+		return true;
+	default:
+		break;
+	}
+	return false;
+}
+
+SipEvent *SipEventTrace::createEvent(int AType)
+{
+	SipEvent *event = NULL;
+	switch (AType)
+	{
+	case SipEvent::Error:
+		event = new SipEventError;
+		break;
+	case SipEvent::RegState:
+		event = new SipEventRegState;
+		break;
+	case SipEvent::IncomingCall:
+		event = new SipEventIncomingCall;
+		break;
+	case SipEvent::CallState:
+		event = new SipEventCallState;
+		break;
+	case SipEvent::CallMediaState:
+		event = new SipEventCallMediaState;
+		break;
+	case SipEvent::CallMediaFormat:
+		event = new SipEventCallMediaFormat;
+		break;
+	case SipEvent::CallDtmfDigit:
+		event = new SipEventCallDtmfDigit;
+		break;
+	default:
+		break;
+	}
+	if (event != NULL)
+		event->type = (SipEvent::Type)AType;
+	return event;
+}
+
+static void writeCallInfo(QDataStream &AStream, const SipEventCallInfo *AInfo)
+{
+	unsigned mediaCount = qMin(AInfo->mediaCount,(unsigned)PJMEDIA_MAX_SDP_MEDIA);
+	AStream << (qint32)AInfo->active << (qint64)AInfo->timestamp << (qint32)AInfo->confSlot << (qint32)AInfo->mediaStatus << (quint32)mediaCount;
+	for (unsigned i=0; i<mediaCount; i++)
+	{
+		const SipEventMediaInfo &mi = AInfo->media[i];
+		AStream << (qint32)mi.type << (qint32)mi.dir << (qint32)mi.status << (qint32)mi.confSlot << (qint32)mi.videoWindow << (qint32)mi.captureDev;
+	}
+}
+
+static bool readCallInfo(QDataStream &AStream, SipEventCallInfo *AInfo)
+{
+	qint32 active, confSlot, mediaStatus;
+	quint32 mediaCount;
+	AStream >> active >> AInfo->timestamp >> confSlot >> mediaStatus >> mediaCount;
+	if (AStream.status()!=QDataStream::Ok || mediaCount>PJMEDIA_MAX_SDP_MEDIA)
+		return false;
+
+	AInfo->active = active;
+	AInfo->confSlot = confSlot;
+	AInfo->mediaStatus = (pjsua_call_media_status)mediaStatus;
+	AInfo->mediaCount = mediaCount;
+	for (unsigned i=0; i<mediaCount; i++)
+	{
+		qint32 type, dir, status, mediaSlot, videoWindow, captureDev;
+		AStream >> type >> dir >> status >> mediaSlot >> videoWindow >> captureDev;
+
+		SipEventMediaInfo &mi = AInfo->media[i];
+		mi.type = (pjmedia_type)type;
+		mi.dir = (pjmedia_dir)dir;
+		mi.status = (pjsua_call_media_status)status;
+		mi.confSlot = mediaSlot;
+		mi.videoWindow = videoWindow;
+		mi.captureDev = captureDev;
+	}
+	return AStream.status() == QDataStream::Ok;
+}
+
+void SipEventTrace::writeEventData(QDataStream &AStream, const SipEvent *AEvent)
+{
+	switch (AEvent->type)
+	{
+	case SipEvent::Error:
+		AStream << (qint32)static_cast<const SipEventError *>(AEvent)->error;
+		break;
+	case SipEvent::RegState:
+		{
+			const SipEventRegState *se = static_cast<const SipEventRegState *>(AEvent);
+			AStream << (qint32)se->accIndex << (qint32)se->registered << (qint32)se->status;
+		}
+		break;
+	case SipEvent::IncomingCall:
+		{
+			const SipEventIncomingCall *se = static_cast<const SipEventIncomingCall *>(AEvent);
+			AStream << (qint32)se->accIndex << (qint32)se->callIndex << QByteArray(se->callId) << QByteArray(se->fromTag) << (qint32)se->audioOnly;
+		}
+		break;
+	case SipEvent::CallState:
+		{
+			const SipEventCallState *se = static_cast<const SipEventCallState *>(AEvent);
+			writeCallInfo(AStream,se);
+			AStream << (qint32)se->state << (qint32)se->status << (qint64)se->destroyWaitTime;
+		}
+		break;
+	case SipEvent::CallMediaState:
+		writeCallInfo(AStream,static_cast<const SipEventCallMediaState *>(AEvent));
+		break;
+	case SipEvent::CallMediaFormat:
+		{
+			const SipEventCallMediaFormat *se = static_cast<const SipEventCallMediaFormat *>(AEvent);
+			AStream << (qint64)se->timestamp << (quint32)se->mediaIndex << (quint32)se->eventType << (qint32)se->dir;
+			AStream << (qint32)se->format.type << (quint32)se->format.id;
+			AStream << (quint32)se->format.det.vid.size.w << (quint32)se->format.det.vid.size.h << (qint32)se->format.det.vid.fps.num << (qint32)se->format.det.vid.fps.denum;
+		}
+		break;
+	case SipEvent::CallDtmfDigit:
+		AStream << (qint32)static_cast<const SipEventCallDtmfDigit *>(AEvent)->digit;
+		break;
+	default:
+		break;
+	}
+}
+
+bool SipEventTrace::readEventData(QDataStream &AStream, SipEvent *AEvent)
+{
+	switch (AEvent->type)
+	{
+	case SipEvent::Error:
+		{
+			qint32 error;
+			AStream >> error;
+			static_cast<SipEventError *>(AEvent)->error = error;
+		}
+		break;
+	case SipEvent::RegState:
+		{
+			SipEventRegState *se = static_cast<SipEventRegState *>(AEvent);
+			qint32 accIndex, registered, status;
+			AStream >> accIndex >> registered >> status;
+			se->accIndex = accIndex;
+			se->registered = registered;
+			se->status = (pjsip_status_code)status;
+		}
+		break;
+	case SipEvent::IncomingCall:
+		{
+			SipEventIncomingCall *se = static_cast<SipEventIncomingCall *>(AEvent);
+			qint32 accIndex, callIndex, audioOnly;
+			QByteArray callId, fromTag;
+			AStream >> accIndex >> callIndex >> callId >> fromTag >> audioOnly;
+			se->accIndex = accIndex;
+			se->callIndex = callIndex;
+			qstrncpy(se->callId,callId.constData(),sizeof(se->callId));
+			qstrncpy(se->fromTag,fromTag.constData(),sizeof(se->fromTag));
+			se->audioOnly = audioOnly;
+		}
+		break;
+	case SipEvent::CallState:
+		{
+			SipEventCallState *se = static_cast<SipEventCallState *>(AEvent);
+			qint32 state, status;
+			if (!readCallInfo(AStream,se))
+				return false;
+			AStream >> state >> status >> se->destroyWaitTime;
+			se->state = (pjsip_inv_state)state;
+			se->status = (pjsip_status_code)status;
+		}
+		break;
+	case SipEvent::CallMediaState:
+		return readCallInfo(AStream,static_cast<SipEventCallMediaState *>(AEvent));
+	case SipEvent::CallMediaFormat:
+		{
+			SipEventCallMediaFormat *se = static_cast<SipEventCallMediaFormat *>(AEvent);
+			quint32 mediaIndex, eventType, formatId, width, height;
+			qint32 dir, formatType, fpsNum, fpsDenum;
+			AStream >> se->timestamp >> mediaIndex >> eventType >> dir;
+			AStream >> formatType >> formatId;
+			AStream >> width >> height >> fpsNum >> fpsDenum;
+			pj_bzero(&se->format,sizeof(se->format));
+			se->mediaIndex = mediaIndex;
+			se->eventType = (pjmedia_event_type)eventType;
+			se->dir = (pjmedia_dir)dir;
+			se->format.type = (pjmedia_type)formatType;
+			se->format.id = formatId;
+			se->format.detail_type = PJMEDIA_FORMAT_DETAIL_VIDEO;
+			se->format.det.vid.size.w = width;
+			se->format.det.vid.size.h = height;
+			se->format.det.vid.fps.num = fpsNum;
+			se->format.det.vid.fps.denum = fpsDenum;
+		}
+		break;
+	case SipEvent::CallDtmfDigit:
+		{
+			qint32 digit;
+			AStream >> digit;
+			static_cast<SipEventCallDtmfDigit *>(AEvent)->digit = digit;
+		}
+		break;
+	default:
+		return false;
+	}
+	return AStream.status() == QDataStream::Ok;
+}
+
+// SipEventReplay
+SipEventReplay::SipEventReplay(QObject *AParent) : QObject(AParent)
+{
+	FMaxSpeed = false;
+	FNextEvent = NULL;
+
+	FTimer.setSingleShot(true);
+	connect(&FTimer,SIGNAL(timeout()),SLOT(onReplayTimerTimeout()));
+}
+
+SipEventReplay::~SipEventReplay()
+{
+	stop();
+}
+
+bool SipEventReplay::isRunning() const
+{
+	return FTrace.isOpen();
+}
+
+bool SipEventReplay::start(const QString &AFileName, bool AMaxSpeed)
+{
+	stop();
+	if (FTrace.open(AFileName,QIODevice::ReadOnly))
+	{
+		FMaxSpeed = AMaxSpeed;
+		FEventCount = 0;
+		FWallNsecs = 0;
+		FHandlerCount.clear();
+		FHandlerNsecs.clear();
+
+		if (readNextEvent())
+		{
+			LOG_INFO(QString("SIP event replay started, file=%1, max-speed=%2").arg(AFileName).arg(AMaxSpeed));
+			FFirstTimestamp = FNextTimestamp;
+			FClock.start();
+			FTimer.start(0);
+			return true;
+		}
+		LOG_WARNING(QString("Failed to start SIP event replay, file=%1: Trace is empty").arg(AFileName));
+		FTrace.close();
+	}
+	return false;
+}
+
+void SipEventReplay::stop()
+{
+	FTimer.stop();
+	FTrace.close();
+
+	delete FNextEvent;
+	FNextEvent = NULL;
+
+	qDeleteAll(FCalls);
+	FCalls.clear();
+}
+
+bool SipEventReplay::readNextEvent()
+{
+	FNextEvent = FTrace.readEvent(FNextCallIndex,FNextTimestamp);
+	return FNextEvent != NULL;
+}
+
+void SipEventReplay::dispatchEvent(int ACallIndex, SipEvent *AEvent)
+{
+	int type = AEvent->type;
+
+	QElapsedTimer handlerClock;
+	handlerClock.start();
+
+	if (ACallIndex != PJSUA_INVALID_ID)
+	{
+		SipCall *call = FCalls.value(ACallIndex);
+		if (call == NULL)
+		{
+			call = new SipCall(QUuid(),PJSUA_INVALID_ID,QString("replay:%1").arg(ACallIndex),this);
+			call->setReplayMode(true);
+			FCalls.insert(ACallIndex,call);
+		}
+		call->processSipEvent(AEvent);
+	}
+	else if (type == SipEvent::IncomingCall)
+	{
+		// SipPhone handler is replaced with creation of detached call
+		SipEventIncomingCall *se = static_cast<SipEventIncomingCall *>(AEvent);
+		if (!FCalls.contains(se->callIndex))
+		{
+			SipCall *call = new SipCall(QUuid(),PJSUA_INVALID_ID,QString("replay:%1").arg(se->callIndex),this);
+			call->setReplayMode(true);
+			FCalls.insert(se->callIndex,call);
+		}
+		delete se;
+	}
+	else
+	{
+		delete AEvent;
+	}
+
+	FEventCount++;
+	FHandlerCount[type]++;
+	FHandlerNsecs[type] += handlerClock.nsecsElapsed();
+}
+
+void SipEventReplay::printReport() const
+{
+	double seconds = FWallNsecs/1000000000.0;
+	LOG_INFO(QString("SIP event replay finished, file=%1, events=%2, calls=%3, time=%4ms, rate=%5 events/sec").arg(FTrace.fileName()).arg(FEventCount).arg(FCalls.count()).arg(FWallNsecs/1000000).arg(seconds>0 ? FEventCount/seconds : 0.0,0,'f',1));
+	for (QMap<int,quint64>::const_iterator it=FHandlerCount.constBegin(); it!=FHandlerCount.constEnd(); ++it)
+	{
+		qint64 nsecs = FHandlerNsecs.value(it.key());
+		LOG_INFO(QString("  event type=%1, count=%2, total=%3us, avg=%4us").arg(it.key()).arg(it.value()).arg(nsecs/1000).arg(nsecs/1000.0/it.value(),0,'f',2));
+	}
+}
+
+void SipEventReplay::onReplayTimerTimeout()
+{
+	for (int batch=0; FNextEvent!=NULL && batch<REPLAY_BATCH_SIZE; batch++)
+	{
+		qint64 delay = FMaxSpeed ? 0 : (FNextTimestamp-FFirstTimestamp)/1000 - FClock.elapsed();
+		if (delay > 0)
+		{
+			FTimer.start(delay);
+			return;
+		}
+
+		SipEvent *event = FNextEvent;
+		int callIndex = FNextCallIndex;
+		readNextEvent();
+		dispatchEvent(callIndex,event);
+	}
+
+	if (FNextEvent == NULL)
+	{
+		FWallNsecs = FClock.nsecsElapsed();
+		printReport();
+		stop();
+		emit finished();
+	}
+	else
+	{
+		FTimer.start(0);
+	}
+}
@@ -0,0 +1,75 @@
+#ifndef SIPEVENTTRACE_H
+#define SIPEVENTTRACE_H
+
+#include <QMap>
+#include <QFile>
+#include <QDataStream>
+#include <QTimer>
+#include <QElapsedTimer>
+#include "sipevent.h"
+
+class SipCall;
+
+class SipEventTrace
+{
+public:
+	SipEventTrace();
+	~SipEventTrace();
+	bool isOpen() const;
+	QString fileName() const;
+	bool open(const QString &AFileName, QIODevice::OpenMode AMode);
+	void close();
+	bool writeEvent(int ACallIndex, const SipEvent *AEvent);
+	SipEvent *readEvent(int &ACallIndex, qint64 &ATimestamp);
+public:
+	static SipEventTrace *recorder();
+	static void setRecorder(SipEventTrace *ATrace);
+	static void recordEvent(int ACallIndex, const SipEvent *AEvent);
+	static bool isKnownType(int AType);
+	static SipEvent *createEvent(int AType);
+	static void writeEventData(QDataStream &AStream, const SipEvent *AEvent);
+	static bool readEventData(QDataStream &AStream, SipEvent *AEvent);
+private:
+	QFile FFile;
+	QElapsedTimer FClock;
+private:
+	static SipEventTrace *FRecorder;
+};
+
+class SipEventReplay :
+	public QObject
+{
+	Q_OBJECT;
+public:
+	SipEventReplay(QObject *AParent);
+	~SipEventReplay();
+	bool isRunning() const;
+	bool start(const QString &AFileName, bool AMaxSpeed);
+	void stop();
+signals:
+	void finished();
+protected:
+	bool readNextEvent();
+	void dispatchEvent(int ACallIndex, SipEvent *AEvent);
+	void printReport() const;
+protected slots:
+	void onReplayTimerTimeout();
+private:
+	bool FMaxSpeed;
+	QTimer FTimer;
+	SipEventTrace FTrace;
+	QElapsedTimer FClock;
+private:
+	int FNextCallIndex;
+	qint64 FNextTimestamp;
+	qint64 FFirstTimestamp;
+	SipEvent *FNextEvent;
+private:
+	quint64 FEventCount;
+	qint64 FWallNsecs;
+	QMap<int, SipCall *> FCalls;
+	QMap<int, quint64> FHandlerCount;
+	QMap<int, qint64> FHandlerNsecs;
+};
+
+#endif // SIPEVENTTRACE_H
@@ -0,0 +1,284 @@
+#include "siploadbenchmark.h"
+
+#include <definitions/sipcallhandlerorders.h>
+#include <utils/logger.h>
+#if defined(Q_OS_WIN)
+#	include <windows.h>
+#else
+#	include <sys/resource.h>
+#endif
+
+#define BENCHMARK_USER            "loadtest"
+#define BENCHMARK_HOST            "127.0.0.1"
+#define CONNECT_CHECK_INTERVAL    500
+#define CONNECT_TIMEOUT           30000
+#define LINEARITY_MIN_R2          0.95
+
+SipLoadBenchmark::SipLoadBenchmark(ISipPhone *APhone, QObject *AParent) : QObject(AParent)
+{
+	FPhase = Idle;
+	FSipPhone = APhone;
+	FStepTime = 0;
+	FStep = 0;
+	FCpuStart = 0;
+
+	FStepTimer.setSingleShot(true);
+	connect(&FStepTimer,SIGNAL(timeout()),SLOT(onStepTimerTimeout()));
+	connect(FSipPhone->instance(),SIGNAL(callDestroyed(ISipCall *)),SLOT(onSipCallDestroyed(ISipCall *)));
+}
+
+bool SipLoadBenchmark::isRunning() const
+{
+	return FPhase != Idle;
+}
+
+// Every loopback call occupies two call slots, caller and receiver legs
+bool SipLoadBenchmark::start(int AMaxCalls, int AStepTime)
+{
+	stop();
+
+	int maxCalls = qMin(AMaxCalls,(int)pjsua_call_get_max_count()/2);
+	if (maxCalls <= 0)
+	{
+		LOG_ERROR(QString("Failed to start SIP load benchmark, calls=%1: Not enough call slots").arg(AMaxCalls));
+		return false;
+	}
+
+	int udpPort = 0;
+	pjsua_transport_id transports[8];
+	unsigned count = PJ_ARRAY_SIZE(transports);
+	if (pjsua_enum_transports(transports,&count) == PJ_SUCCESS)
+	{
+		for (unsigned i=0; udpPort==0 && i<count; i++)
+		{
+			pjsua_transport_info ti;
+			if (pjsua_transport_get_info(transports[i],&ti)==PJ_SUCCESS && ti.type==PJSIP_TRANSPORT_UDP)
+				udpPort = ti.local_name.port;
+		}
+	}
+	if (udpPort == 0)
+	{
+		LOG_ERROR("Failed to start SIP load benchmark: UDP transport not found");
+		return false;
+	}
+
+	ISipAccountConfig config;
+	config.userid = QString("%1@%2").arg(BENCHMARK_USER,BENCHMARK_HOST);
+	config.serverHost = BENCHMARK_HOST;
+	config.serverPort = udpPort;
+	config.proxyPort = 0;
+
+	FAccountId = QUuid::createUuid();
+	if (!FSipPhone->insertAccount(FAccountId,config))
+	{
+		LOG_ERROR("Failed to start SIP load benchmark: Account not created");
+		FAccountId = QUuid();
+		return false;
+	}
+	FSipPhone->insertCallHandler(SCHO_SIPPHONE_LOADBENCHMARK,this);
+	FTargetUri = QString("sip:%1@%2:%3").arg(BENCHMARK_USER,BENCHMARK_HOST).arg(udpPort);
+
+	FSteps.clear();
+	for (int calls=1; calls<maxCalls; calls*=2)
+		FSteps.append(calls);
+	FSteps.append(maxCalls);
+
+	FStep = 0;
+	FStepTime = qMax(AStepTime,1);
+	FSamples.clear();
+
+	LOG_INFO(QString("SIP load benchmark started, max-calls=%1, step-time=%2s, uri=%3").arg(maxCalls).arg(FStepTime).arg(FTargetUri));
+	return startStep();
+}
+
+void SipLoadBenchmark::stop()
+{
+	FStepTimer.stop();
+	FPhase = Idle;
+	FCalls.clear();
+
+	if (!FAccountId.isNull())
+	{
+		// Removing account hangs up and destroys all benchmark calls
+		FSipPhone->removeCallHandler(SCHO_SIPPHONE_LOADBENCHMARK,this);
+		FSipPhone->removeAccount(FAccountId);
+		FAccountId = QUuid();
+	}
+}
+
+bool SipLoadBenchmark::sipCallReceive(int AOrder, ISipCall *ACall)
+{
+	Q_UNUSED(AOrder);
+	if (isRunning() && ACall->accountId()==FAccountId)
+	{
+		FCalls.append(ACall);
+		return ACall->startCall(false);
+	}
+	return false;
+}
+
+bool SipLoadBenchmark::startStep()
+{
+	int calls = FSteps.value(FStep);
+
+	// Receiver legs are appended when incoming calls are handled
+	int callers = 0;
+	foreach(ISipCall *call, FCalls)
+		if (call->role() == ISipCall::Caller)
+			callers++;
+
+	for (; callers<calls; callers++)
+	{
+		ISipCall *call = FSipPhone->newCall(FAccountId,FTargetUri);
+		if (call==NULL || !call->startCall(false))
+		{
+			LOG_ERROR(QString("SIP load benchmark aborted, calls=%1: Failed to make loopback call").arg(calls));
+			stop();
+			emit finished();
+			return false;
+		}
+		FCalls.append(call);
+	}
+
+	FPhase = Connecting;
+	FClock.start();
+	FStepTimer.start(CONNECT_CHECK_INTERVAL);
+	return true;
+}
+
+void SipLoadBenchmark::finishStep()
+{
+	qint64 elapsed = FClock.nsecsElapsed()/1000;
+	qint64 cpuTime = processCpuTime() - FCpuStart;
+
+	SipLoadSample sample;
+	sample.calls = FSteps.value(FStep);
+	sample.cpuLoad = elapsed>0 ? 100.0*cpuTime/elapsed : 0.0;
+	sample.callCost = sample.cpuLoad/sample.calls;
+	FSamples.append(sample);
+
+	LOG_INFO(QString("SIP load benchmark step finished, calls=%1, cpu=%2%, per-call=%3%").arg(sample.calls).arg(sample.cpuLoad,0,'f',2).arg(sample.callCost,0,'f',3));
+}
+
+// Load is fitted as cpu = base + cost*calls, cost is linear if fit explains measured load
+void SipLoadBenchmark::printReport() const
+{
+	int n = FSamples.count();
+	if (n == 0)
+	{
+		LOG_WARNING("SIP load benchmark finished without measurements");
+		return;
+	}
+
+	double sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+	foreach(const SipLoadSample &sample, FSamples)
+	{
+		sx += sample.calls;
+		sy += sample.cpuLoad;
+		sxx += (double)sample.calls*sample.calls;
+		sxy += sample.calls*sample.cpuLoad;
+	}
+
+	double det = n*sxx - sx*sx;
+	double cost = det>0.0 ? (n*sxy - sx*sy)/det : sy/sx;
+	double base = (sy - cost*sx)/n;
+
+	double ssRes = 0.0, ssTot = 0.0, maxDeviation = 0.0;
+	foreach(const SipLoadSample &sample, FSamples)
+	{
+		double fit = base + cost*sample.calls;
+		ssRes += (sample.cpuLoad-fit)*(sample.cpuLoad-fit);
+		ssTot += (sample.cpuLoad-sy/n)*(sample.cpuLoad-sy/n);
+		if (fit > 0.0)
+			maxDeviation = qMax(maxDeviation,qAbs(sample.cpuLoad-fit)/fit);
+	}
+	double r2 = ssTot>0.0 ? 1.0-ssRes/ssTot : 1.0;
+
+	LOG_INFO(QString("SIP load benchmark finished, steps=%1, per-call=%2%, base=%3%, r2=%4, max-deviation=%5%, linear=%6").arg(n).arg(cost,0,'f',3).arg(base,0,'f',2).arg(r2,0,'f',3).arg(100.0*maxDeviation,0,'f',1).arg(r2>=LINEARITY_MIN_R2));
+	foreach(const SipLoadSample &sample, FSamples)
+		LOG_INFO(QString("  calls=%1, cpu=%2%, per-call=%3%, fit=%4%").arg(sample.calls).arg(sample.cpuLoad,0,'f',2).arg(sample.callCost,0,'f',3).arg(base+cost*sample.calls,0,'f',2));
+}
+
+int SipLoadBenchmark::confirmedCalls() const
+{
+	int confirmed = 0;
+	foreach(ISipCall *call, FCalls)
+		if (call->state() == ISipCall::Confirmed)
+			confirmed++;
+	return confirmed;
+}
+
+qint64 SipLoadBenchmark::processCpuTime()
+{
+#if defined(Q_OS_WIN)
+	FILETIME creationTime, exitTime, kernelTime, userTime;
+	if (GetProcessTimes(GetCurrentProcess(),&creationTime,&exitTime,&kernelTime,&userTime))
+	{
+		quint64 kernel = ((quint64)kernelTime.dwHighDateTime<<32) | kernelTime.dwLowDateTime;
+		quint64 user = ((quint64)userTime.dwHighDateTime<<32) | userTime.dwLowDateTime;
+		return (kernel+user)/10;
+	}
+	return 0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF,&usage) == 0)
+		return (qint64)(usage.ru_utime.tv_sec+usage.ru_stime.tv_sec)*1000000 + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+	return 0;
+#endif
+}
+
+void SipLoadBenchmark::onStepTimerTimeout()
+{
+	int calls = FSteps.value(FStep);
+	if (FPhase == Connecting)
+	{
+		if (confirmedCalls() == calls*2)
+		{
+			// Measurement starts only when all calls have media flowing
+			FPhase = Measuring;
+			FCpuStart = processCpuTime();
+			FClock.start();
+			FStepTimer.start(FStepTime*1000);
+		}
+		else if (FClock.elapsed() < CONNECT_TIMEOUT)
+		{
+			FStepTimer.start(CONNECT_CHECK_INTERVAL);
+		}
+		else
+		{
+			LOG_ERROR(QString("SIP load benchmark aborted, calls=%1, confirmed=%2: Calls not connected").arg(calls).arg(confirmedCalls()));
+			printReport();
+			stop();
+			emit finished();
+		}
+	}
+	else if (FPhase == Measuring)
+	{
+		if (confirmedCalls() == calls*2)
+		{
+			finishStep();
+			if (++FStep < FSteps.count())
+			{
+				startStep();
+			}
+			else
+			{
+				printReport();
+				stop();
+				emit finished();
+			}
+		}
+		else
+		{
+			LOG_ERROR(QString("SIP load benchmark aborted, calls=%1, confirmed=%2: Calls disconnected while measuring").arg(calls).arg(confirmedCalls()));
+			printReport();
+			stop();
+			emit finished();
+		}
+	}
+}
+
+void SipLoadBenchmark::onSipCallDestroyed(ISipCall *ACall)
+{
+	FCalls.removeAll(ACall);
+}
@@ -0,0 +1,61 @@
+#ifndef SIPLOADBENCHMARK_H
+#define SIPLOADBENCHMARK_H
+
+#include <QList>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <interfaces/isipphone.h>
+
+struct SipLoadSample
+{
+	int calls;
+	double cpuLoad;       // percents of one core
+	double callCost;      // percents of one core per call
+};
+
+class SipLoadBenchmark :
+	public QObject,
+	public ISipCallHandler
+{
+	Q_OBJECT;
+	Q_INTERFACES(ISipCallHandler);
+public:
+	SipLoadBenchmark(ISipPhone *APhone, QObject *AParent);
+	bool isRunning() const;
+	bool start(int AMaxCalls, int AStepTime);
+	void stop();
+	//ISipCallHandler
+	virtual bool sipCallReceive(int AOrder, ISipCall *ACall);
+signals:
+	void finished();
+protected:
+	bool startStep();
+	void finishStep();
+	void printReport() const;
+	int confirmedCalls() const;
+	static qint64 processCpuTime();
+protected slots:
+	void onStepTimerTimeout();
+	void onSipCallDestroyed(ISipCall *ACall);
+private:
+	enum Phase {
+		Idle,
+		Connecting,
+		Measuring
+	};
+	Phase FPhase;
+	ISipPhone *FSipPhone;
+	QUuid FAccountId;
+	QString FTargetUri;
+	QTimer FStepTimer;
+	int FStepTime;
+private:
+	int FStep;
+	QList<int> FSteps;
+	QList<ISipCall *> FCalls;
+	QList<SipLoadSample> FSamples;
+	QElapsedTimer FClock;
+	qint64 FCpuStart;
+};
+
+#endif // SIPLOADBENCHMARK_H
@@ -1,2 +1,2 @@
-set(SOURCES sipphone.cpp sipcall.cpp renderdev.cpp sipworker.cpp)
-set(HEADERS sipevent.h sipphone.h sipcall.h renderdev.h sipworker.h)
+set(SOURCES sipphone.cpp sipcall.cpp renderdev.cpp sipworker.cpp sipeventtrace.cpp siptonegen.cpp sipvideoadapter.cpp sipadmission.cpp sipaudiodevice.cpp sipconference.cpp sipbridgebypass.cpp siploadbenchmark.cpp)
+set(HEADERS sipevent.h sipphone.h sipcall.h renderdev.h sipworker.h sipeventtrace.h siptonegen.h sipvideoadapter.h sipadmission.h sipaudiodevice.h sipconference.h sipbridgebypass.h siploadbenchmark.h)
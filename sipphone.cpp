@@ -1,1050 +1,1712 @@
-#include "sipphone.h"
-
-#include <QStringList>
-#include <definitions/version.h>
-#include <definitions/sipphone/optionvalues.h>
-#include <utils/options.h>
-#include <utils/logger.h>
-#include <utils/jid.h>
-#include "renderdev.h"
-
-#define DEF_SIP_UDP_PORT              0
-#define DEF_SIP_TCP_PORT              0
-#define DEF_SIP_ICE_ENABLED           false
-#define DEF_SIP_STUN_HOST             ""
-
-SipPhone *SipPhone::FInstance = NULL;
-
-SipPhone::SipPhone()
-{
-	FSipStackInited = false;
-	FInstance = this;
-
-	FSipWorker = new SipWorker(this);
-	connect(FSipWorker,SIGNAL(taskFinished(SipTask *)),SLOT(onSipWorkerTaskFinished(SipTask *)));
-
-	qRegisterMetaType<SipEvent *>("SipEvent *");
-}
-
-SipPhone::~SipPhone()
-{
-	delete FSipWorker;
-	FInstance = NULL;
-}
-
-void SipPhone::pluginInfo(IPluginInfo *APluginInfo)
-{
-	APluginInfo->name = tr("SIP Phone");
-	APluginInfo->description = tr("Allows to make voice and video calls over SIP protocol");
-	APluginInfo->version = "1.0";
-	APluginInfo->author = "Potapov S.A. aka Lion";
-	APluginInfo->homePage = "http://www.vacuum-im.org";
-}
-
-bool SipPhone::initConnections(IPluginManager *APluginManager, int &AInitOrder)
-{
-	Q_UNUSED(AInitOrder);
-	FPluginManager = APluginManager;
-
-	connect(Options::instance(),SIGNAL(optionsOpened()),SLOT(onOptionsOpened()));
-	connect(Options::instance(),SIGNAL(optionsClosed()),SLOT(onOptionsClosed()));
-
-	return true;
-}
-
-bool SipPhone::initObjects()
-{
-	return true;
-}
-
-bool SipPhone::initSettings()
-{
-	Options::setDefaultValue(OPV_SIPPHONE_UPDPORT,DEF_SIP_UDP_PORT);
-	Options::setDefaultValue(OPV_SIPPHONE_TCPPORT,DEF_SIP_TCP_PORT);
-	Options::setDefaultValue(OPV_SIPPHONE_ICEENABLED,DEF_SIP_ICE_ENABLED);
-	Options::setDefaultValue(OPV_SIPPHONE_STUNSERVER,QString(DEF_SIP_STUN_HOST));
-	return true;
-}
-
-bool SipPhone::isCallsAvailable() const
-{
-	return FSipStackInited;
-}
-
-bool SipPhone::isAudioCallsAvailable() const
-{
-	return isCallsAvailable() && FAvailDevices.contains(ISipMedia::Audio);
-}
-
-bool SipPhone::isVideoCallsAvailable() const
-{
-	return isAudioCallsAvailable() && FAvailDevices.contains(ISipMedia::Video);
-}
-
-QList<ISipCall *> SipPhone::sipCalls(bool AActiveOnly) const
-{
-	FLock.lockForRead();
-	QList<ISipCall *> calls;
-	foreach(SipCall *call, FCalls)
-	{
-		if (!AActiveOnly || call->isActive())
-			calls.append(call);
-	}
-	FLock.unlock();
-	return calls;
-}
-
-ISipCall *SipPhone::newCall(const QUuid &AAccountId, const QString &ARemoteUri)
-{
-	if (isCallsAvailable() && FAccounts.contains(AAccountId))
-	{
-		if (pjsua_verify_sip_url(ARemoteUri.toLocal8Bit().constData())==PJ_SUCCESS || pjsua_verify_url(ARemoteUri.toLocal8Bit().constData())==PJ_SUCCESS)
-		{
-			LOG_INFO(QString("SIP call created as caller, call=%1, accId=%2, uri=%3").arg(-1).arg(AAccountId.toString(),ARemoteUri));
-			SipCall *call = new SipCall(AAccountId,FAccounts.value(AAccountId),ARemoteUri,this);
-			appendCall(call);
-			return call;
-		}
-		else
-		{
-			LOG_ERROR(QString("Failed to create SIP call, accId=%1, uri=%2: Invalid SIP uri").arg(AAccountId.toString(),ARemoteUri));
-		}
-	}
-	else if (!FAccounts.contains(AAccountId))
-	{
-		REPORT_ERROR("Failed to create SIP call: Account not found");
-	}
-	else if (!isCallsAvailable())
-	{
-		REPORT_ERROR("Failed to create SIP call: Calls is not available");
-	}
-	return NULL;
-}
-
-QList<QUuid> SipPhone::availAccounts() const
-{
-	return FAccounts.keys();
-}
-
-QString SipPhone::accountUri(const QUuid &AAccountId) const
-{
-	if (FAccounts.contains(AAccountId))
-	{
-		pjsua_acc_info accInfo;
-		if (pjsua_acc_get_info(FAccounts.value(AAccountId),&accInfo) == PJ_SUCCESS)
-			return QString::fromLocal8Bit(accInfo.acc_uri.ptr);
-	}
-	return QString::null;
-}
-
-ISipAccountConfig SipPhone::accountConfig(const QUuid &AAccountId) const
-{
-	ISipAccountConfig config;
-	if (FAccounts.contains(AAccountId))
-	{
-		pjsua_acc_config accCfg;
-		pj_pool_t *tmp_pool = pjsua_pool_create("tmp-acc-pool", 1024, 1024);
-		if (pjsua_acc_get_config(FAccounts.value(AAccountId),tmp_pool,&accCfg)==PJ_SUCCESS && accCfg.cred_count>0)
-		{
-			config.userid = accCfg.id.ptr;
-			config.userid.chop(1);
-			config.userid.remove(0,5);
-
-			config.password = accCfg.cred_info[0].data.ptr;
-
-			if (accCfg.proxy_cnt > 0)
-				parseSipUri(accCfg.proxy[0].ptr,config.proxyHost,config.proxyPort);
-			parseSipUri(accCfg.reg_uri.ptr,config.serverHost,config.serverPort);
-		}
-		pj_pool_release(tmp_pool);
-	}
-	return config;
-}
-
-bool SipPhone::isAccountRegistered(const QUuid &AAccountId) const
-{
-	if (FAccounts.contains(AAccountId))
-	{
-		pjsua_acc_info accInfo;
-		if (pjsua_acc_get_info(FAccounts.value(AAccountId),&accInfo) == PJ_SUCCESS)
-			return accInfo.expires>0;
-	}
-	return false;
-}
-
-bool SipPhone::setAccountRegistered(const QUuid &AAccountId, bool ARegistered)
-{
-	if (FAccounts.contains(AAccountId) && isAccountRegistered(AAccountId)!=ARegistered)
-	{
-		pj_status_t status = pjsua_acc_set_registration(FAccounts.value(AAccountId), ARegistered ? PJ_TRUE : PJ_FALSE);
-		if (status == PJ_SUCCESS)
-		{
-			LOG_INFO(QString("SIP account registration request sent, accId=%1, register=%2").arg(AAccountId.toString()).arg(ARegistered));
-			return true;
-		}
-		else
-		{
-			LOG_ERROR(QString("Failed to send SIP account registration request, accId=%1: %2").arg(AAccountId.toString()).arg(resolveSipError(status)));
-		}
-	}
-	return false;
-}
-
-bool SipPhone::insertAccount(const QUuid &AAccountId, const ISipAccountConfig &AConfig)
-{
-	if (FSipStackInited && !AAccountId.isNull() && !FAccounts.contains(AAccountId) && isValidConfig(AConfig))
-	{
-		pjsua_acc_config accCfg;
-		if (parseConfig(AConfig, accCfg))
-		{
-			pjsua_acc_id accIndex;
-			pj_status_t status = pjsua_acc_add(&accCfg, PJ_FALSE, &accIndex);
-			if (status == PJ_SUCCESS)
-			{
-				LOG_INFO(QString("SIP account inserted, accId=%1, accIdx=%2").arg(AAccountId.toString()).arg(accIndex));
-				FAccounts.insert(AAccountId,accIndex);
-				emit accountInserted(AAccountId);
-				return true;
-			}
-			else
-			{
-				LOG_ERROR(QString("Failed to create SIP account, accId=%1: %2").arg(AAccountId.toString()).arg(resolveSipError(status)));
-			}
-		}
-		else
-		{
-			LOG_ERROR(QString("Failed to create SIP account, accId=%1: Config not parsed").arg(AAccountId.toString()));
-		}
-	}
-	else if (!FSipStackInited)
-	{
-		LOG_ERROR(QString("Failed to create SIP account, accId=%1: SIP stack not initialized").arg(AAccountId.toString()));
-	}
-	else if (AAccountId.isNull())
-	{
-		LOG_ERROR(QString("Failed to create SIP account, accId=%1: Account Id is null").arg(AAccountId.toString()));
-	}
-	else if (FAccounts.contains(AAccountId))
-	{
-		LOG_ERROR(QString("Failed to create SIP account, accId=%1: Account Id already exists").arg(AAccountId.toString()));
-	}
-	else if (!isValidConfig(AConfig))
-	{
-		LOG_ERROR(QString("Failed to create SIP account, accId=%1: Invalid config").arg(AAccountId.toString()));
-	}
-	return false;
-}
-
-bool SipPhone::updateAccount(const QUuid &AAccountId, const ISipAccountConfig &AConfig)
-{
-	if (FAccounts.contains(AAccountId) && isValidConfig(AConfig))
-	{
-		pjsua_acc_config accCfg;
-		if (parseConfig(AConfig, accCfg))
-		{
-			pjsua_acc_id accIndex = FAccounts.value(AAccountId);
-			pj_status_t status = pjsua_acc_modify(accIndex, &accCfg);
-			if (status == PJ_SUCCESS)
-			{
-				LOG_INFO(QString("SIP account updated, accId=%1").arg(AAccountId.toString()));
-				emit accountChanged(AAccountId);
-				return true;
-			}
-			else
-			{
-				LOG_ERROR(QString("Failed to update SIP account, accId=%1: %2").arg(AAccountId.toString()).arg(resolveSipError(status)));
-			}
-		}
-		else
-		{
-			LOG_ERROR(QString("Failed to update SIP account, accId=%1: Config not parsed").arg(AAccountId.toString()));
-		}
-	}
-	else if (!FAccounts.contains(AAccountId))
-	{
-		LOG_ERROR(QString("Failed to update SIP account, accId=%1: Account not found").arg(AAccountId.toString()));
-	}
-	else if (!isValidConfig(AConfig))
-	{
-		LOG_ERROR(QString("Failed to update SIP account, accId=%1: Invalid config").arg(AAccountId.toString()));
-	}
-	return false;
-}
-
-void SipPhone::removeAccount(const QUuid &AAccountId)
-{
-	if (FAccounts.contains(AAccountId))
-	{
-		LOG_INFO(QString("Removing SIP account, accId=%1").arg(AAccountId.toString()));
-
-		qDeleteAll(findCallsByAccount(AAccountId));
-		setAccountRegistered(AAccountId,false);
-
-		pjsua_acc_del(FAccounts.take(AAccountId));
-
-		emit accountRemoved(AAccountId);
-	}
-}
-
-bool SipPhone::updateAvailDevices()
-{
-	if (FSipStackInited && pjsua_call_get_count()==0 && FVideoPreviewWidgets.isEmpty())
-	{
-		QMultiMap<int,ISipDevice> devices;
-
-		unsigned numAudDevices = 64;
-		pjmedia_aud_dev_info audDevInfo[64];
-		if (pjmedia_aud_dev_refresh()==PJ_SUCCESS && pjsua_enum_aud_devs(audDevInfo, &numAudDevices)==PJ_SUCCESS)
-		{
-			LOG_DEBUG(QString("Found %1 SIP audio devices").arg(numAudDevices));
-			for (unsigned devIndex = 0; devIndex < numAudDevices; devIndex++)
-			{
-				ISipDevice device;
-				device.type = ISipMedia::Audio;
-				device.index = devIndex;
-				device.name = QString::fromLocal8Bit(audDevInfo[devIndex].name);
-				device.formats = parseMediaFormats(audDevInfo[devIndex].ext_fmt,audDevInfo[devIndex].ext_fmt_cnt,ISipMedia::Audio);
-				
-				if (audDevInfo[devIndex].input_count>0 && audDevInfo[devIndex].output_count>0)
-					device.dir = ISipMedia::CaptureAndPlayback;
-				else if (audDevInfo[devIndex].input_count > 0)
-					device.dir = ISipMedia::Capture;
-				else if (audDevInfo[devIndex].output_count > 0)
-					device.dir = ISipMedia::Playback;
-
-				devices.insertMulti(device.type,device);
-
-				QStringList formats;
-				for (int i=0; i<device.formats.count(); i++)
-				{
-					char fid_str[5] = {'L','1','6',' ','\0' };
-					const ISipMediaFormat &format = device.formats.at(i);
-					if (format.id > 0)
-						memcpy(fid_str,&format.id,4);
-					formats.append(fid_str);
-				}
-
-				LOG_DEBUG(QString("  dev_i %1: %2 (driver=%3, in=%4, out=%5, fmt=%6) %7").arg(devIndex).arg(QString::fromLocal8Bit(audDevInfo[devIndex].name),QString::fromLocal8Bit(audDevInfo[devIndex].driver)).arg(audDevInfo[devIndex].input_count).arg(audDevInfo[devIndex].output_count).arg(device.formats.count()).arg(formats.join(", ")));
-			}
-		}
-		else
-		{
-			LOG_ERROR("Failed to update SIP audio devices");
-		}
-
-		unsigned numVidDevices = 64;
-		pjmedia_vid_dev_info vidDevInfo[64];
-		if (pjmedia_vid_dev_refresh()==PJ_SUCCESS && pjsua_vid_enum_devs(vidDevInfo, &numVidDevices)==PJ_SUCCESS)
-		{
-			LOG_DEBUG(QString("Found %1 SIP video devices").arg(numVidDevices));
-			for (unsigned devIndex = 0; devIndex < numVidDevices; devIndex++)
-			{
-				ISipDevice device;
-				device.type = ISipMedia::Video;
-				device.index = devIndex;
-				device.name = QString::fromLocal8Bit(vidDevInfo[devIndex].name);
-				device.formats = parseMediaFormats(vidDevInfo[devIndex].fmt,vidDevInfo[devIndex].fmt_cnt,ISipMedia::Video);
-
-				if (vidDevInfo[devIndex].fmt_cnt > 0)
-				{
-					if (vidDevInfo[devIndex].dir == PJMEDIA_DIR_CAPTURE_PLAYBACK)
-						device.dir = ISipMedia::CaptureAndPlayback;
-					else if (vidDevInfo[devIndex].dir == PJMEDIA_DIR_CAPTURE)
-						device.dir = ISipMedia::Capture;
-					else if (vidDevInfo[devIndex].dir == PJMEDIA_DIR_PLAYBACK)
-						device.dir = ISipMedia::Playback;
-
-					devices.insertMulti(device.type,device);
-				}
-
-				QStringList formats;
-				for (int i=0; i<device.formats.count(); i++)
-				{
-					char fid_str[5] = {'L','1','6',' ','\0' };
-					const ISipMediaFormat &format = device.formats.at(i);
-					if (format.id > 0)
-						memcpy(fid_str,&format.id,4);
-					formats.append(fid_str);
-				}
-
-				LOG_DEBUG(QString("  .dev_i %1: %2 (driver=%3, dir=%4, fmt=%5) %6").arg(devIndex).arg(QString::fromLocal8Bit(vidDevInfo[devIndex].name),QString::fromLocal8Bit(vidDevInfo[devIndex].driver)).arg(vidDevInfo[devIndex].dir).arg(device.formats.count()).arg(formats.join(", ")));
-			}
-		}
-		else
-		{
-			LOG_ERROR("Failed to update SIP video devices");
-		}
-
-		if (FAvailDevices != devices)
-		{
-			FAvailDevices = devices;
-			emit availDevicesChanged();
-			return true;
-		}
-	}
-	else if (!FSipStackInited)
-	{
-		LOG_ERROR("Failed to update avail SIP devices: SIP stack not initialize");
-	}
-	else if (pjsua_call_get_count() > 0)
-	{
-		LOG_ERROR("Failed to update avail SIP devices: Active calls found");
-	}
-	else if (FVideoPreviewWidgets.isEmpty())
-	{
-		LOG_ERROR("Failed to update avail SIP devices: Active preview widgets found");
-	}
-	return false;
-}
-
-ISipDevice SipPhone::findDevice(ISipMedia::Type AType, int AIndex) const
-{
-	for (QMap<int,ISipDevice>::const_iterator it=FAvailDevices.constBegin(); it!=FAvailDevices.constEnd(); ++it)
-		if (it.key()==AType && it->index==AIndex)
-			return it.value();
-	return ISipDevice();
-}
-
-ISipDevice SipPhone::findDevice(ISipMedia::Type AType, const QString &AName) const
-{
-	for (QMap<int,ISipDevice>::const_iterator it=FAvailDevices.constBegin(); it!=FAvailDevices.constEnd(); ++it)
-		if (it.key()==AType && it->name==AName)
-			return it.value();
-	return ISipDevice();
-}
-
-ISipDevice SipPhone::defaultDevice(ISipMedia::Type AType, ISipMedia::Direction ADir) const
-{
-	if (AType==ISipMedia::Video && ADir==ISipMedia::Playback)
-		return findDevice(ISipMedia::Video,QT_RENDER_DEVICE_NAME);
-
-	QList<ISipDevice> devices = availDevices(AType,ADir);
-	qSort(devices.begin(),devices.end());
-
-	return devices.value(0);
-}
-
-QList<ISipDevice> SipPhone::availDevices(ISipMedia::Type AType, ISipMedia::Direction ADir) const
-{
-	QList<ISipDevice> devices = FAvailDevices.values(AType);
-	for (QList<ISipDevice>::iterator it=devices.begin(); it!=devices.constEnd(); )
-	{
-		if ((it->dir & ADir) != ADir)
-			it = devices.erase(it);
-		else
-			++it;
-	}
-	return devices;
-}
-
-QWidget *SipPhone::startVideoPreview(const ISipDevice &ADevice, QWidget *AParent)
-{
-	VideoWindow *widget = NULL;
-	if (ADevice.index>=0 && ADevice.type==ISipMedia::Video && (ADevice.dir & ISipMedia::Capture)>0 && FAvailDevices.values(ADevice.type).contains(ADevice))
-	{
-		LOG_DEBUG(QString("Starting SIP video preview, devIdx=%1, devName=%2").arg(ADevice.index).arg(ADevice.name));
-
-		VideoSurface *surface = NULL;
-		if (!FVideoPreviewWidgets.contains(ADevice.index))
-		{
-			SipTaskStartPreview *task = new SipTaskStartPreview(ADevice.index,defaultDevice(ISipMedia::Video,ISipMedia::Playback).index);
-			if (FSipWorker->startTask(task))
-				LOG_DEBUG(QString("SIP video preview start task started, devIdx=%1, devName=%2").arg(ADevice.index).arg(ADevice.name));
-			else
-				LOG_ERROR(QString("Failed to start SIP video preview start task, devIdx=%1, devName=%2").arg(ADevice.index).arg(ADevice.name));
-		}
-		else
-		{
-			surface = FVideoPreviewWidgets.value(ADevice.index)->surface();
-		}
-		
-		widget = new VideoWindow(AParent);
-		widget->setSurface(surface);
-		connect(widget,SIGNAL(windowDestroyed()),SLOT(onVideoPreviewWidgetDestroyed()));
-		FVideoPreviewWidgets.insertMulti(ADevice.index,widget);
-	}
-	else
-	{
-		LOG_ERROR(QString("Failed to start SIP video preview, devIdx=%1, devName=%2: Invalid device").arg(ADevice.index).arg(ADevice.name));
-	}
-	return widget;
-}
-
-void SipPhone::stopVideoPreview(QWidget *APreview)
-{
-	VideoWindow *widget = qobject_cast<VideoWindow *>(APreview);
-	int devIndex = FVideoPreviewWidgets.key(widget,PJSUA_INVALID_ID);
-	if (devIndex != PJSUA_INVALID_ID)
-	{
-		LOG_DEBUG(QString("Stopping SIP video preview, devIdx=%1").arg(devIndex));
-
-		FVideoPreviewWidgets.remove(devIndex,widget);
-		if (!FVideoPreviewWidgets.contains(devIndex))
-		{
-			SipTaskStopPreview *task = new SipTaskStopPreview(devIndex);
-			if (FSipWorker->startTask(task))
-				LOG_DEBUG(QString("SIP video preview stop task started, devIdx=%1").arg(devIndex));
-			else
-				LOG_ERROR(QString("Failed to start SIP video preview stop task, devIdx=%1").arg(devIndex));
-		}
-	}
-	else
-	{
-		LOG_WARNING("Failed to stop SIP video preview: Device not found");
-	}
-}
-
-QMultiMap<int,ISipCallHandler *> SipPhone::callHandlers() const
-{
-	return FCallHandlers;
-}
-
-void SipPhone::insertCallHandler(int AOrder, ISipCallHandler *AHandler)
-{
-	if (AHandler && !FCallHandlers.contains(AOrder,AHandler))
-	{
-		LOG_DEBUG(QString("SIP call handler inserted, order=%1, handler=%2").arg(AOrder).arg((quint64)AHandler));
-		FCallHandlers.insertMulti(AOrder,AHandler);
-	}
-}
-
-void SipPhone::removeCallHandler(int AOrder, ISipCallHandler *AHandler)
-{
-	if (FCallHandlers.contains(AOrder,AHandler))
-	{
-		LOG_DEBUG(QString("SIP call handler removed, order=%1, handler=%2").arg(AOrder).arg((quint64)AHandler));
-		FCallHandlers.remove(AOrder,AHandler);
-	}
-}
-
-void SipPhone::initSipStack()
-{
-	if (!FSipStackInited)
-	{
-		SipTaskCreateStack::Params params;
-		params.stun = Options::node(OPV_SIPPHONE_STUNSERVER).value().toString();
-		params.enableIce = Options::node(OPV_SIPPHONE_ICEENABLED).value().toBool();
-		params.udpPort = Options::node(OPV_SIPPHONE_UPDPORT).value().toUInt();
-		params.tcpPort = Options::node(OPV_SIPPHONE_TCPPORT).value().toUInt();
-		params.userAgent = QString(CLIENT_NAME) + "/" + FPluginManager->version();
-		//params.logFileName = QString(FPluginManager->homePath()+"/logs/pjsip.log");
-
-		pj_bzero(&params.callBack, sizeof(params.callBack));
-		params.callBack.on_reg_state = &pjcbOnRegState;
-		params.callBack.on_nat_detect = &pjcbOnNatDetect;
-		params.callBack.on_incoming_call = &pjcbOnIncomingCall;
-		params.callBack.on_call_state = &pjcbOnCallState;
-		params.callBack.on_call_media_state = &pjcbOnCallMediaState;
-		params.callBack.on_call_media_event = &pjcbOnCallMediaEvent;
-
-		params.vdf = &qwidget_factory_create;
-
-		SipTaskCreateStack *task = new SipTaskCreateStack(params);
-		if (FSipWorker->startTask(task))
-			LOG_INFO(QString("Create SIP stack task started, stun='%1', ice=%2, udp=%3, tcp=%4, ua='%5'").arg(params.stun).arg(params.enableIce).arg(params.udpPort).arg(params.tcpPort).arg(params.userAgent));
-		else
-			LOG_ERROR("Failed to start create SIP stack task");
-	}
-}
-
-void SipPhone::loadSipParams()
-{
-	if (FSipStackInited)
-	{
-		const pj_str_t h264Id = pj_str((char *)"H264");
-		pjmedia_vid_codec_param h264Params;
-		pjsua_vid_codec_get_param(&h264Id, &h264Params);
-		h264Params.enc_fmt.det.vid.size.w = 640;
-		h264Params.enc_fmt.det.vid.size.h = 480;
-		h264Params.enc_fmt.det.vid.fps.num = 25;
-		h264Params.enc_fmt.det.vid.fps.denum = 1;
-		h264Params.enc_fmt.det.vid.avg_bps = 512000;
-		h264Params.enc_fmt.det.vid.max_bps = 512000;
-		pjsua_vid_codec_set_param(&h264Id, &h264Params);
-
-		const pj_str_t h263Id = pj_str((char *)"H263");
-		pjmedia_vid_codec_param h263Params;
-		pjsua_vid_codec_get_param(&h263Id, &h263Params);
-		h263Params.enc_fmt.det.vid.size.w = 640;
-		h263Params.enc_fmt.det.vid.size.h = 480;
-		h263Params.enc_fmt.det.vid.fps.num = 25;
-		h263Params.enc_fmt.det.vid.fps.denum = 1;
-		h263Params.enc_fmt.det.vid.avg_bps = 512000;
-		h263Params.enc_fmt.det.vid.max_bps = 512000;
-		pjsua_vid_codec_set_param(&h263Id, &h263Params);
-	}
-}
-
-void SipPhone::destroySipStack()
-{
-	if (FSipStackInited)
-	{
-		LOG_INFO("Destroing SIP stack");
-
-		foreach(const QString &sipid, FAccounts.keys())
-			removeAccount(sipid);
-
-		foreach(VideoWindow *widget, FVideoPreviewWidgets.values())
-			delete widget;
-
-		SipTaskDestroyStack *task = new SipTaskDestroyStack;
-		if (FSipWorker->startTask(task))
-			LOG_DEBUG("Destroy SIP stack task started");
-		else
-			LOG_ERROR("Failed to start destroy SIP stack task");
-	}
-}
-
-QString SipPhone::resolveSipError(int ACode) const
-{
-	char errmsg[PJ_ERR_MSG_SIZE];
-	pj_strerror(ACode, errmsg, sizeof(errmsg));
-	return QString(errmsg);
-}
-
-bool SipPhone::isValidConfig(const ISipAccountConfig &AConfig) const
-{
-	char id_url[1030];
-	pj_ansi_snprintf(id_url,sizeof(id_url),"<sip:%s>",AConfig.userid.toLocal8Bit().constData());
-	return pjsua_verify_sip_url(id_url)==PJ_SUCCESS;
-}
-
-bool SipPhone::parseConfig(const ISipAccountConfig &ASrc, pjsua_acc_config &ADst) const
-{
-	pjsua_acc_config_default(&ADst);
-
-	ADst.register_on_acc_add = PJ_FALSE;
-	ADst.allow_via_rewrite = PJ_FALSE;
-	ADst.allow_contact_rewrite = PJ_FALSE;
-
-	Jid userId = ASrc.userid;
-	QString serverHost = ASrc.serverHost.isEmpty() ? userId.domain() : ASrc.serverHost;
-
-	static char id_url[1030];
-	pj_ansi_snprintf(id_url,sizeof(id_url),"<sip:%s>",ASrc.userid.toLocal8Bit().constData());
-
-	static char reguri[1030];
-	if (ASrc.serverPort > 0)
-		pj_ansi_snprintf(reguri,sizeof(reguri),"<sip:%s:%u>",serverHost.toLocal8Bit().constData(),ASrc.serverPort);
-	else
-		pj_ansi_snprintf(reguri,sizeof(reguri),"<sip:%s>",serverHost.toLocal8Bit().constData());
-
-	static char username[512];
-	pj_ansi_snprintf(username,sizeof(username),"%s",userId.node().toLocal8Bit().constData());
-
-	static char password[512];
-	pj_ansi_snprintf(password,sizeof(password),"%s",ASrc.password.toLocal8Bit().constData());
-
-	ADst.id = pj_str(id_url);
-	ADst.reg_uri = pj_str(reguri);
-
-	ADst.vid_in_auto_show = PJ_FALSE;
-	ADst.vid_out_auto_transmit = PJ_TRUE;
-	ADst.vid_cap_dev = defaultDevice(ISipMedia::Video,ISipMedia::Capture).index;
-	ADst.vid_rend_dev = defaultDevice(ISipMedia::Video,ISipMedia::Playback).index;
-
-	ADst.cred_count = 1;
-	ADst.cred_info[0].realm = pj_str((char *)"*");
-	ADst.cred_info[0].scheme = pj_str((char *)"digest");
-	ADst.cred_info[0].username = pj_str(username);
-	ADst.cred_info[0].data = pj_str(password);
-	ADst.cred_info[0].data_type = PJSIP_CRED_DATA_PLAIN_PASSWD;
-
-	if (!ASrc.proxyHost.isEmpty())
-	{
-		static char proxy[512];
-		if (ASrc.proxyPort > 0)
-			pj_ansi_snprintf(proxy,sizeof(proxy),"<sip:%s:%u>",ASrc.proxyHost.toLocal8Bit().constData(),ASrc.proxyPort);
-		else
-			pj_ansi_snprintf(proxy,sizeof(proxy),"<sip:%s>",ASrc.proxyHost.toLocal8Bit().constData());
-		ADst.proxy[ADst.proxy_cnt++] = pj_str(proxy);
-	}
-
-	return true;
-}
-
-bool SipPhone::parseSipUri(const QString &AUri, QString &AAddress, quint16 &APort) const
-{
-	if (!AUri.isEmpty())
-	{
-		QString uri = AUri;
-		if (uri.startsWith('<'))
-		{
-			uri.chop(1);
-			uri.remove(0,1);
-		}
-
-		if (uri.startsWith("sip:"))
-			uri.remove(0,4);
-
-		if (!uri.isEmpty())
-		{
-			QStringList parts = uri.split(':',QString::SkipEmptyParts);
-			AAddress = parts.value(0);
-			APort = parts.value(0).toUInt();
-			return true;
-		}
-	}
-	return false;
-}
-
-QList<ISipMediaFormat> SipPhone::parseMediaFormats(pjmedia_format AFormats[], int ACount, int AType) const
-{
-	QList<ISipMediaFormat> formats;
-	for (int i=0; i<ACount; i++)
-	{
-		if (AType == ISipMedia::Audio)
-		{
-			ISipMediaFormat format;
-			format.type = ISipMedia::Audio;
-			format.id = AFormats[i].id;
-			format.details.aud.clockRate = AFormats[i].det.aud.clock_rate;
-			format.details.aud.channelCount = AFormats[i].det.aud.channel_count;
-			format.details.aud.frameTimeUsec = AFormats[i].det.aud.frame_time_usec;
-			format.details.aud.bitsPerSample = AFormats[i].det.aud.bits_per_sample;
-			format.details.aud.avgBitrate = AFormats[i].det.aud.avg_bps;
-			format.details.aud.maxBitrate = AFormats[i].det.aud.max_bps;
-			formats.append(format);
-		}
-		else if (AType == ISipMedia::Video)
-		{
-			ISipMediaFormat format;
-			format.type = ISipMedia::Video;
-			format.id = AFormats[i].id;
-			format.details.vid.fpsNum = AFormats[i].det.vid.fps.num;
-			format.details.vid.fpsDenum = AFormats[i].det.vid.fps.denum;
-			format.details.vid.width = AFormats[i].det.vid.size.w;
-			format.details.vid.height = AFormats[i].det.vid.size.h;
-			format.details.vid.avgBitrate = AFormats[i].det.vid.avg_bps;
-			format.details.vid.maxBitrate = AFormats[i].det.vid.max_bps;
-			formats.append(format);
-		}
-	}
-	return formats;
-}
-
-void SipPhone::appendCall(SipCall *ACall)
-{
-	if (ACall && !FCalls.contains(ACall))
-	{
-		FLock.lockForWrite();
-		connect(ACall,SIGNAL(stateChanged()),SLOT(onSipCallStateChanged()));
-		connect(ACall,SIGNAL(statusChanged()),SLOT(onSipCallStatusChanged()));
-		connect(ACall,SIGNAL(mediaChanged()),SLOT(onSipCallMediaChanged()));
-		connect(ACall,SIGNAL(callDestroyed()),SLOT(onSipCallDestroyed()));
-		FCalls.append(ACall);
-		FLock.unlock();
-		emit callCreated(ACall);
-	}
-}
-
-void SipPhone::removeCall(SipCall *ACall)
-{
-	if (FCalls.contains(ACall))
-	{
-		FLock.lockForWrite();
-		FCalls.removeAll(ACall);
-		FLock.unlock();
-		emit callDestroyed(ACall);
-	}
-}
-
-bool SipPhone::isDuplicateCall(pjsua_call_id ACallIndex) const
-{
-	pjsua_call_id calls[PJSUA_MAX_CALLS];
-	unsigned callCount = sizeof(calls);
-	pjsua_enum_calls(calls,&callCount);
-	if (callCount > 1)
-	{
-		pjsua_call_info ci;
-		if (pjsua_call_get_info(ACallIndex,&ci) == PJ_SUCCESS)
-		{
-			for (unsigned i=0; i<callCount; i++)
-			{
-				if (calls[i] != ACallIndex)
-				{
-					pjsua_call_info ci;
-					pjsua_call_get_info(calls[i],&ci);
-					if (pj_strcmp(&ci.call_id,&ci.call_id) == 0)
-						return true;
-				}
-			}
-		}
-	}
-	return false;
-}
-
-SipCall *SipPhone::findCallByIndex(pjsua_call_id ACallIndex) const
-{
-	SipCall *call = NULL;
-
-	FLock.lockForRead();
-	for (QList<SipCall *>::const_iterator it=FCalls.constBegin(); call==NULL && it!=FCalls.constEnd(); ++it)
-		if ((*it)->callIndex() == ACallIndex)
-			call = *it;
-	FLock.unlock();
-
-	return call;
-}
-
-QList<SipCall *> SipPhone::findCallsByAccount(const QUuid &AAccountId) const
-{
-	QList<SipCall *> calls;
-
-	FLock.lockForRead();
-	for (QList<SipCall *>::const_iterator it=FCalls.constBegin(); it!=FCalls.constEnd(); ++it)
-		if ((*it)->accountId() == AAccountId)
-			calls.append(*it);
-	FLock.unlock();
-
-	return calls;
-}
-
-void SipPhone::processSipEvent(SipEvent *AEvent)
-{
-	switch (AEvent->type)
-	{
-	case SipEvent::RegState:
-		{
-			SipEventRegState *se = static_cast<SipEventRegState *>(AEvent);
-
-			QUuid accId = FAccounts.key(se->accIndex);
-			if (!accId.isNull())
-			{
-				pjsua_acc_info ai;
-				pjsua_acc_get_info(se->accIndex,&ai);
-				bool registered = ai.expires>0;
-				LOG_INFO(QString("SIP account registration changed, accId=%1, registered=%2, status=%3").arg(accId.toString()).arg(registered).arg(ai.status_text.ptr));
-				emit accountRegistrationChanged(accId,registered);
-			}
-
-			delete se;
-		}
-		break;
-	case SipEvent::IncomingCall:
-		{
-			SipEventIncomingCall *se = static_cast<SipEventIncomingCall *>(AEvent);
-
-			QUuid accId = FAccounts.key(se->accIndex);
-			if (!accId.isNull())
-			{
-				if (!isDuplicateCall(se->callIndex))
-				{
-					LOG_INFO(QString("SIP call created as receiver, call=%1, accId=%2").arg(se->callIndex).arg(accId.toString()));
-					SipCall *call = new SipCall(accId,se->accIndex,se->callIndex,this);
-					appendCall(call);
-
-					bool callReceived = false;
-					for (QMultiMap<int,ISipCallHandler *>::const_iterator it=FCallHandlers.constBegin(); !callReceived && it!=FCallHandlers.constEnd(); ++it)
-						callReceived = it.value()->sipCallReceive(it.key(),call);
-
-					if (!callReceived)
-					{
-						LOG_WARNING(QString("Incoming call not accepted, call=%1, accId=%2, uri=%3").arg(call->callIndex()).arg(call->accountId().toString()).arg(call->remoteUri()));
-						call->hangupCall(ISipCall::SC_NotAcceptableHere);
-						call->destroyCall(0);
-					}
-				}
-				else
-				{
-					LOG_DEBUG(QString("Ignoring duplicate incoming call event: call=%1, accId=%2").arg(se->callIndex).arg(accId.toString()));
-				}
-			}
-			else
-			{
-				LOG_WARNING(QString("Received call from unknown account, call=%1, accId=%2").arg(se->accIndex).arg(accId.toString()));
-				pjsua_call_hangup(se->callIndex,PJSIP_SC_NOT_ACCEPTABLE_HERE,NULL,NULL);
-			}
-
-			delete se;
-		}
-		break;
-	default:
-		REPORT_ERROR(QString("Received unexpected SIP event: type=%1").arg(AEvent->type));
-		delete AEvent;
-	}
-}
-
-void SipPhone::onOptionsOpened()
-{
-	initSipStack();
-}
-
-void SipPhone::onOptionsClosed()
-{
-	destroySipStack();
-}
-
-void SipPhone::onSipCallDestroyed()
-{
-	SipCall *call = qobject_cast<SipCall *>(sender());
-	if (call)
-	{
-		LOG_INFO(QString("SIP call destroyed, call=%1, accId=%2, uri=%3").arg(call->callIndex()).arg(call->accountId().toString(),call->remoteUri()));
-		removeCall(call);
-		if (findCallsByAccount(call->accountId()).isEmpty())
-			setAccountRegistered(call->accountId(),false);
-	}
-}
-
-void SipPhone::onSipCallStateChanged()
-{
-	SipCall *call = qobject_cast<SipCall *>(sender());
-	if (call)
-		emit callStateChanged(call);
-}
-
-void SipPhone::onSipCallStatusChanged()
-{
-	SipCall *call = qobject_cast<SipCall *>(sender());
-	if (call)
-		emit callStatusChanged(call);
-}
-
-void SipPhone::onSipCallMediaChanged()
-{
-	SipCall *call = qobject_cast<SipCall *>(sender());
-	if (call)
-		emit callMediaChanged(call);
-}
-
-void SipPhone::onVideoPreviewWidgetDestroyed()
-{
-	VideoWindow *widget = qobject_cast<VideoWindow *>(sender());
-	stopVideoPreview(widget);
-}
-
-void SipPhone::onSipWorkerTaskFinished(SipTask *ATask)
-{
-	switch (ATask->type())
-	{
-	case SipTask::CreateStack:
-		{
-			SipTaskCreateStack *task = static_cast<SipTaskCreateStack *>(ATask);
-			if (task->status() == PJ_SUCCESS)
-			{
-				LOG_INFO("SIP stack initialized");
-
-				pj_thread_register("Qt GUI Thread",FPjThreadDesc,&FPjThread);
-				FSipStackInited = true;
-
-				loadSipParams();
-				updateAvailDevices();
-
-				emit callsAvailChanged(true);
-			}
-			else
-			{
-				LOG_ERROR(QString("Failed to initialize SIP stack: %1").arg(resolveSipError(task->status())));
-			}
-		}
-		break;
-	case SipTask::DestroyStack:
-		{
-			SipTaskCreateStack *task = static_cast<SipTaskCreateStack *>(ATask);
-
-			FCalls.clear();
-			FAccounts.clear();
-			FAvailDevices.clear();
-			FSipStackInited = false;
-
-			if (task->status() == PJ_SUCCESS)
-				LOG_INFO("SIP stack destroyed");
-			else
-				LOG_ERROR(QString("Failed to destroy SIP stack: %1").arg(resolveSipError(task->status())));
-
-			emit callsAvailChanged(false);
-		}
-		break;
-	case SipTask::StartPreview:
-		{
-			SipTaskStartPreview *task = static_cast<SipTaskStartPreview *>(ATask);
-			if (task->status() == PJ_SUCCESS)
-			{
-				if (task->windowType() == QT_RENDER_VID_DEV_TYPE)
-				{
-					VideoSurface *surface = (VideoSurface *)task->window();
-					foreach(VideoWindow *widget, FVideoPreviewWidgets.values(task->captureDev()))
-						widget->setSurface(surface);
-					LOG_DEBUG(QString("SIP video preview started, capIdx=%1, renIdx=%2").arg(task->captureDev()).arg(task->renderDev()));
-				}
-				else
-				{
-					LOG_ERROR(QString("Failed to start SIP video preview, capIdx=%1, renIdx=%2, winType=%3: Incompatible render device type").arg(task->captureDev()).arg(task->renderDev()).arg(task->windowType()));
-				}
-			}
-			else
-			{
-				LOG_ERROR(QString("Failed to start SIP video preview, capIdx=%1, renIdx=%2: %3").arg(task->captureDev()).arg(task->renderDev()).arg(resolveSipError(task->status())));
-			}
-		}
-		break;
-	case SipTask::StopPreview:
-		{
-			SipTaskStopPreview *task = static_cast<SipTaskStopPreview *>(ATask);
-
-			foreach(VideoWindow *widget, FVideoPreviewWidgets.values(task->captureDev()))
-				widget->setSurface(NULL);
-
-			if (task->status() == PJ_SUCCESS)
-				LOG_DEBUG(QString("SIP video preview stopped, capIdx=%1").arg(task->captureDev()));
-			else
-				LOG_ERROR(QString("Failed to stop video preview, capIdx=%1: %2").arg(task->captureDev()).arg(resolveSipError(task->status())));
-		}
-		break;
-	default:
-		REPORT_ERROR(QString("Unexpected SIP task finished, type=%1").arg(ATask->type()));
-		break;
-	}
-	delete ATask;
-}
-
-void SipPhone::pjcbOnRegState(pjsua_acc_id AAccIndex)
-{
-	SipEventRegState *se = new SipEventRegState;
-	se->type = SipEvent::RegState;
-	se->accIndex = AAccIndex;
-	QMetaObject::invokeMethod(FInstance,"processSipEvent",Qt::QueuedConnection,Q_ARG(SipEvent *,se));
-}
-
-void SipPhone::pjcbOnNatDetect(const pj_stun_nat_detect_result *AResult)
-{
-	if (AResult->status == PJ_SUCCESS)
-		LOG_INFO(QString("SIP NAT detected as %1").arg(AResult->nat_type_name));
-	else
-		LOG_ERROR(QString("Failed to detect NAT type: %1").arg(AResult->status));
-}
-
-void SipPhone::pjcbOnIncomingCall(pjsua_acc_id AAccIndex, pjsua_call_id ACallIndex, pjsip_rx_data *AData)
-{
-	Q_UNUSED(AData);
-	SipEventIncomingCall *se = new SipEventIncomingCall;
-	se->type = SipEvent::IncomingCall;
-	se->accIndex = AAccIndex;
-	se->callIndex = ACallIndex;
-	QMetaObject::invokeMethod(FInstance,"processSipEvent",Qt::QueuedConnection,Q_ARG(SipEvent *,se));
-}
-
-void SipPhone::pjcbOnCallState(pjsua_call_id ACallIndex, pjsip_event *AEvent)
-{
-	Q_UNUSED(AEvent);
-	SipCall *call = FInstance->findCallByIndex(ACallIndex);
-	if (call)
-		call->pjcbOnCallState();
-}
-
-void SipPhone::pjcbOnCallMediaState(pjsua_call_id ACallIndex)
-{
-	SipCall *call = FInstance->findCallByIndex(ACallIndex);
-	if (call)
-		call->pjcbOnCallMediaState();
-}
-
-void SipPhone::pjcbOnCallMediaEvent(pjsua_call_id ACallIndex, unsigned AMediaIndex, pjmedia_event *AEvent)
-{
-	SipCall *call = FInstance->findCallByIndex(ACallIndex);
-	if (call)
-		call->pjcbOnCallMediaEvent(AMediaIndex,AEvent);
-}
-
-Q_EXPORT_PLUGIN2(plg_sipphone, SipPhone)
+#include "sipphone.h"
+
+#include <QThread>
+#include <QStringList>
+#include <pjmedia-codec.h>
+#include <definitions/version.h>
+#include <definitions/sipphone/optionvalues.h>
+#include <utils/options.h>
+#include <utils/logger.h>
+#include <utils/jid.h>
+#include "renderdev.h"
+#include "sipadmission.h"
+#include "sipaudiodevice.h"
+#include "sipbridgebypass.h"
+
+#define DEF_SIP_UDP_PORT              0
+#define DEF_SIP_TCP_PORT              0
+#define DEF_SIP_ICE_ENABLED           false
+#define DEF_SIP_STUN_HOST             ""
+#define DEF_SIP_DTMF_METHOD           "auto"
+#define DEF_SIP_MAX_CALLS             0
+#define DEF_SIP_ADMISSION_ENABLED     false
+#define DEF_SIP_ADMISSION_CPUBUDGET   80
+#define DEF_SIP_ADMISSION_BANDWIDTH   0
+#define DEF_SIP_ADMISSION_AUDIOCPU    2
+#define DEF_SIP_ADMISSION_VIDEOCPU    25
+#define DEF_SIP_ADMISSION_AUDIOKBPS   100
+#define DEF_SIP_ADMISSION_REJECTCODE  503
+#define DEF_SIP_ADMISSION_RETRYAFTER  30
+#define DEF_SIP_SIP_THREADS           -1
+#define DEF_SIP_MEDIA_THREADS         -1
+#define DEF_SIP_MEDIA_IOQUEUE         true
+#define DEF_SIP_MEDIA_CLOCKRATE       0
+#define DEF_SIP_AUDIO_DEVICEMODE      "sound"
+#define DEF_SIP_AUDIO_LATENCYPROFILE  "default"
+#define DEF_SIP_AUDIO_AUTOCLOSETIME   1
+#define DEF_SIP_AUDIO_BRIDGEBYPASS    false
+#define DEF_SIP_AUDIO_PLAYFILE        ""
+#define DEF_SIP_AUDIO_RECORDFILE      ""
+#define DEF_SIP_AUDIO_EC_ALGORITHM    "default"
+#define DEF_SIP_AUDIO_EC_TAILLENGTH   200
+#define DEF_SIP_AUDIO_EC_NS           false
+#define DEF_SIP_AUDIO_EC_AGC          false
+#define DEF_SIP_AUDIO_EC_AUTOFALLBACK true
+#define DEF_SIP_AUDIO_CODECPRIORITY   ""
+#define DEF_SIP_AUDIO_PTIME           0
+#define DEF_SIP_AUDIO_VADENABLED      true
+#define DEF_SIP_AUDIO_FECENABLED      -1
+#define DEF_SIP_AUDIO_OPUSCOMPLEXITY  -1
+#define DEF_SIP_AUDIO_OPUSBITRATE     0
+#define DEF_SIP_AUDIO_CODEC_PTIME     0
+#define DEF_SIP_AUDIO_CODEC_VAD       -1
+#define DEF_SIP_CONF_SILENCETHRESHOLD 0.02
+#define DEF_SIP_VIDEO_CODECPRIORITY   ""
+#define DEF_SIP_VIDEO_PROFILE         "auto"
+#define DEF_SIP_VIDEO_AUTOCALLS       1
+#define DEF_SIP_VIDEO_MAXWIDTH        0
+#define DEF_SIP_VIDEO_MAXHEIGHT       0
+#define DEF_SIP_VIDEO_MAXFPS          0
+#define DEF_SIP_VIDEO_MAXBITRATE      0
+#define DEF_SIP_EVENT_TRACE_FILE      ""
+#define DEF_SIP_LOADBENCHMARK_CALLS   0
+#define DEF_SIP_LOADBENCHMARK_STEP    10
+#define DEF_SIP_EVENT_REPLAY_FILE     ""
+#define DEF_SIP_EVENT_REPLAY_MAXSPEED false
+
+#define MAX_AUTO_MEDIA_THREADS        8
+#define BRIDGE_BYPASS_CHECK_INTERVAL  1000
+
+SipPhone *SipPhone::FInstance = NULL;
+
+SipPhone::SipPhone()
+{
+	FMaxCalls = 0;
+	FSipStackInited = false;
+	FBridgeBypass = false;
+	FEchoAlgorithm = SipTaskEchoBenchmark::EcDefault;
+	FEchoFrameCost = 0;
+	FInstance = this;
+
+	FBridgeBypassTimer.setInterval(BRIDGE_BYPASS_CHECK_INTERVAL);
+	connect(&FBridgeBypassTimer,SIGNAL(timeout()),SLOT(onBridgeBypassTimerTimeout()));
+
+	FSipWorker = new SipWorker(this);
+	connect(FSipWorker,SIGNAL(taskFinished(SipTask *)),SLOT(onSipWorkerTaskFinished(SipTask *)));
+	SipBridgeBypass::setWorker(FSipWorker);
+
+	FEventReplay = new SipEventReplay(this);
+	FLoadBenchmark = new SipLoadBenchmark(this,this);
+	FCallSnapshot = new SipCallSnapshot;
+
+	qRegisterMetaType<SipEvent *>("SipEvent *");
+}
+
+SipPhone::~SipPhone()
+{
+	stopEventTrace();
+	SipBridgeBypass::setWorker(NULL);
+	delete FSipWorker;
+	FInstance = NULL;
+
+	delete FCallSnapshot.fetchAndStoreOrdered(NULL);
+	qDeleteAll(FRetiredSnapshots);
+}
+
+void SipPhone::pluginInfo(IPluginInfo *APluginInfo)
+{
+	APluginInfo->name = tr("SIP Phone");
+	APluginInfo->description = tr("Allows to make voice and video calls over SIP protocol");
+	APluginInfo->version = "1.0";
+	APluginInfo->author = "Potapov S.A. aka Lion";
+	APluginInfo->homePage = "http://www.vacuum-im.org";
+}
+
+bool SipPhone::initConnections(IPluginManager *APluginManager, int &AInitOrder)
+{
+	Q_UNUSED(AInitOrder);
+	FPluginManager = APluginManager;
+
+	connect(Options::instance(),SIGNAL(optionsOpened()),SLOT(onOptionsOpened()));
+	connect(Options::instance(),SIGNAL(optionsClosed()),SLOT(onOptionsClosed()));
+
+	return true;
+}
+
+bool SipPhone::initObjects()
+{
+	return true;
+}
+
+bool SipPhone::initSettings()
+{
+	Options::setDefaultValue(OPV_SIPPHONE_UPDPORT,DEF_SIP_UDP_PORT);
+	Options::setDefaultValue(OPV_SIPPHONE_TCPPORT,DEF_SIP_TCP_PORT);
+	Options::setDefaultValue(OPV_SIPPHONE_ICEENABLED,DEF_SIP_ICE_ENABLED);
+	Options::setDefaultValue(OPV_SIPPHONE_STUNSERVER,QString(DEF_SIP_STUN_HOST));
+	Options::setDefaultValue(OPV_SIPPHONE_DTMFMETHOD,QString(DEF_SIP_DTMF_METHOD));
+	Options::setDefaultValue(OPV_SIPPHONE_MAXCALLS,DEF_SIP_MAX_CALLS);
+	Options::setDefaultValue(OPV_SIPPHONE_ADMISSION_ENABLED,DEF_SIP_ADMISSION_ENABLED);
+	Options::setDefaultValue(OPV_SIPPHONE_ADMISSION_CPUBUDGET,DEF_SIP_ADMISSION_CPUBUDGET);
+	Options::setDefaultValue(OPV_SIPPHONE_ADMISSION_BANDWIDTHBUDGET,DEF_SIP_ADMISSION_BANDWIDTH);
+	Options::setDefaultValue(OPV_SIPPHONE_ADMISSION_AUDIOCPUCOST,DEF_SIP_ADMISSION_AUDIOCPU);
+	Options::setDefaultValue(OPV_SIPPHONE_ADMISSION_VIDEOCPUCOST,DEF_SIP_ADMISSION_VIDEOCPU);
+	Options::setDefaultValue(OPV_SIPPHONE_ADMISSION_AUDIOBANDWIDTH,DEF_SIP_ADMISSION_AUDIOKBPS);
+	Options::setDefaultValue(OPV_SIPPHONE_ADMISSION_REJECTCODE,DEF_SIP_ADMISSION_REJECTCODE);
+	Options::setDefaultValue(OPV_SIPPHONE_ADMISSION_RETRYAFTER,DEF_SIP_ADMISSION_RETRYAFTER);
+	Options::setDefaultValue(OPV_SIPPHONE_SIPTHREADS,DEF_SIP_SIP_THREADS);
+	Options::setDefaultValue(OPV_SIPPHONE_MEDIA_THREADS,DEF_SIP_MEDIA_THREADS);
+	Options::setDefaultValue(OPV_SIPPHONE_MEDIA_IOQUEUE,DEF_SIP_MEDIA_IOQUEUE);
+	Options::setDefaultValue(OPV_SIPPHONE_MEDIA_CLOCKRATE,DEF_SIP_MEDIA_CLOCKRATE);
+	Options::setDefaultValue(OPV_SIPPHONE_AUDIO_DEVICEMODE,QString(DEF_SIP_AUDIO_DEVICEMODE));
+	Options::setDefaultValue(OPV_SIPPHONE_AUDIO_LATENCYPROFILE,QString(DEF_SIP_AUDIO_LATENCYPROFILE));
+	Options::setDefaultValue(OPV_SIPPHONE_AUDIO_AUTOCLOSETIME,DEF_SIP_AUDIO_AUTOCLOSETIME);
+	Options::setDefaultValue(OPV_SIPPHONE_AUDIO_BRIDGEBYPASS,DEF_SIP_AUDIO_BRIDGEBYPASS);
+	Options::setDefaultValue(OPV_SIPPHONE_AUDIO_PLAYFILE,QString(DEF_SIP_AUDIO_PLAYFILE));
+	Options::setDefaultValue(OPV_SIPPHONE_AUDIO_RECORDFILE,QString(DEF_SIP_AUDIO_RECORDFILE));
+	Options::setDefaultValue(OPV_SIPPHONE_AUDIO_EC_ALGORITHM,QString(DEF_SIP_AUDIO_EC_ALGORITHM));
+	Options::setDefaultValue(OPV_SIPPHONE_AUDIO_EC_TAILLENGTH,DEF_SIP_AUDIO_EC_TAILLENGTH);
+	Options::setDefaultValue(OPV_SIPPHONE_AUDIO_EC_NOISESUPPRESSION,DEF_SIP_AUDIO_EC_NS);
+	Options::setDefaultValue(OPV_SIPPHONE_AUDIO_EC_GAINCONTROL,DEF_SIP_AUDIO_EC_AGC);
+	Options::setDefaultValue(OPV_SIPPHONE_AUDIO_EC_AUTOFALLBACK,DEF_SIP_AUDIO_EC_AUTOFALLBACK);
+	Options::setDefaultValue(OPV_SIPPHONE_AUDIO_CODECPRIORITY,QString(DEF_SIP_AUDIO_CODECPRIORITY));
+	Options::setDefaultValue(OPV_SIPPHONE_AUDIO_PTIME,DEF_SIP_AUDIO_PTIME);
+	Options::setDefaultValue(OPV_SIPPHONE_AUDIO_VADENABLED,DEF_SIP_AUDIO_VADENABLED);
+	Options::setDefaultValue(OPV_SIPPHONE_AUDIO_FECENABLED,DEF_SIP_AUDIO_FECENABLED);
+	Options::setDefaultValue(OPV_SIPPHONE_AUDIO_OPUSCOMPLEXITY,DEF_SIP_AUDIO_OPUSCOMPLEXITY);
+	Options::setDefaultValue(OPV_SIPPHONE_AUDIO_OPUSBITRATE,DEF_SIP_AUDIO_OPUSBITRATE);
+	Options::setDefaultValue(OPV_SIPPHONE_AUDIO_CODEC_PTIME,DEF_SIP_AUDIO_CODEC_PTIME);
+	Options::setDefaultValue(OPV_SIPPHONE_AUDIO_CODEC_VAD,DEF_SIP_AUDIO_CODEC_VAD);
+	Options::setDefaultValue(OPV_SIPPHONE_CONFERENCE_SILENCETHRESHOLD,DEF_SIP_CONF_SILENCETHRESHOLD);
+	Options::setDefaultValue(OPV_SIPPHONE_VIDEO_CODECPRIORITY,QString(DEF_SIP_VIDEO_CODECPRIORITY));
+	Options::setDefaultValue(OPV_SIPPHONE_VIDEO_PROFILE,QString(DEF_SIP_VIDEO_PROFILE));
+	Options::setDefaultValue(OPV_SIPPHONE_VIDEO_AUTOCALLS,DEF_SIP_VIDEO_AUTOCALLS);
+	Options::setDefaultValue(OPV_SIPPHONE_VIDEO_MAXWIDTH,DEF_SIP_VIDEO_MAXWIDTH);
+	Options::setDefaultValue(OPV_SIPPHONE_VIDEO_MAXHEIGHT,DEF_SIP_VIDEO_MAXHEIGHT);
+	Options::setDefaultValue(OPV_SIPPHONE_VIDEO_MAXFPS,DEF_SIP_VIDEO_MAXFPS);
+	Options::setDefaultValue(OPV_SIPPHONE_VIDEO_MAXBITRATE,DEF_SIP_VIDEO_MAXBITRATE);
+	Options::setDefaultValue(OPV_SIPPHONE_EVENTTRACEFILE,QString(DEF_SIP_EVENT_TRACE_FILE));
+	Options::setDefaultValue(OPV_SIPPHONE_LOADBENCHMARK_CALLS,DEF_SIP_LOADBENCHMARK_CALLS);
+	Options::setDefaultValue(OPV_SIPPHONE_LOADBENCHMARK_STEPTIME,DEF_SIP_LOADBENCHMARK_STEP);
+	Options::setDefaultValue(OPV_SIPPHONE_EVENTREPLAYFILE,QString(DEF_SIP_EVENT_REPLAY_FILE));
+	Options::setDefaultValue(OPV_SIPPHONE_EVENTREPLAYMAXSPEED,DEF_SIP_EVENT_REPLAY_MAXSPEED);
+	return true;
+}
+
+bool SipPhone::isCallsAvailable() const
+{
+	return FSipStackInited;
+}
+
+bool SipPhone::isAudioCallsAvailable() const
+{
+	return isCallsAvailable() && (FAvailDevices.contains(ISipMedia::Audio) || SipAudioDevice::isHeadless());
+}
+
+bool SipPhone::isVideoCallsAvailable() const
+{
+	return isAudioCallsAvailable() && FAvailDevices.contains(ISipMedia::Video);
+}
+
+QList<ISipCall *> SipPhone::sipCalls(bool AActiveOnly) const
+{
+	FSnapshotReaders.ref();
+	const SipCallSnapshot *snapshot = FCallSnapshot;
+	QList<ISipCall *> calls = AActiveOnly ? snapshot->activeCalls : snapshot->allCalls;
+	if (!FSnapshotReaders.deref())
+		freeRetiredSnapshots();
+	return calls;
+}
+
+ISipCall *SipPhone::newCall(const QUuid &AAccountId, const QString &ARemoteUri)
+{
+	if (isCallsAvailable() && FAccounts.contains(AAccountId))
+	{
+		if (pjsua_verify_sip_url(ARemoteUri.toLocal8Bit().constData())==PJ_SUCCESS || pjsua_verify_url(ARemoteUri.toLocal8Bit().constData())==PJ_SUCCESS)
+		{
+			LOG_INFO(QString("SIP call created as caller, call=%1, accId=%2, uri=%3").arg(-1).arg(AAccountId.toString(),ARemoteUri));
+			SipCall *call = new SipCall(AAccountId,FAccounts.value(AAccountId).index,ARemoteUri,this);
+			appendCall(call);
+			return call;
+		}
+		else
+		{
+			LOG_ERROR(QString("Failed to create SIP call, accId=%1, uri=%2: Invalid SIP uri").arg(AAccountId.toString(),ARemoteUri));
+		}
+	}
+	else if (!FAccounts.contains(AAccountId))
+	{
+		REPORT_ERROR("Failed to create SIP call: Account not found");
+	}
+	else if (!isCallsAvailable())
+	{
+		REPORT_ERROR("Failed to create SIP call: Calls is not available");
+	}
+	return NULL;
+}
+
+QList<ISipConference *> SipPhone::sipConferences() const
+{
+	QList<ISipConference *> conferences;
+	foreach(SipConference *conference, FConferences)
+		conferences.append(conference);
+	return conferences;
+}
+
+QString SipPhone::echoCancellerAlgorithm() const
+{
+	return SipTaskEchoBenchmark::algorithmName(FEchoAlgorithm);
+}
+
+quint32 SipPhone::echoCancellerFrameCost() const
+{
+	return FEchoFrameCost;
+}
+
+ISipConference *SipPhone::newConference()
+{
+	if (isAudioCallsAvailable())
+	{
+		LOG_INFO("SIP conference created");
+		SipConference *conference = new SipConference(this);
+		connect(conference,SIGNAL(conferenceDestroyed()),SLOT(onSipConferenceDestroyed()));
+		FConferences.append(conference);
+		emit conferenceCreated(conference);
+		return conference;
+	}
+	else
+	{
+		REPORT_ERROR("Failed to create SIP conference: Audio calls is not available");
+	}
+	return NULL;
+}
+
+QList<QUuid> SipPhone::availAccounts() const
+{
+	return FAccounts.keys();
+}
+
+QString SipPhone::accountUri(const QUuid &AAccountId) const
+{
+	QMap<QUuid,SipAccount>::const_iterator it = FAccounts.constFind(AAccountId);
+	return it!=FAccounts.constEnd() ? it->uri : QString::null;
+}
+
+ISipAccountConfig SipPhone::accountConfig(const QUuid &AAccountId) const
+{
+	QMap<QUuid,SipAccount>::const_iterator it = FAccounts.constFind(AAccountId);
+	return it!=FAccounts.constEnd() ? it->config : ISipAccountConfig();
+}
+
+bool SipPhone::isAccountRegistered(const QUuid &AAccountId) const
+{
+	QMap<QUuid,SipAccount>::const_iterator it = FAccounts.constFind(AAccountId);
+	return it!=FAccounts.constEnd() ? it->registered : false;
+}
+
+bool SipPhone::setAccountRegistered(const QUuid &AAccountId, bool ARegistered)
+{
+	if (FAccounts.contains(AAccountId) && isAccountRegistered(AAccountId)!=ARegistered)
+	{
+		pj_status_t status = pjsua_acc_set_registration(FAccounts.value(AAccountId).index, ARegistered ? PJ_TRUE : PJ_FALSE);
+		if (status == PJ_SUCCESS)
+		{
+			LOG_INFO(QString("SIP account registration request sent, accId=%1, register=%2").arg(AAccountId.toString()).arg(ARegistered));
+			return true;
+		}
+		else
+		{
+			LOG_ERROR(QString("Failed to send SIP account registration request, accId=%1: %2").arg(AAccountId.toString()).arg(resolveSipError(status)));
+		}
+	}
+	return false;
+}
+
+bool SipPhone::insertAccount(const QUuid &AAccountId, const ISipAccountConfig &AConfig)
+{
+	if (FSipStackInited && !AAccountId.isNull() && !FAccounts.contains(AAccountId) && isValidConfig(AConfig))
+	{
+		pjsua_acc_config accCfg;
+		if (parseConfig(AConfig, accCfg))
+		{
+			pjsua_acc_id accIndex;
+			pj_status_t status = pjsua_acc_add(&accCfg, PJ_FALSE, &accIndex);
+			if (status == PJ_SUCCESS)
+			{
+				LOG_INFO(QString("SIP account inserted, accId=%1, accIdx=%2").arg(AAccountId.toString()).arg(accIndex));
+
+				SipAccount &account = FAccounts[AAccountId];
+				account.index = accIndex;
+				updateAccountInfo(account);
+				updateAccountConfig(account);
+				FAccountIndex.insert(accIndex,AAccountId);
+
+				emit accountInserted(AAccountId);
+				return true;
+			}
+			else
+			{
+				LOG_ERROR(QString("Failed to create SIP account, accId=%1: %2").arg(AAccountId.toString()).arg(resolveSipError(status)));
+			}
+		}
+		else
+		{
+			LOG_ERROR(QString("Failed to create SIP account, accId=%1: Config not parsed").arg(AAccountId.toString()));
+		}
+	}
+	else if (!FSipStackInited)
+	{
+		LOG_ERROR(QString("Failed to create SIP account, accId=%1: SIP stack not initialized").arg(AAccountId.toString()));
+	}
+	else if (AAccountId.isNull())
+	{
+		LOG_ERROR(QString("Failed to create SIP account, accId=%1: Account Id is null").arg(AAccountId.toString()));
+	}
+	else if (FAccounts.contains(AAccountId))
+	{
+		LOG_ERROR(QString("Failed to create SIP account, accId=%1: Account Id already exists").arg(AAccountId.toString()));
+	}
+	else if (!isValidConfig(AConfig))
+	{
+		LOG_ERROR(QString("Failed to create SIP account, accId=%1: Invalid config").arg(AAccountId.toString()));
+	}
+	return false;
+}
+
+bool SipPhone::updateAccount(const QUuid &AAccountId, const ISipAccountConfig &AConfig)
+{
+	if (FAccounts.contains(AAccountId) && isValidConfig(AConfig))
+	{
+		pjsua_acc_config accCfg;
+		if (parseConfig(AConfig, accCfg))
+		{
+			SipAccount &account = FAccounts[AAccountId];
+			pj_status_t status = pjsua_acc_modify(account.index, &accCfg);
+			if (status == PJ_SUCCESS)
+			{
+				LOG_INFO(QString("SIP account updated, accId=%1").arg(AAccountId.toString()));
+				updateAccountInfo(account);
+				updateAccountConfig(account);
+				emit accountChanged(AAccountId);
+				return true;
+			}
+			else
+			{
+				LOG_ERROR(QString("Failed to update SIP account, accId=%1: %2").arg(AAccountId.toString()).arg(resolveSipError(status)));
+			}
+		}
+		else
+		{
+			LOG_ERROR(QString("Failed to update SIP account, accId=%1: Config not parsed").arg(AAccountId.toString()));
+		}
+	}
+	else if (!FAccounts.contains(AAccountId))
+	{
+		LOG_ERROR(QString("Failed to update SIP account, accId=%1: Account not found").arg(AAccountId.toString()));
+	}
+	else if (!isValidConfig(AConfig))
+	{
+		LOG_ERROR(QString("Failed to update SIP account, accId=%1: Invalid config").arg(AAccountId.toString()));
+	}
+	return false;
+}
+
+void SipPhone::removeAccount(const QUuid &AAccountId)
+{
+	if (FAccounts.contains(AAccountId))
+	{
+		LOG_INFO(QString("Removing SIP account, accId=%1").arg(AAccountId.toString()));
+
+		qDeleteAll(findCallsByAccount(AAccountId));
+		setAccountRegistered(AAccountId,false);
+
+		pjsua_acc_id accIndex = FAccounts.take(AAccountId).index;
+		FAccountIndex.remove(accIndex);
+		pjsua_acc_del(accIndex);
+
+		emit accountRemoved(AAccountId);
+	}
+}
+
+bool SipPhone::updateAvailDevices()
+{
+	if (FSipStackInited && pjsua_call_get_count()==0 && FVideoPreviewWidgets.isEmpty())
+	{
+		QMultiMap<int,ISipDevice> devices;
+
+		unsigned numAudDevices = 64;
+		pjmedia_aud_dev_info audDevInfo[64];
+		if (pjmedia_aud_dev_refresh()==PJ_SUCCESS && pjsua_enum_aud_devs(audDevInfo, &numAudDevices)==PJ_SUCCESS)
+		{
+			LOG_DEBUG(QString("Found %1 SIP audio devices").arg(numAudDevices));
+			for (unsigned devIndex = 0; devIndex < numAudDevices; devIndex++)
+			{
+				ISipDevice device;
+				device.type = ISipMedia::Audio;
+				device.index = devIndex;
+				device.name = QString::fromLocal8Bit(audDevInfo[devIndex].name);
+				device.formats = parseMediaFormats(audDevInfo[devIndex].ext_fmt,audDevInfo[devIndex].ext_fmt_cnt,ISipMedia::Audio);
+				
+				if (audDevInfo[devIndex].input_count>0 && audDevInfo[devIndex].output_count>0)
+					device.dir = ISipMedia::CaptureAndPlayback;
+				else if (audDevInfo[devIndex].input_count > 0)
+					device.dir = ISipMedia::Capture;
+				else if (audDevInfo[devIndex].output_count > 0)
+					device.dir = ISipMedia::Playback;
+
+				devices.insertMulti(device.type,device);
+
+				QStringList formats;
+				for (int i=0; i<device.formats.count(); i++)
+				{
+					char fid_str[5] = {'L','1','6',' ','\0' };
+					const ISipMediaFormat &format = device.formats.at(i);
+					if (format.id > 0)
+						memcpy(fid_str,&format.id,4);
+					formats.append(fid_str);
+				}
+
+				LOG_DEBUG(QString("  dev_i %1: %2 (driver=%3, in=%4, out=%5, fmt=%6) %7").arg(devIndex).arg(QString::fromLocal8Bit(audDevInfo[devIndex].name),QString::fromLocal8Bit(audDevInfo[devIndex].driver)).arg(audDevInfo[devIndex].input_count).arg(audDevInfo[devIndex].output_count).arg(device.formats.count()).arg(formats.join(", ")));
+			}
+		}
+		else
+		{
+			LOG_ERROR("Failed to update SIP audio devices");
+		}
+
+		unsigned numVidDevices = 64;
+		pjmedia_vid_dev_info vidDevInfo[64];
+		if (pjmedia_vid_dev_refresh()==PJ_SUCCESS && pjsua_vid_enum_devs(vidDevInfo, &numVidDevices)==PJ_SUCCESS)
+		{
+			LOG_DEBUG(QString("Found %1 SIP video devices").arg(numVidDevices));
+			for (unsigned devIndex = 0; devIndex < numVidDevices; devIndex++)
+			{
+				ISipDevice device;
+				device.type = ISipMedia::Video;
+				device.index = devIndex;
+				device.name = QString::fromLocal8Bit(vidDevInfo[devIndex].name);
+				device.formats = parseMediaFormats(vidDevInfo[devIndex].fmt,vidDevInfo[devIndex].fmt_cnt,ISipMedia::Video);
+
+				if (vidDevInfo[devIndex].fmt_cnt > 0)
+				{
+					if (vidDevInfo[devIndex].dir == PJMEDIA_DIR_CAPTURE_PLAYBACK)
+						device.dir = ISipMedia::CaptureAndPlayback;
+					else if (vidDevInfo[devIndex].dir == PJMEDIA_DIR_CAPTURE)
+						device.dir = ISipMedia::Capture;
+					else if (vidDevInfo[devIndex].dir == PJMEDIA_DIR_PLAYBACK)
+						device.dir = ISipMedia::Playback;
+
+					devices.insertMulti(device.type,device);
+				}
+
+				QStringList formats;
+				for (int i=0; i<device.formats.count(); i++)
+				{
+					char fid_str[5] = {'L','1','6',' ','\0' };
+					const ISipMediaFormat &format = device.formats.at(i);
+					if (format.id > 0)
+						memcpy(fid_str,&format.id,4);
+					formats.append(fid_str);
+				}
+
+				LOG_DEBUG(QString("  .dev_i %1: %2 (driver=%3, dir=%4, fmt=%5) %6").arg(devIndex).arg(QString::fromLocal8Bit(vidDevInfo[devIndex].name),QString::fromLocal8Bit(vidDevInfo[devIndex].driver)).arg(vidDevInfo[devIndex].dir).arg(device.formats.count()).arg(formats.join(", ")));
+			}
+		}
+		else
+		{
+			LOG_ERROR("Failed to update SIP video devices");
+		}
+
+		if (FAvailDevices != devices)
+		{
+			FAvailDevices = devices;
+			emit availDevicesChanged();
+			return true;
+		}
+	}
+	else if (!FSipStackInited)
+	{
+		LOG_ERROR("Failed to update avail SIP devices: SIP stack not initialize");
+	}
+	else if (pjsua_call_get_count() > 0)
+	{
+		LOG_ERROR("Failed to update avail SIP devices: Active calls found");
+	}
+	else if (FVideoPreviewWidgets.isEmpty())
+	{
+		LOG_ERROR("Failed to update avail SIP devices: Active preview widgets found");
+	}
+	return false;
+}
+
+ISipDevice SipPhone::findDevice(ISipMedia::Type AType, int AIndex) const
+{
+	for (QMap<int,ISipDevice>::const_iterator it=FAvailDevices.constBegin(); it!=FAvailDevices.constEnd(); ++it)
+		if (it.key()==AType && it->index==AIndex)
+			return it.value();
+	return ISipDevice();
+}
+
+ISipDevice SipPhone::findDevice(ISipMedia::Type AType, const QString &AName) const
+{
+	for (QMap<int,ISipDevice>::const_iterator it=FAvailDevices.constBegin(); it!=FAvailDevices.constEnd(); ++it)
+		if (it.key()==AType && it->name==AName)
+			return it.value();
+	return ISipDevice();
+}
+
+ISipDevice SipPhone::defaultDevice(ISipMedia::Type AType, ISipMedia::Direction ADir) const
+{
+	if (AType==ISipMedia::Video && ADir==ISipMedia::Playback)
+		return findDevice(ISipMedia::Video,QT_RENDER_DEVICE_NAME);
+
+	QList<ISipDevice> devices = availDevices(AType,ADir);
+	qSort(devices.begin(),devices.end());
+
+	return devices.value(0);
+}
+
+QList<ISipDevice> SipPhone::availDevices(ISipMedia::Type AType, ISipMedia::Direction ADir) const
+{
+	QList<ISipDevice> devices = FAvailDevices.values(AType);
+	for (QList<ISipDevice>::iterator it=devices.begin(); it!=devices.constEnd(); )
+	{
+		if ((it->dir & ADir) != ADir)
+			it = devices.erase(it);
+		else
+			++it;
+	}
+	return devices;
+}
+
+QWidget *SipPhone::startVideoPreview(const ISipDevice &ADevice, QWidget *AParent)
+{
+	VideoWindow *widget = NULL;
+	if (ADevice.index>=0 && ADevice.type==ISipMedia::Video && (ADevice.dir & ISipMedia::Capture)>0 && FAvailDevices.values(ADevice.type).contains(ADevice))
+	{
+		LOG_DEBUG(QString("Starting SIP video preview, devIdx=%1, devName=%2").arg(ADevice.index).arg(ADevice.name));
+
+		VideoSurface *surface = NULL;
+		if (!FVideoPreviewWidgets.contains(ADevice.index))
+		{
+			SipTaskStartPreview *task = new SipTaskStartPreview(ADevice.index,defaultDevice(ISipMedia::Video,ISipMedia::Playback).index);
+			if (FSipWorker->startTask(task))
+				LOG_DEBUG(QString("SIP video preview start task started, devIdx=%1, devName=%2").arg(ADevice.index).arg(ADevice.name));
+			else
+				LOG_ERROR(QString("Failed to start SIP video preview start task, devIdx=%1, devName=%2").arg(ADevice.index).arg(ADevice.name));
+		}
+		else
+		{
+			surface = FVideoPreviewWidgets.value(ADevice.index)->surface();
+		}
+		
+		widget = new VideoWindow(AParent);
+		widget->setSurface(surface);
+		connect(widget,SIGNAL(windowDestroyed()),SLOT(onVideoPreviewWidgetDestroyed()));
+		FVideoPreviewWidgets.insertMulti(ADevice.index,widget);
+	}
+	else
+	{
+		LOG_ERROR(QString("Failed to start SIP video preview, devIdx=%1, devName=%2: Invalid device").arg(ADevice.index).arg(ADevice.name));
+	}
+	return widget;
+}
+
+void SipPhone::stopVideoPreview(QWidget *APreview)
+{
+	VideoWindow *widget = qobject_cast<VideoWindow *>(APreview);
+	int devIndex = FVideoPreviewWidgets.key(widget,PJSUA_INVALID_ID);
+	if (devIndex != PJSUA_INVALID_ID)
+	{
+		LOG_DEBUG(QString("Stopping SIP video preview, devIdx=%1").arg(devIndex));
+
+		FVideoPreviewWidgets.remove(devIndex,widget);
+		if (!FVideoPreviewWidgets.contains(devIndex))
+		{
+			SipTaskStopPreview *task = new SipTaskStopPreview(devIndex);
+			if (FSipWorker->startTask(task))
+				LOG_DEBUG(QString("SIP video preview stop task started, devIdx=%1").arg(devIndex));
+			else
+				LOG_ERROR(QString("Failed to start SIP video preview stop task, devIdx=%1").arg(devIndex));
+		}
+	}
+	else
+	{
+		LOG_WARNING("Failed to stop SIP video preview: Device not found");
+	}
+}
+
+QMultiMap<int,ISipCallHandler *> SipPhone::callHandlers() const
+{
+	return FCallHandlers;
+}
+
+void SipPhone::insertCallHandler(int AOrder, ISipCallHandler *AHandler)
+{
+	if (AHandler && !FCallHandlers.contains(AOrder,AHandler))
+	{
+		LOG_DEBUG(QString("SIP call handler inserted, order=%1, handler=%2").arg(AOrder).arg((quint64)AHandler));
+		FCallHandlers.insertMulti(AOrder,AHandler);
+	}
+}
+
+void SipPhone::removeCallHandler(int AOrder, ISipCallHandler *AHandler)
+{
+	if (FCallHandlers.contains(AOrder,AHandler))
+	{
+		LOG_DEBUG(QString("SIP call handler removed, order=%1, handler=%2").arg(AOrder).arg((quint64)AHandler));
+		FCallHandlers.remove(AOrder,AHandler);
+	}
+}
+
+void SipPhone::initSipStack()
+{
+	if (!FSipStackInited)
+	{
+		SipTaskCreateStack::Params params;
+		params.stun = Options::node(OPV_SIPPHONE_STUNSERVER).value().toString();
+		params.enableIce = Options::node(OPV_SIPPHONE_ICEENABLED).value().toBool();
+		params.udpPort = Options::node(OPV_SIPPHONE_UPDPORT).value().toUInt();
+		params.tcpPort = Options::node(OPV_SIPPHONE_TCPPORT).value().toUInt();
+		params.userAgent = QString(CLIENT_NAME) + "/" + FPluginManager->version();
+		params.audioPtime = Options::node(OPV_SIPPHONE_AUDIO_PTIME).value().toUInt();
+		params.sndAutoCloseTime = Options::node(OPV_SIPPHONE_AUDIO_AUTOCLOSETIME).value().toInt();
+		params.latencyProfile = Options::node(OPV_SIPPHONE_AUDIO_LATENCYPROFILE).value().toString();
+		params.audioVad = Options::node(OPV_SIPPHONE_AUDIO_VADENABLED).value().toBool();
+		params.clockRate = Options::node(OPV_SIPPHONE_MEDIA_CLOCKRATE).value().toUInt();
+		loadEchoParams(params.ecTailLen,params.ecOptions);
+
+		// Call slots are allocated by pjsua at compile time, so the ceiling cannot be raised above it
+		unsigned maxCalls = Options::node(OPV_SIPPHONE_MAXCALLS).value().toUInt();
+		params.maxCalls = maxCalls>0 ? qMin(maxCalls,(unsigned)PJSUA_MAX_CALLS) : 0;
+		if (maxCalls > params.maxCalls)
+			LOG_WARNING(QString("Max calls limited by PJSUA_MAX_CALLS, requested=%1, allowed=%2").arg(maxCalls).arg(params.maxCalls));
+		params.mediaIoqueue = Options::node(OPV_SIPPHONE_MEDIA_IOQUEUE).value().toBool();
+
+		// Stack is never polled by application, so zero and negative thread counts are resolved from the number of available cores
+		int cores = qMax(QThread::idealThreadCount(),1);
+		int sipThreads = Options::node(OPV_SIPPHONE_SIPTHREADS).value().toInt();
+		params.sipThreads = sipThreads>0 ? sipThreads : (cores>=4 ? 2 : 1);
+		int mediaThreads = Options::node(OPV_SIPPHONE_MEDIA_THREADS).value().toInt();
+		params.mediaThreads = mediaThreads>0 ? mediaThreads : qBound(1,cores-1,MAX_AUTO_MEDIA_THREADS);
+		if (sipThreads==0 || mediaThreads==0)
+			LOG_WARNING(QString("Zero SIP or media thread count is not supported, using sip-threads=%1, media-threads=%2").arg(params.sipThreads).arg(params.mediaThreads));
+		//params.logFileName = QString(FPluginManager->homePath()+"/logs/pjsip.log");
+
+		pj_bzero(&params.callBack, sizeof(params.callBack));
+		params.callBack.on_reg_state = &pjcbOnRegState;
+		params.callBack.on_nat_detect = &pjcbOnNatDetect;
+		params.callBack.on_incoming_call = &pjcbOnIncomingCall;
+		params.callBack.on_call_state = &pjcbOnCallState;
+		params.callBack.on_call_media_state = &pjcbOnCallMediaState;
+		params.callBack.on_call_media_event = &pjcbOnCallMediaEvent;
+		params.callBack.on_dtmf_digit = &pjcbOnDtmfDigit;
+		params.callBack.on_stream_created = &pjcbOnStreamCreated;
+		params.callBack.on_stream_destroyed = &pjcbOnStreamDestroyed;
+
+		params.vdf = &qwidget_factory_create;
+
+		SipTaskCreateStack *task = new SipTaskCreateStack(params);
+		if (FSipWorker->startTask(task))
+			LOG_INFO(QString("Create SIP stack task started, stun='%1', ice=%2, udp=%3, tcp=%4, ua='%5', max-calls=%6, sip-threads=%7, media-threads=%8, ioqueue=%9, clock-rate=%10, latency='%11'").arg(params.stun).arg(params.enableIce).arg(params.udpPort).arg(params.tcpPort).arg(params.userAgent).arg(params.maxCalls).arg(params.sipThreads).arg(params.mediaThreads).arg(params.mediaIoqueue).arg(params.clockRate).arg(params.latencyProfile));
+		else
+			LOG_ERROR("Failed to start create SIP stack task");
+	}
+}
+
+void SipPhone::loadSipParams()
+{
+	if (FSipStackInited)
+	{
+		loadAudioCodecParams();
+
+		QStringList codecs = Options::node(OPV_SIPPHONE_VIDEO_CODECPRIORITY).value().toString().split(",",QString::SkipEmptyParts);
+		for (int i=0; i<codecs.count(); i++)
+		{
+			QByteArray codecId = codecs.at(i).trimmed().toLatin1();
+			pj_str_t id = pj_str(codecId.data());
+			if (pjsua_vid_codec_set_priority(&id,(pj_uint8_t)qMax(PJMEDIA_CODEC_PRIO_HIGHEST-i,1)) != PJ_SUCCESS)
+				LOG_WARNING(QString("Failed to set video codec priority, codec=%1").arg(codecs.at(i)));
+		}
+
+		QString codecId;
+		SipVideoLevel caps = loadVideoCaps();
+		QString profile = Options::node(OPV_SIPPHONE_VIDEO_PROFILE).value().toString();
+		int level = SipVideoAdapter::levelByName(profile);
+		if (level < 0)
+		{
+			// Codec defaults of pjsua are kept until benchmark is finished
+			pjsua_codec_info codecInfo[32];
+			unsigned codecCount = PJ_ARRAY_SIZE(codecInfo);
+			pjsua_vid_enum_codecs(codecInfo,&codecCount);
+
+			for (unsigned i=0, prio=0; i<codecCount; i++)
+			{
+				if (codecInfo[i].priority > prio)
+				{
+					prio = codecInfo[i].priority;
+					codecId = QString::fromLatin1(codecInfo[i].codec_id.ptr,(int)codecInfo[i].codec_id.slen);
+				}
+			}
+
+			if (profile!="auto")
+				LOG_WARNING(QString("Unknown video profile '%1', using auto").arg(profile));
+		}
+
+		SipVideoAdapter::setProfile(level,caps);
+		if (level >= 0)
+			SipVideoAdapter::applyCodecParams(SipVideoAdapter::videoLevel(level));
+
+		// Benchmark gets its own copy of caps, profile is only changed in GUI thread
+		if (!codecId.isEmpty())
+		{
+			SipTaskVideoBenchmark *task = new SipTaskVideoBenchmark(codecId,Options::node(OPV_SIPPHONE_VIDEO_AUTOCALLS).value().toInt(),caps);
+			if (FSipWorker->startTask(task))
+				LOG_INFO(QString("Video benchmark task started, codec=%1, calls=%2").arg(codecId).arg(task->concurrentCalls()));
+			else
+				LOG_ERROR("Failed to start video benchmark task");
+		}
+
+		loadAdmissionBudget();
+
+		// Echo canceller runs inside sound device thread, so its cost is measured on a separate instance
+		if (Options::node(OPV_SIPPHONE_AUDIO_EC_AUTOFALLBACK).value().toBool() && FEchoAlgorithm!=SipTaskEchoBenchmark::EcNone)
+		{
+			pjsua_conf_port_info mpi;
+			if (pjsua_conf_get_port_info(0,&mpi)==PJ_SUCCESS && mpi.clock_rate>0 && mpi.channel_count>0)
+			{
+				unsigned ptime = mpi.samples_per_frame*1000/mpi.channel_count/mpi.clock_rate;
+				unsigned tailLen = Options::node(OPV_SIPPHONE_AUDIO_EC_TAILLENGTH).value().toUInt();
+				SipTaskEchoBenchmark *task = new SipTaskEchoBenchmark(FEchoAlgorithm,tailLen,loadEchoFlags(),mpi.clock_rate,ptime);
+				if (FSipWorker->startTask(task))
+					LOG_INFO(QString("Echo canceller benchmark task started, algorithm=%1, tail=%2, clock-rate=%3, ptime=%4").arg(echoCancellerAlgorithm()).arg(tailLen).arg(mpi.clock_rate).arg(ptime));
+				else
+					LOG_ERROR("Failed to start echo canceller benchmark task");
+			}
+		}
+
+		FBridgeBypass = Options::node(OPV_SIPPHONE_AUDIO_BRIDGEBYPASS).value().toBool();
+		updateBridgeBypass();
+	}
+}
+
+void SipPhone::loadAdmissionBudget()
+{
+	// CPU costs are expressed in percents of one core, budget in percents of all cores
+	SipAdmissionBudget budget;
+	budget.enabled = Options::node(OPV_SIPPHONE_ADMISSION_ENABLED).value().toBool();
+	budget.cpuBudget = Options::node(OPV_SIPPHONE_ADMISSION_CPUBUDGET).value().toUInt()*qMax(QThread::idealThreadCount(),1);
+	budget.bandwidthBudget = Options::node(OPV_SIPPHONE_ADMISSION_BANDWIDTHBUDGET).value().toUInt();
+	budget.audioCpuCost = Options::node(OPV_SIPPHONE_ADMISSION_AUDIOCPUCOST).value().toUInt();
+	budget.videoCpuCost = Options::node(OPV_SIPPHONE_ADMISSION_VIDEOCPUCOST).value().toUInt();
+	budget.audioBandwidth = Options::node(OPV_SIPPHONE_ADMISSION_AUDIOBANDWIDTH).value().toUInt();
+	// Calls with codec defaults are budgeted as medium level until benchmark is finished
+	int videoLevel = SipVideoAdapter::defaultLevel()>=0 ? SipVideoAdapter::defaultLevel() : SipVideoAdapter::levelByName("medium");
+	budget.videoBandwidth = SipVideoAdapter::videoLevel(videoLevel).bitrate/1000;
+	budget.rejectCode = Options::node(OPV_SIPPHONE_ADMISSION_REJECTCODE).value().toUInt()==PJSIP_SC_BUSY_HERE ? PJSIP_SC_BUSY_HERE : PJSIP_SC_SERVICE_UNAVAILABLE;
+	budget.retryAfter = Options::node(OPV_SIPPHONE_ADMISSION_RETRYAFTER).value().toUInt();
+	SipAdmission::setBudget(budget);
+}
+
+void SipPhone::loadAudioCodecParams()
+{
+	QStringList codecs = Options::node(OPV_SIPPHONE_AUDIO_CODECPRIORITY).value().toString().split(",",QString::SkipEmptyParts);
+	for (int i=0; i<codecs.count(); i++)
+	{
+		QByteArray codecId = codecs.at(i).trimmed().toLatin1();
+		pj_str_t id = pj_str(codecId.data());
+		if (pjsua_codec_set_priority(&id,(pj_uint8_t)qMax(PJMEDIA_CODEC_PRIO_HIGHEST-i,1)) != PJ_SUCCESS)
+			LOG_WARNING(QString("Failed to set audio codec priority, codec=%1").arg(codecs.at(i)));
+	}
+
+	// Global ptime and VAD are passed to pjsua media config, codec params are changed only when set for that codec
+	pjsua_codec_info codecInfo[64];
+	unsigned codecCount = PJ_ARRAY_SIZE(codecInfo);
+	if (pjsua_enum_codecs(codecInfo,&codecCount) == PJ_SUCCESS)
+	{
+		for (unsigned i=0; i<codecCount; i++)
+		{
+			// Codec is configured by its encoding name, as in priority list
+			QString codecId = QString::fromLatin1(codecInfo[i].codec_id.ptr,(int)codecInfo[i].codec_id.slen);
+			OptionsNode codecNode = Options::node(OPV_SIPPHONE_AUDIO_CODEC_ITEM,codecId.section('/',0,0).toLower());
+			unsigned ptime = codecNode.value("ptime").toUInt();
+			int vad = codecNode.value("vad").toInt();
+
+			pjmedia_codec_param param;
+			if ((ptime>0 || vad>=0) && pjsua_codec_get_param(&codecInfo[i].codec_id,&param)==PJ_SUCCESS)
+			{
+				if (ptime>0 && param.info.frm_ptime>0)
+					param.setting.frm_per_pkt = (pj_uint8_t)qMax(ptime/param.info.frm_ptime,1U);
+				if (vad >= 0)
+					param.setting.vad = vad>0 ? 1 : 0;
+
+				if (pjsua_codec_set_param(&codecInfo[i].codec_id,&param) == PJ_SUCCESS)
+					LOG_DEBUG(QString("Audio codec params, codec=%1, priority=%2, ptime=%3, vad=%4").arg(codecId).arg(codecInfo[i].priority).arg(param.info.frm_ptime*param.setting.frm_per_pkt).arg(param.setting.vad));
+				else
+					LOG_WARNING(QString("Failed to set audio codec params, codec=%1").arg(codecId));
+			}
+		}
+	}
+
+#if defined(PJMEDIA_HAS_OPUS_CODEC) && PJMEDIA_HAS_OPUS_CODEC!=0
+	pjmedia_codec_opus_config opus;
+	if (pjmedia_codec_opus_get_config(&opus) == PJ_SUCCESS)
+	{
+		int complexity = Options::node(OPV_SIPPHONE_AUDIO_OPUSCOMPLEXITY).value().toInt();
+		if (complexity >= 0)
+			opus.complexity = qMin(complexity,10);
+
+		unsigned bitrate = Options::node(OPV_SIPPHONE_AUDIO_OPUSBITRATE).value().toUInt();
+		if (bitrate > 0)
+			opus.bit_rate = bitrate;
+
+		// Opus in-band FEC is enabled by codec PLC setting and tuned by expected loss, both keep codec defaults unless set
+		int fec = Options::node(OPV_SIPPHONE_AUDIO_FECENABLED).value().toInt();
+		if (fec >= 0)
+			opus.packet_loss = fec>0 ? 10 : 0;
+
+		const pj_str_t opusId = pj_str((char *)"opus");
+		pjmedia_codec_param param;
+		if (pjsua_codec_get_param(&opusId,&param) == PJ_SUCCESS)
+		{
+			if (fec >= 0)
+				param.setting.plc = fec>0 ? 1 : 0;
+			if (pjmedia_codec_opus_set_default_param(&opus,&param) == PJ_SUCCESS)
+				LOG_DEBUG(QString("Opus codec params, complexity=%1, bitrate=%2, packet-loss=%3, fec=%4").arg(opus.complexity).arg(opus.bit_rate).arg(opus.packet_loss).arg(param.setting.plc));
+			else
+				LOG_WARNING("Failed to set Opus codec params");
+		}
+	}
+#endif
+}
+
+void SipPhone::loadEchoParams(unsigned &ATailLen, unsigned &AOptions)
+{
+	QString name = Options::node(OPV_SIPPHONE_AUDIO_EC_ALGORITHM).value().toString();
+	FEchoAlgorithm = SipTaskEchoBenchmark::algorithmByName(name);
+	if (SipTaskEchoBenchmark::algorithmName(FEchoAlgorithm) != name)
+		LOG_WARNING(QString("Unknown echo canceller algorithm '%1', using default").arg(name));
+
+	ATailLen = FEchoAlgorithm!=SipTaskEchoBenchmark::EcNone ? Options::node(OPV_SIPPHONE_AUDIO_EC_TAILLENGTH).value().toUInt() : 0;
+	AOptions = SipTaskEchoBenchmark::echoOptions(FEchoAlgorithm,loadEchoFlags());
+	FEchoFrameCost = 0;
+}
+
+unsigned SipPhone::loadEchoFlags() const
+{
+	// Noise suppression and gain control are provided by WebRTC echo canceller only
+	unsigned flags = 0;
+#if PJ_VERSION_NUM >= 0x02070000
+	if (Options::node(OPV_SIPPHONE_AUDIO_EC_NOISESUPPRESSION).value().toBool())
+		flags |= PJMEDIA_ECHO_USE_NOISE_SUPPRESSOR;
+#endif
+#if PJ_VERSION_NUM >= 0x020D0000
+	if (Options::node(OPV_SIPPHONE_AUDIO_EC_GAINCONTROL).value().toBool())
+		flags |= PJMEDIA_ECHO_USE_GAIN_CONTROLLER;
+#endif
+	return flags;
+}
+
+SipVideoLevel SipPhone::loadVideoCaps() const
+{
+	SipVideoLevel caps;
+	caps.width = Options::node(OPV_SIPPHONE_VIDEO_MAXWIDTH).value().toUInt();
+	caps.height = Options::node(OPV_SIPPHONE_VIDEO_MAXHEIGHT).value().toUInt();
+	caps.fps = Options::node(OPV_SIPPHONE_VIDEO_MAXFPS).value().toUInt();
+	caps.bitrate = Options::node(OPV_SIPPHONE_VIDEO_MAXBITRATE).value().toUInt();
+	return caps;
+}
+
+void SipPhone::destroySipStack()
+{
+	if (FSipStackInited)
+	{
+		LOG_INFO("Destroing SIP stack");
+
+		foreach(const QString &sipid, FAccounts.keys())
+			removeAccount(sipid);
+
+		foreach(VideoWindow *widget, FVideoPreviewWidgets.values())
+			delete widget;
+
+		foreach(SipConference *conference, FConferences)
+			conference->destroyConference();
+
+		FLoadBenchmark->stop();
+		FBridgeBypassTimer.stop();
+		SipBridgeBypass::leave();
+
+		SipTonegen::destroyPool();
+		SipAudioDevice::close();
+
+		SipTaskDestroyStack *task = new SipTaskDestroyStack;
+		if (FSipWorker->startTask(task))
+			LOG_DEBUG("Destroy SIP stack task started");
+		else
+			LOG_ERROR("Failed to start destroy SIP stack task");
+	}
+}
+
+void SipPhone::startEventTrace()
+{
+	QString traceFile = Options::node(OPV_SIPPHONE_EVENTTRACEFILE).value().toString();
+	if (!traceFile.isEmpty() && FEventTrace.open(traceFile,QIODevice::WriteOnly))
+	{
+		LOG_INFO(QString("SIP event trace recording started, file=%1").arg(traceFile));
+		SipEventTrace::setRecorder(&FEventTrace);
+	}
+
+	QString replayFile = Options::node(OPV_SIPPHONE_EVENTREPLAYFILE).value().toString();
+	if (!replayFile.isEmpty())
+		FEventReplay->start(replayFile,Options::node(OPV_SIPPHONE_EVENTREPLAYMAXSPEED).value().toBool());
+}
+
+void SipPhone::stopEventTrace()
+{
+	FEventReplay->stop();
+	if (FEventTrace.isOpen())
+	{
+		LOG_INFO(QString("SIP event trace recording stopped, file=%1").arg(FEventTrace.fileName()));
+		SipEventTrace::setRecorder(NULL);
+		FEventTrace.close();
+	}
+}
+
+QString SipPhone::resolveSipError(int ACode) const
+{
+	char errmsg[PJ_ERR_MSG_SIZE];
+	pj_strerror(ACode, errmsg, sizeof(errmsg));
+	return QString(errmsg);
+}
+
+bool SipPhone::isValidConfig(const ISipAccountConfig &AConfig) const
+{
+	char id_url[1030];
+	pj_ansi_snprintf(id_url,sizeof(id_url),"<sip:%s>",AConfig.userid.toLocal8Bit().constData());
+	return pjsua_verify_sip_url(id_url)==PJ_SUCCESS;
+}
+
+bool SipPhone::parseConfig(const ISipAccountConfig &ASrc, pjsua_acc_config &ADst) const
+{
+	pjsua_acc_config_default(&ADst);
+
+	ADst.register_on_acc_add = PJ_FALSE;
+	ADst.allow_via_rewrite = PJ_FALSE;
+	ADst.allow_contact_rewrite = PJ_FALSE;
+
+	Jid userId = ASrc.userid;
+	QString serverHost = ASrc.serverHost.isEmpty() ? userId.domain() : ASrc.serverHost;
+
+	static char id_url[1030];
+	pj_ansi_snprintf(id_url,sizeof(id_url),"<sip:%s>",ASrc.userid.toLocal8Bit().constData());
+
+	static char reguri[1030];
+	if (ASrc.serverPort > 0)
+		pj_ansi_snprintf(reguri,sizeof(reguri),"<sip:%s:%u>",serverHost.toLocal8Bit().constData(),ASrc.serverPort);
+	else
+		pj_ansi_snprintf(reguri,sizeof(reguri),"<sip:%s>",serverHost.toLocal8Bit().constData());
+
+	static char username[512];
+	pj_ansi_snprintf(username,sizeof(username),"%s",userId.node().toLocal8Bit().constData());
+
+	static char password[512];
+	pj_ansi_snprintf(password,sizeof(password),"%s",ASrc.password.toLocal8Bit().constData());
+
+	ADst.id = pj_str(id_url);
+	ADst.reg_uri = pj_str(reguri);
+
+	ADst.vid_in_auto_show = PJ_FALSE;
+	ADst.vid_out_auto_transmit = PJ_TRUE;
+	ADst.vid_cap_dev = defaultDevice(ISipMedia::Video,ISipMedia::Capture).index;
+	ADst.vid_rend_dev = defaultDevice(ISipMedia::Video,ISipMedia::Playback).index;
+
+	ADst.cred_count = 1;
+	ADst.cred_info[0].realm = pj_str((char *)"*");
+	ADst.cred_info[0].scheme = pj_str((char *)"digest");
+	ADst.cred_info[0].username = pj_str(username);
+	ADst.cred_info[0].data = pj_str(password);
+	ADst.cred_info[0].data_type = PJSIP_CRED_DATA_PLAIN_PASSWD;
+
+	if (!ASrc.proxyHost.isEmpty())
+	{
+		static char proxy[512];
+		if (ASrc.proxyPort > 0)
+			pj_ansi_snprintf(proxy,sizeof(proxy),"<sip:%s:%u>",ASrc.proxyHost.toLocal8Bit().constData(),ASrc.proxyPort);
+		else
+			pj_ansi_snprintf(proxy,sizeof(proxy),"<sip:%s>",ASrc.proxyHost.toLocal8Bit().constData());
+		ADst.proxy[ADst.proxy_cnt++] = pj_str(proxy);
+	}
+
+	return true;
+}
+
+bool SipPhone::parseSipUri(const QString &AUri, QString &AAddress, quint16 &APort) const
+{
+	if (!AUri.isEmpty())
+	{
+		QString uri = AUri;
+		if (uri.startsWith('<'))
+		{
+			uri.chop(1);
+			uri.remove(0,1);
+		}
+
+		if (uri.startsWith("sip:"))
+			uri.remove(0,4);
+
+		if (!uri.isEmpty())
+		{
+			QStringList parts = uri.split(':',QString::SkipEmptyParts);
+			AAddress = parts.value(0);
+			APort = parts.value(0).toUInt();
+			return true;
+		}
+	}
+	return false;
+}
+
+void SipPhone::updateAccountInfo(SipAccount &AAccount) const
+{
+	pjsua_acc_info accInfo;
+	if (pjsua_acc_get_info(AAccount.index,&accInfo) == PJ_SUCCESS)
+	{
+		AAccount.uri = QString::fromLocal8Bit(accInfo.acc_uri.ptr,accInfo.acc_uri.slen);
+		AAccount.registered = accInfo.expires>0;
+	}
+	else
+	{
+		AAccount.uri = QString::null;
+		AAccount.registered = false;
+	}
+}
+
+void SipPhone::updateAccountConfig(SipAccount &AAccount) const
+{
+	ISipAccountConfig config;
+
+	pjsua_acc_config accCfg;
+	pj_pool_t *tmp_pool = pjsua_pool_create("tmp-acc-pool", 1024, 1024);
+	if (pjsua_acc_get_config(AAccount.index,tmp_pool,&accCfg)==PJ_SUCCESS && accCfg.cred_count>0)
+	{
+		config.userid = QString::fromLocal8Bit(accCfg.id.ptr,accCfg.id.slen);
+		config.userid.chop(1);
+		config.userid.remove(0,5);
+
+		config.password = QString::fromLocal8Bit(accCfg.cred_info[0].data.ptr,accCfg.cred_info[0].data.slen);
+
+		if (accCfg.proxy_cnt > 0)
+			parseSipUri(QString::fromLocal8Bit(accCfg.proxy[0].ptr,accCfg.proxy[0].slen),config.proxyHost,config.proxyPort);
+		parseSipUri(QString::fromLocal8Bit(accCfg.reg_uri.ptr,accCfg.reg_uri.slen),config.serverHost,config.serverPort);
+	}
+	pj_pool_release(tmp_pool);
+
+	AAccount.config = config;
+}
+
+QUuid SipPhone::findAccountByIndex(pjsua_acc_id AAccIndex) const
+{
+	return FAccountIndex.value(AAccIndex);
+}
+
+QList<ISipMediaFormat> SipPhone::parseMediaFormats(pjmedia_format AFormats[], int ACount, int AType) const
+{
+	QList<ISipMediaFormat> formats;
+	for (int i=0; i<ACount; i++)
+	{
+		if (AType == ISipMedia::Audio)
+		{
+			ISipMediaFormat format;
+			format.type = ISipMedia::Audio;
+			format.id = AFormats[i].id;
+			format.details.aud.clockRate = AFormats[i].det.aud.clock_rate;
+			format.details.aud.channelCount = AFormats[i].det.aud.channel_count;
+			format.details.aud.frameTimeUsec = AFormats[i].det.aud.frame_time_usec;
+			format.details.aud.bitsPerSample = AFormats[i].det.aud.bits_per_sample;
+			format.details.aud.avgBitrate = AFormats[i].det.aud.avg_bps;
+			format.details.aud.maxBitrate = AFormats[i].det.aud.max_bps;
+			formats.append(format);
+		}
+		else if (AType == ISipMedia::Video)
+		{
+			ISipMediaFormat format;
+			format.type = ISipMedia::Video;
+			format.id = AFormats[i].id;
+			format.details.vid.fpsNum = AFormats[i].det.vid.fps.num;
+			format.details.vid.fpsDenum = AFormats[i].det.vid.fps.denum;
+			format.details.vid.width = AFormats[i].det.vid.size.w;
+			format.details.vid.height = AFormats[i].det.vid.size.h;
+			format.details.vid.avgBitrate = AFormats[i].det.vid.avg_bps;
+			format.details.vid.maxBitrate = AFormats[i].det.vid.max_bps;
+			formats.append(format);
+		}
+	}
+	return formats;
+}
+
+void SipPhone::appendCall(SipCall *ACall)
+{
+	if (ACall && !FCalls.contains(ACall))
+	{
+		connect(ACall,SIGNAL(stateChanged()),SLOT(onSipCallStateChanged()));
+		connect(ACall,SIGNAL(statusChanged()),SLOT(onSipCallStatusChanged()));
+		connect(ACall,SIGNAL(mediaChanged()),SLOT(onSipCallMediaChanged()));
+		connect(ACall,SIGNAL(callDestroyed()),SLOT(onSipCallDestroyed()));
+		FCalls.append(ACall);
+		publishCallSnapshot();
+		updateBridgeBypass();
+		wakeupSoundDevice(ACall);
+
+		if (!ACall->dialogId().isEmpty())
+			FCallDialogs.insert(ACall->dialogId());
+
+		QMap<QUuid,SipAccount>::iterator it = FAccounts.find(ACall->accountId());
+		if (it != FAccounts.end())
+			it->calls.insert(ACall);
+
+		emit callCreated(ACall);
+	}
+}
+
+void SipPhone::wakeupSoundDevice(SipCall *ACall)
+{
+	// Sound device closed by idle timer is reopened before media starts flowing
+	if (FSipStackInited && !SipAudioDevice::isHeadless() && ACall->callIndex()!=PJSUA_INVALID_ID)
+	{
+		if (ACall->state()==ISipCall::Calling || ACall->state()==ISipCall::Ringing)
+		{
+			SipTaskWakeupSound *task = new SipTaskWakeupSound;
+			if (!FSipWorker->startTask(task))
+				delete task;
+		}
+	}
+}
+
+void SipPhone::removeCall(SipCall *ACall)
+{
+	if (FCalls.contains(ACall))
+	{
+		FCalls.removeAll(ACall);
+		publishCallSnapshot();
+		updateBridgeBypass();
+
+		if (!ACall->dialogId().isEmpty())
+			FCallDialogs.remove(ACall->dialogId());
+
+		QMap<QUuid,SipAccount>::iterator it = FAccounts.find(ACall->accountId());
+		if (it != FAccounts.end())
+			it->calls.remove(ACall);
+
+		emit callDestroyed(ACall);
+	}
+}
+
+void SipPhone::updateBridgeBypass()
+{
+	if (FSipStackInited)
+	{
+		SipCall *single = NULL;
+		int activeCount = 0;
+		foreach(SipCall *call, FCalls)
+		{
+			if (call->isActive())
+			{
+				single = call;
+				activeCount++;
+			}
+		}
+
+		// Bypass is possible only when nothing else has to be mixed with single call audio
+		bool allowed = FBridgeBypass && activeCount==1 && single->isBridgeBypassAllowed();
+		allowed = allowed && !SipAudioDevice::isHeadless() && SipAudioDevice::captureSlot()==0 && SipAudioDevice::playbackSlot()==0;
+		for (int i=0; allowed && i<FConferences.count(); i++)
+			allowed = !FConferences.at(i)->participants().contains(single);
+
+		// Sound device is switched by SipWorker, so requests are only queued here
+		if (allowed && SipBridgeBypass::requestedCall()!=single->callIndex())
+			SipBridgeBypass::enter(single->callIndex(),SipTaskEchoBenchmark::echoOptions(FEchoAlgorithm,loadEchoFlags()));
+		else if (!allowed)
+			SipBridgeBypass::leave();
+
+		// Periodic check picks up conditions changed inside calls, such as finished tones
+		if (FBridgeBypass && activeCount==1)
+			FBridgeBypassTimer.start();
+		else
+			FBridgeBypassTimer.stop();
+	}
+}
+
+bool SipPhone::isDuplicateCall(const QString &ADialogId) const
+{
+	return !ADialogId.isEmpty() && FCallDialogs.contains(ADialogId);
+}
+
+SipCall *SipPhone::findCallByIndex(pjsua_call_id ACallIndex) const
+{
+	SipCall *call = NULL;
+
+	FSnapshotReaders.ref();
+	const SipCallSnapshot *snapshot = FCallSnapshot;
+	for (QList<SipCall *>::const_iterator it=snapshot->calls.constBegin(); call==NULL && it!=snapshot->calls.constEnd(); ++it)
+		if ((*it)->callIndex() == ACallIndex)
+			call = *it;
+	if (!FSnapshotReaders.deref())
+		freeRetiredSnapshots();
+
+	return call;
+}
+
+QList<SipCall *> SipPhone::findCallsByAccount(const QUuid &AAccountId) const
+{
+	QMap<QUuid,SipAccount>::const_iterator it = FAccounts.constFind(AAccountId);
+	return it!=FAccounts.constEnd() ? it->calls.toList() : QList<SipCall *>();
+}
+
+// Called only from GUI thread. Readers register in FSnapshotReaders before loading
+// the snapshot pointer, so replaced snapshots are freed once no reader is inside,
+// either here or by the last reader leaving.
+void SipPhone::publishCallSnapshot()
+{
+	SipCallSnapshot *snapshot = new SipCallSnapshot;
+	snapshot->calls = FCalls;
+	snapshot->allCalls.reserve(FCalls.count());
+	snapshot->activeCalls.reserve(FCalls.count());
+	foreach(SipCall *call, FCalls)
+	{
+		snapshot->allCalls.append(call);
+		if (call->isActive())
+			snapshot->activeCalls.append(call);
+	}
+
+	SipCallSnapshot *retired = FCallSnapshot.fetchAndStoreOrdered(snapshot);
+
+	FRetiredLock.lock();
+	FRetiredSnapshots.append(retired);
+	FRetiredLock.unlock();
+
+	freeRetiredSnapshots();
+}
+
+// Snapshots are retired only after they were replaced, so readers entering after
+// the check below load the current snapshot, which is never in the retired list.
+// Reader failing to get the lock leaves cleanup to its holder or to the next publish.
+void SipPhone::freeRetiredSnapshots() const
+{
+	if (FRetiredLock.tryLock())
+	{
+		if (!FRetiredSnapshots.isEmpty() && FSnapshotReaders.testAndSetOrdered(0,0))
+		{
+			qDeleteAll(FRetiredSnapshots);
+			FRetiredSnapshots.clear();
+		}
+		FRetiredLock.unlock();
+	}
+}
+
+void SipPhone::processSipEvent(SipEvent *AEvent)
+{
+	SipEventTrace::recordEvent(PJSUA_INVALID_ID,AEvent);
+
+	switch (AEvent->type)
+	{
+	case SipEvent::RegState:
+		{
+			SipEventRegState *se = static_cast<SipEventRegState *>(AEvent);
+
+			QUuid accId = findAccountByIndex(se->accIndex);
+			if (!accId.isNull())
+			{
+				bool registered = se->registered;
+				FAccounts[accId].registered = registered;
+				LOG_INFO(QString("SIP account registration changed, accId=%1, registered=%2, status=%3").arg(accId.toString()).arg(registered).arg(pjsip_get_status_text(se->status)->ptr));
+				emit accountRegistrationChanged(accId,registered);
+			}
+
+			delete se;
+		}
+		break;
+	case SipEvent::IncomingCall:
+		{
+			SipEventIncomingCall *se = static_cast<SipEventIncomingCall *>(AEvent);
+
+			QUuid accId = findAccountByIndex(se->accIndex);
+			if (!accId.isNull())
+			{
+				QString dialogId = QString("%1;tag=%2").arg(QString::fromLatin1(se->callId),QString::fromLatin1(se->fromTag));
+				if (!isDuplicateCall(dialogId))
+				{
+					LOG_INFO(QString("SIP call created as receiver, call=%1, accId=%2").arg(se->callIndex).arg(accId.toString()));
+					SipCall *call = new SipCall(accId,se->accIndex,se->callIndex,this);
+					call->setDialogId(dialogId);
+					call->setVideoAllowed(!se->audioOnly);
+					appendCall(call);
+
+					bool callReceived = false;
+					for (QMultiMap<int,ISipCallHandler *>::const_iterator it=FCallHandlers.constBegin(); !callReceived && it!=FCallHandlers.constEnd(); ++it)
+						callReceived = it.value()->sipCallReceive(it.key(),call);
+
+					if (!callReceived)
+					{
+						LOG_WARNING(QString("Incoming call not accepted, call=%1, accId=%2, uri=%3").arg(call->callIndex()).arg(call->accountId().toString()).arg(call->remoteUri()));
+						call->hangupCall(ISipCall::SC_NotAcceptableHere);
+						call->destroyCall(0);
+					}
+				}
+				else
+				{
+					LOG_DEBUG(QString("Rejecting duplicate incoming call: call=%1, accId=%2, dialog=%3").arg(se->callIndex).arg(accId.toString(),dialogId));
+					pjsua_call_hangup(se->callIndex,PJSIP_SC_LOOP_DETECTED,NULL,NULL);
+				}
+			}
+			else
+			{
+				LOG_WARNING(QString("Received call from unknown account, call=%1, accId=%2").arg(se->accIndex).arg(accId.toString()));
+				pjsua_call_hangup(se->callIndex,PJSIP_SC_NOT_ACCEPTABLE_HERE,NULL,NULL);
+			}
+
+			delete se;
+		}
+		break;
+	default:
+		REPORT_ERROR(QString("Received unexpected SIP event: type=%1").arg(AEvent->type));
+		delete AEvent;
+	}
+}
+
+void SipPhone::onOptionsOpened()
+{
+	startEventTrace();
+	initSipStack();
+}
+
+void SipPhone::onOptionsClosed()
+{
+	destroySipStack();
+	stopEventTrace();
+}
+
+void SipPhone::onSipCallDestroyed()
+{
+	SipCall *call = qobject_cast<SipCall *>(sender());
+	if (call)
+	{
+		LOG_INFO(QString("SIP call destroyed, call=%1, accId=%2, uri=%3").arg(call->callIndex()).arg(call->accountId().toString(),call->remoteUri()));
+		removeCall(call);
+
+		QMap<QUuid,SipAccount>::const_iterator it = FAccounts.constFind(call->accountId());
+		if (it!=FAccounts.constEnd() && it->calls.isEmpty())
+			setAccountRegistered(call->accountId(),false);
+	}
+}
+
+void SipPhone::onSipConferenceDestroyed()
+{
+	SipConference *conference = qobject_cast<SipConference *>(sender());
+	if (conference)
+	{
+		FConferences.removeAll(conference);
+		emit conferenceDestroyed(conference);
+		conference->deleteLater();
+	}
+}
+
+void SipPhone::onSipCallStateChanged()
+{
+	SipCall *call = qobject_cast<SipCall *>(sender());
+	if (call)
+	{
+		publishCallSnapshot();
+		updateBridgeBypass();
+		wakeupSoundDevice(call);
+		emit callStateChanged(call);
+	}
+}
+
+void SipPhone::onSipCallStatusChanged()
+{
+	SipCall *call = qobject_cast<SipCall *>(sender());
+	if (call)
+		emit callStatusChanged(call);
+}
+
+void SipPhone::onSipCallMediaChanged()
+{
+	SipCall *call = qobject_cast<SipCall *>(sender());
+	if (call)
+	{
+		updateBridgeBypass();
+		emit callMediaChanged(call);
+	}
+}
+
+void SipPhone::onBridgeBypassTimerTimeout()
+{
+	updateBridgeBypass();
+}
+
+void SipPhone::onVideoPreviewWidgetDestroyed()
+{
+	VideoWindow *widget = qobject_cast<VideoWindow *>(sender());
+	stopVideoPreview(widget);
+}
+
+void SipPhone::onSipWorkerTaskFinished(SipTask *ATask)
+{
+	switch (ATask->type())
+	{
+	case SipTask::CreateStack:
+		{
+			SipTaskCreateStack *task = static_cast<SipTaskCreateStack *>(ATask);
+			if (task->status() == PJ_SUCCESS)
+			{
+				LOG_INFO("SIP stack initialized");
+
+				pj_thread_register("Qt GUI Thread",FPjThreadDesc,&FPjThread);
+				FSipStackInited = true;
+
+				FMaxCalls = pjsua_call_get_max_count();
+				FCalls.reserve(FMaxCalls);
+				FCallDialogs.reserve(FMaxCalls);
+				FAccountIndex.reserve(PJSUA_MAX_ACC);
+
+				SipAudioDevice::Mode audioMode = SipAudioDevice::modeByName(Options::node(OPV_SIPPHONE_AUDIO_DEVICEMODE).value().toString());
+				QString playFile = Options::node(OPV_SIPPHONE_AUDIO_PLAYFILE).value().toString();
+				QString recordFile = Options::node(OPV_SIPPHONE_AUDIO_RECORDFILE).value().toString();
+				if (audioMode!=SipAudioDevice::Sound || !playFile.isEmpty() || !recordFile.isEmpty())
+					SipAudioDevice::open(audioMode,playFile,recordFile);
+
+				loadSipParams();
+				updateAvailDevices();
+
+				// Loopback calls are best measured with null or no sound device
+				int benchmarkCalls = Options::node(OPV_SIPPHONE_LOADBENCHMARK_CALLS).value().toInt();
+				if (benchmarkCalls > 0)
+				{
+					if (!SipAudioDevice::isHeadless())
+						LOG_WARNING("SIP load benchmark started with sound device, results include sound device cost");
+					FLoadBenchmark->start(benchmarkCalls,Options::node(OPV_SIPPHONE_LOADBENCHMARK_STEPTIME).value().toInt());
+				}
+
+				emit callsAvailChanged(true);
+			}
+			else
+			{
+				LOG_ERROR(QString("Failed to initialize SIP stack: %1").arg(resolveSipError(task->status())));
+			}
+		}
+		break;
+	case SipTask::DestroyStack:
+		{
+			SipTaskCreateStack *task = static_cast<SipTaskCreateStack *>(ATask);
+
+			FCalls.clear();
+			FCallDialogs.clear();
+			publishCallSnapshot();
+			SipAdmission::reset();
+			FAccounts.clear();
+			FAccountIndex.clear();
+			FAvailDevices.clear();
+			FSipStackInited = false;
+			FMaxCalls = 0;
+
+			if (task->status() == PJ_SUCCESS)
+				LOG_INFO("SIP stack destroyed");
+			else
+				LOG_ERROR(QString("Failed to destroy SIP stack: %1").arg(resolveSipError(task->status())));
+
+			emit callsAvailChanged(false);
+		}
+		break;
+	case SipTask::StartPreview:
+		{
+			SipTaskStartPreview *task = static_cast<SipTaskStartPreview *>(ATask);
+			if (task->status() == PJ_SUCCESS)
+			{
+				if (task->windowType() == QT_RENDER_VID_DEV_TYPE)
+				{
+					VideoSurface *surface = (VideoSurface *)task->window();
+					foreach(VideoWindow *widget, FVideoPreviewWidgets.values(task->captureDev()))
+						widget->setSurface(surface);
+					LOG_DEBUG(QString("SIP video preview started, capIdx=%1, renIdx=%2").arg(task->captureDev()).arg(task->renderDev()));
+				}
+				else
+				{
+					LOG_ERROR(QString("Failed to start SIP video preview, capIdx=%1, renIdx=%2, winType=%3: Incompatible render device type").arg(task->captureDev()).arg(task->renderDev()).arg(task->windowType()));
+				}
+			}
+			else
+			{
+				LOG_ERROR(QString("Failed to start SIP video preview, capIdx=%1, renIdx=%2: %3").arg(task->captureDev()).arg(task->renderDev()).arg(resolveSipError(task->status())));
+			}
+		}
+		break;
+	case SipTask::StopPreview:
+		{
+			SipTaskStopPreview *task = static_cast<SipTaskStopPreview *>(ATask);
+
+			foreach(VideoWindow *widget, FVideoPreviewWidgets.values(task->captureDev()))
+				widget->setSurface(NULL);
+
+			if (task->status() == PJ_SUCCESS)
+				LOG_DEBUG(QString("SIP video preview stopped, capIdx=%1").arg(task->captureDev()));
+			else
+				LOG_ERROR(QString("Failed to stop video preview, capIdx=%1: %2").arg(task->captureDev()).arg(resolveSipError(task->status())));
+		}
+		break;
+	case SipTask::VideoBenchmark:
+		{
+			SipTaskVideoBenchmark *task = static_cast<SipTaskVideoBenchmark *>(ATask);
+			if (task->status() == PJ_SUCCESS)
+			{
+				SipVideoAdapter::setProfile(task->level(),loadVideoCaps());
+
+				if (FSipStackInited)
+				{
+					SipVideoAdapter::applyCodecParams(SipVideoAdapter::videoLevel(SipVideoAdapter::defaultLevel()));
+					loadAdmissionBudget();
+				}
+
+				LOG_INFO(QString("Video benchmark finished, codec=%1, calls=%2, level=%3").arg(task->codecId()).arg(task->concurrentCalls()).arg(task->level()));
+			}
+			else
+			{
+				LOG_ERROR(QString("Failed to run video benchmark, codec=%1: %2").arg(task->codecId(),resolveSipError(task->status())));
+			}
+		}
+		break;
+	case SipTask::EchoBenchmark:
+		{
+			SipTaskEchoBenchmark *task = static_cast<SipTaskEchoBenchmark *>(ATask);
+			if (task->status() == PJ_SUCCESS)
+			{
+				pj_status_t status = PJ_SUCCESS;
+				if (FSipStackInited && task->algorithm()!=task->requestedAlgorithm())
+				{
+					unsigned tailLen = task->algorithm()!=SipTaskEchoBenchmark::EcNone ? Options::node(OPV_SIPPHONE_AUDIO_EC_TAILLENGTH).value().toUInt() : 0;
+					status = pjsua_set_ec(tailLen,SipTaskEchoBenchmark::echoOptions(task->algorithm(),loadEchoFlags()));
+					if (status == PJ_SUCCESS)
+						LOG_WARNING(QString("Echo canceller overruns frame budget, falling back from %1 to %2").arg(SipTaskEchoBenchmark::algorithmName(task->requestedAlgorithm()),SipTaskEchoBenchmark::algorithmName(task->algorithm())));
+					else
+						LOG_ERROR(QString("Failed to fall back echo canceller to %1: %2").arg(SipTaskEchoBenchmark::algorithmName(task->algorithm()),resolveSipError(status)));
+				}
+
+				if (status == PJ_SUCCESS)
+				{
+					FEchoAlgorithm = task->algorithm();
+					FEchoFrameCost = task->frameCost();
+				}
+				LOG_INFO(QString("Echo canceller benchmark finished, algorithm=%1, frame-cost=%2us, frame-time=%3us").arg(echoCancellerAlgorithm()).arg(FEchoFrameCost).arg(task->frameTime()));
+			}
+			else
+			{
+				LOG_ERROR(QString("Failed to run echo canceller benchmark: %1").arg(resolveSipError(task->status())));
+			}
+		}
+		break;
+	case SipTask::WakeupSound:
+		{
+			if (ATask->status() != PJ_SUCCESS)
+				LOG_WARNING(QString("Failed to reopen sound device: %1").arg(resolveSipError(ATask->status())));
+		}
+		break;
+	case SipTask::BridgeBypass:
+		// Bypass failures are logged by SipBridgeBypass itself
+		break;
+	default:
+		REPORT_ERROR(QString("Unexpected SIP task finished, type=%1").arg(ATask->type()));
+		break;
+	}
+	delete ATask;
+}
+
+void SipPhone::pjcbOnRegState(pjsua_acc_id AAccIndex)
+{
+	pjsua_acc_info ai;
+	pj_status_t status = pjsua_acc_get_info(AAccIndex,&ai);
+
+	SipEventRegState *se = new SipEventRegState;
+	se->type = SipEvent::RegState;
+	se->accIndex = AAccIndex;
+	se->registered = status==PJ_SUCCESS && ai.expires>0 ? PJ_TRUE : PJ_FALSE;
+	se->status = status==PJ_SUCCESS ? ai.status : PJSIP_SC_INTERNAL_SERVER_ERROR;
+	QMetaObject::invokeMethod(FInstance,"processSipEvent",Qt::QueuedConnection,Q_ARG(SipEvent *,se));
+}
+
+void SipPhone::pjcbOnNatDetect(const pj_stun_nat_detect_result *AResult)
+{
+	if (AResult->status == PJ_SUCCESS)
+		LOG_INFO(QString("SIP NAT detected as %1").arg(AResult->nat_type_name));
+	else
+		LOG_ERROR(QString("Failed to detect NAT type: %1").arg(AResult->status));
+}
+
+void SipPhone::pjcbOnIncomingCall(pjsua_acc_id AAccIndex, pjsua_call_id ACallIndex, pjsip_rx_data *AData)
+{
+	// Admission is decided before any SipCall or media resources are created for the call
+	pjsua_call_info ci;
+	bool withVideo = pjsua_call_get_info(ACallIndex,&ci)==PJ_SUCCESS && ci.rem_vid_cnt>0;
+	SipAdmission::Decision decision = SipAdmission::admitCall(ACallIndex,withVideo);
+	if (decision == SipAdmission::Reject)
+	{
+		LOG_WARNING(QString("Incoming call rejected by admission control, call=%1, cpu-load=%2, bandwidth-load=%3kbps").arg(ACallIndex).arg(SipAdmission::cpuLoad()).arg(SipAdmission::bandwidthLoad()));
+		SipAdmission::rejectCall(ACallIndex);
+		return;
+	}
+	else if (decision == SipAdmission::AudioOnly)
+	{
+		LOG_INFO(QString("Incoming call downgraded to audio only by admission control, call=%1").arg(ACallIndex));
+	}
+
+	SipEventIncomingCall *se = new SipEventIncomingCall;
+	se->type = SipEvent::IncomingCall;
+	se->accIndex = AAccIndex;
+	se->callIndex = ACallIndex;
+	se->audioOnly = decision==SipAdmission::AudioOnly ? PJ_TRUE : PJ_FALSE;
+
+	se->callId[0] = se->fromTag[0] = 0;
+	if (AData!=NULL && AData->msg_info.cid!=NULL)
+		pj_ansi_snprintf(se->callId,sizeof(se->callId),"%.*s",(int)AData->msg_info.cid->id.slen,AData->msg_info.cid->id.ptr);
+	if (AData!=NULL && AData->msg_info.from!=NULL)
+		pj_ansi_snprintf(se->fromTag,sizeof(se->fromTag),"%.*s",(int)AData->msg_info.from->tag.slen,AData->msg_info.from->tag.ptr);
+	QMetaObject::invokeMethod(FInstance,"processSipEvent",Qt::QueuedConnection,Q_ARG(SipEvent *,se));
+}
+
+void SipPhone::pjcbOnCallState(pjsua_call_id ACallIndex, pjsip_event *AEvent)
+{
+	Q_UNUSED(AEvent);
+	if (SipAdmission::isReserved(ACallIndex))
+	{
+		pjsua_call_info ci;
+		if (pjsua_call_get_info(ACallIndex,&ci)==PJ_SUCCESS && ci.state==PJSIP_INV_STATE_DISCONNECTED)
+			SipAdmission::releaseCall(ACallIndex);
+	}
+
+	SipCall *call = FInstance->findCallByIndex(ACallIndex);
+	if (call)
+		call->pjcbOnCallState();
+}
+
+void SipPhone::pjcbOnCallMediaState(pjsua_call_id ACallIndex)
+{
+	SipCall *call = FInstance->findCallByIndex(ACallIndex);
+	if (call)
+		call->pjcbOnCallMediaState();
+}
+
+void SipPhone::pjcbOnCallMediaEvent(pjsua_call_id ACallIndex, unsigned AMediaIndex, pjmedia_event *AEvent)
+{
+	SipCall *call = FInstance->findCallByIndex(ACallIndex);
+	if (call)
+		call->pjcbOnCallMediaEvent(AMediaIndex,AEvent);
+}
+
+void SipPhone::pjcbOnStreamCreated(pjsua_call_id ACallIndex, pjmedia_stream *AStream, unsigned AStreamIndex, pjmedia_port **APort)
+{
+	Q_UNUSED(AStream);
+	SipBridgeBypass::streamCreated(ACallIndex,AStreamIndex,*APort);
+}
+
+void SipPhone::pjcbOnStreamDestroyed(pjsua_call_id ACallIndex, pjmedia_stream *AStream, unsigned AStreamIndex)
+{
+	Q_UNUSED(AStream);
+	// Sound port must be detached before stream port is destroyed by pjsua
+	SipBridgeBypass::streamDestroyed(ACallIndex,AStreamIndex);
+}
+
+void SipPhone::pjcbOnDtmfDigit(pjsua_call_id ACallIndex, int ADigit)
+{
+	SipCall *call = FInstance->findCallByIndex(ACallIndex);
+	if (call)
+		call->pjcbOnDtmfDigit(ADigit);
+}
+
+Q_EXPORT_PLUGIN2(plg_sipphone, SipPhone)
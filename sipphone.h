@@ -1,47 +1,76 @@
-#ifndef SIPPHONE_H
-#define SIPPHONE_H
-
-#include <QSet>
-#include <QReadWriteLock>
-#include <interfaces/ipluginmanager.h>
-#include <interfaces/isipphone.h>
-#include "sipcall.h"
-#include "sipworker.h"
-
-class SipPhone : 
-	public QObject,
-	public IPlugin,
-	public ISipPhone
-{
-	Q_OBJECT;
-	Q_INTERFACES(IPlugin ISipPhone);
-public:
-	SipPhone();
-	~SipPhone();
-	//IPlugin
-	virtual QObject *instance() { return this; }
-	virtual QUuid pluginUuid() const { return SIPPHONE_UUID; }
-	virtual void pluginInfo(IPluginInfo *APluginInfo);
-	virtual bool initConnections(IPluginManager *APluginManager, int &AInitOrder);
-	virtual bool initObjects();
-	virtual bool initSettings();
-	virtual bool startPlugin() { return true; }
-	//ISipPhone
-	virtual bool isCallsAvailable() const;
-	virtual bool isAudioCallsAvailable() const;
-	virtual bool isVideoCallsAvailable() const;
-	virtual QList<ISipCall *> sipCalls(bool AActiveOnly=false) const;
-	virtual ISipCall *newCall(const QUuid &AAccountId, const QString &ARemoteUri);
-	// Accounts
-	virtual QList<QUuid> availAccounts() const;
-	virtual QString accountUri(const QUuid &AAccountId) const;
-	virtual ISipAccountConfig accountConfig(const QUuid &AAccountId) const;
-	virtual bool isAccountRegistered(const QUuid &AAccountId) const;
-	virtual bool setAccountRegistered(const QUuid &AAccountId, bool ARegistered);
-	virtual bool insertAccount(const QUuid &AAccountId, const ISipAccountConfig &AConfig);
-	virtual bool updateAccount(const QUuid &AAccountId, const ISipAccountConfig &AConfig);
-	virtual void removeAccount(const QUuid &AAccountId);
-	// Devices
+#ifndef SIPPHONE_H
+#define SIPPHONE_H
+
+#include <QSet>
+#include <QTimer>
+#include <QHash>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <interfaces/ipluginmanager.h>
+#include <interfaces/isipphone.h>
+#include "sipcall.h"
+#include "sipconference.h"
+#include "sipworker.h"
+#include "sipeventtrace.h"
+#include "siploadbenchmark.h"
+
+struct SipAccount
+{
+	pjsua_acc_id index;
+	bool registered;
+	QString uri;
+	ISipAccountConfig config;
+	QSet<SipCall *> calls;
+};
+
+struct SipCallSnapshot
+{
+	QList<SipCall *> calls;
+	QList<ISipCall *> allCalls;
+	QList<ISipCall *> activeCalls;
+};
+
+class SipPhone : 
+	public QObject,
+	public IPlugin,
+	public ISipPhone
+{
+	Q_OBJECT;
+	Q_INTERFACES(IPlugin ISipPhone);
+public:
+	SipPhone();
+	~SipPhone();
+	//IPlugin
+	virtual QObject *instance() { return this; }
+	virtual QUuid pluginUuid() const { return SIPPHONE_UUID; }
+	virtual void pluginInfo(IPluginInfo *APluginInfo);
+	virtual bool initConnections(IPluginManager *APluginManager, int &AInitOrder);
+	virtual bool initObjects();
+	virtual bool initSettings();
+	virtual bool startPlugin() { return true; }
+	//ISipPhone
+	virtual bool isCallsAvailable() const;
+	virtual bool isAudioCallsAvailable() const;
+	virtual bool isVideoCallsAvailable() const;
+	virtual QList<ISipCall *> sipCalls(bool AActiveOnly=false) const;
+	virtual ISipCall *newCall(const QUuid &AAccountId, const QString &ARemoteUri);
+	// Conferences
+	virtual QList<ISipConference *> sipConferences() const;
+	virtual ISipConference *newConference();
+	// Audio processing
+	virtual QString echoCancellerAlgorithm() const;
+	virtual quint32 echoCancellerFrameCost() const;
+	// Accounts
+	virtual QList<QUuid> availAccounts() const;
+	virtual QString accountUri(const QUuid &AAccountId) const;
+	virtual ISipAccountConfig accountConfig(const QUuid &AAccountId) const;
+	virtual bool isAccountRegistered(const QUuid &AAccountId) const;
+	virtual bool setAccountRegistered(const QUuid &AAccountId, bool ARegistered);
+	virtual bool insertAccount(const QUuid &AAccountId, const ISipAccountConfig &AConfig);
+	virtual bool updateAccount(const QUuid &AAccountId, const ISipAccountConfig &AConfig);
+	virtual void removeAccount(const QUuid &AAccountId);
+	// Devices
 	virtual bool updateAvailDevices();
 	virtual ISipDevice findDevice(ISipMedia::Type AType, int AIndex) const;
 	virtual ISipDevice findDevice(ISipMedia::Type AType, const QString &AName) const;
@@ -49,37 +78,53 @@ public:
 	virtual QList<ISipDevice> availDevices(ISipMedia::Type AType, ISipMedia::Direction ADir=ISipMedia::None) const;
 	virtual QWidget *startVideoPreview(const ISipDevice &ADevice, QWidget *AParent);
 	virtual void stopVideoPreview(QWidget *APreview);
-	// Call Handlers
-	virtual QMultiMap<int,ISipCallHandler *> callHandlers() const;
-	virtual void insertCallHandler(int AOrder, ISipCallHandler *AHandler);
-	virtual void removeCallHandler(int AOrder, ISipCallHandler *AHandler);
-signals:
-	void callsAvailChanged(bool AAvail);
+	// Call Handlers
+	virtual QMultiMap<int,ISipCallHandler *> callHandlers() const;
+	virtual void insertCallHandler(int AOrder, ISipCallHandler *AHandler);
+	virtual void removeCallHandler(int AOrder, ISipCallHandler *AHandler);
+signals:
+	void callsAvailChanged(bool AAvail);
 	void availDevicesChanged();
-	void callCreated(ISipCall *ACall);
-	void callDestroyed(ISipCall *ACall);
-	void callStateChanged(ISipCall *ACall);
-	void callStatusChanged(ISipCall *ACall);
-	void callMediaChanged(ISipCall *ACall);
-	void accountInserted(const QUuid &AAccountId);
-	void accountChanged(const QUuid &AAccountId);
-	void accountRemoved(const QUuid &AAccountId);
+	void callCreated(ISipCall *ACall);
+	void callDestroyed(ISipCall *ACall);
+	void callStateChanged(ISipCall *ACall);
+	void callStatusChanged(ISipCall *ACall);
+	void callMediaChanged(ISipCall *ACall);
+	void conferenceCreated(ISipConference *AConference);
+	void conferenceDestroyed(ISipConference *AConference);
+	void accountInserted(const QUuid &AAccountId);
+	void accountChanged(const QUuid &AAccountId);
+	void accountRemoved(const QUuid &AAccountId);
 	void accountRegistrationChanged(const QUuid &AAccountId, bool ARegistered);
-protected:
-	void initSipStack();
-	void loadSipParams();
-	void destroySipStack();
+protected:
+	void initSipStack();
+	void loadSipParams();
+	void loadAudioCodecParams();
+	void loadAdmissionBudget();
+	void loadEchoParams(unsigned &ATailLen, unsigned &AOptions);
+	unsigned loadEchoFlags() const;
+	SipVideoLevel loadVideoCaps() const;
+	void destroySipStack();
+	void startEventTrace();
+	void stopEventTrace();
 	QString resolveSipError(int ACode) const;
 	bool isValidConfig(const ISipAccountConfig &AConfig) const;
 	bool parseConfig(const ISipAccountConfig &ASrc, pjsua_acc_config &ADst) const;
 	bool parseSipUri(const QString &AUri, QString &AAddress, quint16 &APort) const;
+	void updateAccountInfo(SipAccount &AAccount) const;
+	void updateAccountConfig(SipAccount &AAccount) const;
+	QUuid findAccountByIndex(pjsua_acc_id AAccIndex) const;
 	QList<ISipMediaFormat> parseMediaFormats(pjmedia_format AFormats[], int ACount, int AType) const;
 protected:
 	void appendCall(SipCall *ACall);
+	void wakeupSoundDevice(SipCall *ACall);
 	void removeCall(SipCall *ACall);
-	bool isDuplicateCall(pjsua_call_id ACallIndex) const;
+	bool isDuplicateCall(const QString &ADialogId) const;
 	SipCall *findCallByIndex(pjsua_call_id ACallIndex) const;
 	QList<SipCall *> findCallsByAccount(const QUuid &AAccountId) const;
+	void publishCallSnapshot();
+	void freeRetiredSnapshots() const;
+	void updateBridgeBypass();
 protected slots:
 	void processSipEvent(SipEvent *AEvent);
 protected slots:
@@ -89,6 +134,8 @@ protected slots:
 	void onSipCallStateChanged();
 	void onSipCallStatusChanged();
 	void onSipCallMediaChanged();
+	void onSipConferenceDestroyed();
+	void onBridgeBypassTimerTimeout();
 	void onVideoPreviewWidgetDestroyed();
 	void onSipWorkerTaskFinished(SipTask *ATask);
 protected:
@@ -99,21 +146,39 @@ protected:
 	static void pjcbOnCallState(pjsua_call_id ACallIndex, pjsip_event *AEvent);
 	static void pjcbOnCallMediaState(pjsua_call_id ACallIndex);
 	static void pjcbOnCallMediaEvent(pjsua_call_id ACallIndex, unsigned AMediaIndex, pjmedia_event *AEvent);
+	static void pjcbOnDtmfDigit(pjsua_call_id ACallIndex, int ADigit);
+	static void pjcbOnStreamCreated(pjsua_call_id ACallIndex, pjmedia_stream *AStream, unsigned AStreamIndex, pjmedia_port **APort);
+	static void pjcbOnStreamDestroyed(pjsua_call_id ACallIndex, pjmedia_stream *AStream, unsigned AStreamIndex);
 private:
 	IPluginManager *FPluginManager;
 private:
-	SipWorker *FSipWorker;
-	pj_thread_t *FPjThread;
-	pj_thread_desc FPjThreadDesc;
+	SipWorker *FSipWorker;
+	pj_thread_t *FPjThread;
+	pj_thread_desc FPjThreadDesc;
+private:
+	SipEventTrace FEventTrace;
+	SipEventReplay *FEventReplay;
+	SipLoadBenchmark *FLoadBenchmark;
 private:
 	QList<SipCall *> FCalls;
-	mutable QReadWriteLock FLock;
-private:
-	bool FSipStackInited;
-	QMap<QUuid, pjsua_acc_id> FAccounts;
+	QSet<QString> FCallDialogs;
+	mutable QAtomicInt FSnapshotReaders;
+	QAtomicPointer<SipCallSnapshot> FCallSnapshot;
+	mutable QMutex FRetiredLock;
+	mutable QList<SipCallSnapshot *> FRetiredSnapshots;
+	QList<SipConference *> FConferences;
+	bool FBridgeBypass;
+	QTimer FBridgeBypassTimer;
+	int FEchoAlgorithm;
+	quint32 FEchoFrameCost;
+private:
+	bool FSipStackInited;
+	unsigned FMaxCalls;
+	QMap<QUuid, SipAccount> FAccounts;
+	QHash<pjsua_acc_id, QUuid> FAccountIndex;
 	QMultiMap<int, ISipDevice> FAvailDevices;
 	QMultiMap<int, ISipCallHandler *> FCallHandlers;
 	QMultiMap<int, VideoWindow *> FVideoPreviewWidgets;
-};
-
-#endif // SIPPHONE_H
+};
+
+#endif // SIPPHONE_H
@@ -0,0 +1,99 @@
+#include "siptonegen.h"
+
+#include <utils/logger.h>
+
+#define TONEGEN_POOL_SIZE        4
+#define TONEGEN_CLOCK_RATE       8000
+#define TONEGEN_SAMPLES          160
+
+QList<SipTonegen *> SipTonegen::FFreeTonegens;
+
+SipTonegen::SipTonegen()
+{
+	FPool = NULL;
+	FPort = NULL;
+	FSlot = PJSUA_INVALID_ID;
+}
+
+SipTonegen::~SipTonegen()
+{
+	if (FSlot != PJSUA_INVALID_ID)
+		pjsua_conf_remove_port(FSlot);
+	if (FPort != NULL)
+		pjmedia_port_destroy(FPort);
+	if (FPool != NULL)
+		pj_pool_release(FPool);
+}
+
+bool SipTonegen::isBusy() const
+{
+	return FPort!=NULL && pjmedia_tonegen_is_busy(FPort);
+}
+
+pjsua_conf_port_id SipTonegen::confSlot() const
+{
+	return FSlot;
+}
+
+bool SipTonegen::playDigits(const pjmedia_tone_digit *ADigits, unsigned ACount, pj_status_t *AStatus)
+{
+	pj_status_t status = pjmedia_tonegen_play_digits(FPort,ACount,ADigits,0);
+	if (AStatus)
+		*AStatus = status;
+	return status == PJ_SUCCESS;
+}
+
+bool SipTonegen::create()
+{
+	FPool = pjsua_pool_create("tonegen-pool",512,512);
+	pj_status_t status = FPool!=NULL ? pjmedia_tonegen_create(FPool,TONEGEN_CLOCK_RATE,1,TONEGEN_SAMPLES,16,0,&FPort) : PJ_ENOMEM;
+	if (status == PJ_SUCCESS)
+		status = pjsua_conf_add_port(FPool,FPort,&FSlot);
+	if (status != PJ_SUCCESS)
+		LOG_ERROR(QString("Failed to create tone generator: status=%1").arg(status));
+	return status == PJ_SUCCESS;
+}
+
+SipTonegen *SipTonegen::acquire()
+{
+	if (!FFreeTonegens.isEmpty())
+		return FFreeTonegens.takeLast();
+
+	if (pjsua_get_state() == PJSUA_STATE_RUNNING)
+	{
+		SipTonegen *tonegen = new SipTonegen;
+		if (tonegen->create())
+		{
+			LOG_DEBUG(QString("Tone generator created, slot=%1").arg(tonegen->FSlot));
+			return tonegen;
+		}
+		delete tonegen;
+	}
+	return NULL;
+}
+
+void SipTonegen::release(SipTonegen *ATonegen)
+{
+	if (ATonegen)
+	{
+		// Free generator must not be mixed by conference bridge
+		pjsua_conf_port_info pi;
+		if (pjsua_conf_get_port_info(ATonegen->FSlot,&pi) == PJ_SUCCESS)
+		{
+			for (unsigned i=0; i<pi.listener_cnt; i++)
+				pjsua_conf_disconnect(ATonegen->FSlot,pi.listeners[i]);
+		}
+		pjmedia_tonegen_stop(ATonegen->FPort);
+
+		if (FFreeTonegens.count() < TONEGEN_POOL_SIZE)
+			FFreeTonegens.append(ATonegen);
+		else
+			delete ATonegen;
+	}
+}
+
+void SipTonegen::destroyPool()
+{
+	qDeleteAll(FFreeTonegens);
+	FFreeTonegens.clear();
+}
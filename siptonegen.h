@@ -0,0 +1,29 @@
+#ifndef SIPTONEGEN_H
+#define SIPTONEGEN_H
+
+#include <QList>
+#include <pjsua.h>
+
+class SipTonegen
+{
+public:
+	~SipTonegen();
+	bool isBusy() const;
+	pjsua_conf_port_id confSlot() const;
+	bool playDigits(const pjmedia_tone_digit *ADigits, unsigned ACount, pj_status_t *AStatus = NULL);
+public:
+	static SipTonegen *acquire();
+	static void release(SipTonegen *ATonegen);
+	static void destroyPool();
+protected:
+	SipTonegen();
+	bool create();
+private:
+	pj_pool_t *FPool;
+	pjmedia_port *FPort;
+	pjsua_conf_port_id FSlot;
+private:
+	static QList<SipTonegen *> FFreeTonegens;
+};
+
+#endif // SIPTONEGEN_H
@@ -0,0 +1,214 @@
+#include "sipvideoadapter.h"
+
+#include <pjsua-lib/pjsua_internal.h>
+#include <utils/logger.h>
+
+#define LOSS_DECREASE_PERCENT     10.0
+#define LOSS_INCREASE_PERCENT     2.0
+#define RTT_DECREASE_USEC         400000
+#define RTT_INCREASE_USEC         200000
+#define BAD_SAMPLES_TO_DECREASE   2
+#define GOOD_SAMPLES_TO_INCREASE  10
+#define MIN_CHANGE_INTERVAL       10000
+
+static const SipVideoLevel VideoLevels[] = {
+	{ 320,  240,  15, 128000  },
+	{ 352,  288,  20, 256000  },
+	{ 640,  480,  25, 512000  },
+	{ 1280, 720,  30, 1536000 }
+};
+
+static const char *VideoLevelNames[] = {
+	"low", "medium", "high", "hd"
+};
+
+int SipVideoAdapter::FProfileLevel = -1;
+SipVideoLevel SipVideoAdapter::FProfileCaps = { 0, 0, 0, 0 };
+
+// Without profile streams keep pjsua codec defaults and are not adapted
+SipVideoAdapter::SipVideoAdapter()
+{
+	FMaxLevel = defaultLevel();
+	FLevel = FMaxLevel;
+	FBadCount = 0;
+	FGoodCount = 0;
+	FChangeTime = 0;
+	FLastTxPackets = 0;
+	FLastTxLost = 0;
+	FLossRate = 0.0;
+}
+
+int SipVideoAdapter::level() const
+{
+	return FLevel;
+}
+
+// Remote receiver reports describe how our encoded stream arrives, so decisions
+// are taken on loss of transmitted packets within sampling interval and on RTT
+bool SipVideoAdapter::processSample(const ISipMediaStats &AStats)
+{
+	quint32 sent = AStats.txPackets - qMin(FLastTxPackets,AStats.txPackets);
+	quint32 lost = AStats.txLost - qMin(FLastTxLost,AStats.txLost);
+	FLastTxPackets = AStats.txPackets;
+	FLastTxLost = AStats.txLost;
+	if (sent==0 || FLevel<0)
+		return false;
+
+	FLossRate = 100.0*lost/(sent+lost);
+	if (FLossRate>LOSS_DECREASE_PERCENT || AStats.rtt>RTT_DECREASE_USEC)
+	{
+		FBadCount++;
+		FGoodCount = 0;
+	}
+	else if (FLossRate<LOSS_INCREASE_PERCENT && AStats.rtt<RTT_INCREASE_USEC)
+	{
+		FGoodCount++;
+		FBadCount = 0;
+	}
+	else
+	{
+		FBadCount = 0;
+		FGoodCount = 0;
+	}
+
+	int newLevel = FLevel;
+	if (FBadCount>=BAD_SAMPLES_TO_DECREASE && FLevel>0)
+		newLevel = FLevel-1;
+	else if (FGoodCount>=GOOD_SAMPLES_TO_INCREASE && FLevel<FMaxLevel)
+		newLevel = FLevel+1;
+
+	if (newLevel!=FLevel && AStats.timestamp-FChangeTime>=MIN_CHANGE_INTERVAL)
+	{
+		LOG_INFO(QString("Video level changed from %1 to %2, loss=%3%, rtt=%4us").arg(FLevel).arg(newLevel).arg(FLossRate,0,'f',1).arg(AStats.rtt));
+		FLevel = newLevel;
+		FBadCount = 0;
+		FGoodCount = 0;
+		FChangeTime = AStats.timestamp;
+		return true;
+	}
+	return false;
+}
+
+void SipVideoAdapter::fillStats(ISipMediaStats &AStats) const
+{
+	if (FLevel < 0)
+		return;
+
+	SipVideoLevel vl = videoLevel(FLevel);
+	AStats.adaptLevel = FLevel;
+	AStats.adaptLossRate = FLossRate;
+	AStats.targetWidth = vl.width;
+	AStats.targetHeight = vl.height;
+	AStats.targetFps = vl.fps;
+	AStats.targetBitrate = vl.bitrate;
+}
+
+int SipVideoAdapter::levelCount()
+{
+	return PJ_ARRAY_SIZE(VideoLevels);
+}
+
+// Returns -1 until profile is set, pjsua codec defaults are used meanwhile
+int SipVideoAdapter::defaultLevel()
+{
+	return FProfileLevel;
+}
+
+SipVideoLevel SipVideoAdapter::videoLevel(int ALevel)
+{
+	return videoLevel(ALevel,FProfileCaps);
+}
+
+SipVideoLevel SipVideoAdapter::videoLevel(int ALevel, const SipVideoLevel &ACaps)
+{
+	SipVideoLevel vl = VideoLevels[qBound(0,ALevel,levelCount()-1)];
+	if (ACaps.width>0 && ACaps.height>0 && (vl.width>ACaps.width || vl.height>ACaps.height))
+	{
+		vl.width = ACaps.width;
+		vl.height = ACaps.height;
+	}
+	if (ACaps.fps > 0)
+		vl.fps = qMin(vl.fps,ACaps.fps);
+	if (ACaps.bitrate > 0)
+		vl.bitrate = qMin(vl.bitrate,ACaps.bitrate);
+	return vl;
+}
+
+int SipVideoAdapter::levelByName(const QString &AName)
+{
+	for (int level=0; level<levelCount(); level++)
+		if (AName == VideoLevelNames[level])
+			return level;
+	return -1;
+}
+
+void SipVideoAdapter::setProfile(int ALevel, const SipVideoLevel &ACaps)
+{
+	FProfileLevel = ALevel>=0 ? qMin(ALevel,levelCount()-1) : -1;
+	FProfileCaps = ACaps;
+}
+
+void SipVideoAdapter::applyCodecParams(const SipVideoLevel &ALevel)
+{
+	pjsua_codec_info codecs[32];
+	unsigned count = PJ_ARRAY_SIZE(codecs);
+	if (pjsua_vid_enum_codecs(codecs,&count) == PJ_SUCCESS)
+	{
+		for (unsigned i=0; i<count; i++)
+		{
+			pjmedia_vid_codec_param param;
+			if (pjsua_vid_codec_get_param(&codecs[i].codec_id,&param) == PJ_SUCCESS)
+			{
+				param.enc_fmt.det.vid.size.w = ALevel.width;
+				param.enc_fmt.det.vid.size.h = ALevel.height;
+				param.enc_fmt.det.vid.fps.num = ALevel.fps;
+				param.enc_fmt.det.vid.fps.denum = 1;
+				param.enc_fmt.det.vid.avg_bps = ALevel.bitrate;
+				param.enc_fmt.det.vid.max_bps = ALevel.bitrate;
+				pjsua_vid_codec_set_param(&codecs[i].codec_id,&param);
+			}
+		}
+	}
+}
+
+bool SipVideoAdapter::isStreamParamsSupported()
+{
+#if PJ_VERSION_NUM >= 0x02070000
+	return true;
+#else
+	return false;
+#endif
+}
+
+// Running encoder of a single stream is modified in place, so neither other calls
+// nor codec defaults for new calls are affected and no renegotiation is required
+pj_status_t SipVideoAdapter::applyStreamParams(pjsua_call_id ACallIndex, int AMediaIndex, const SipVideoLevel &ALevel)
+{
+#if PJ_VERSION_NUM >= 0x02070000
+	pj_status_t status = PJ_ENOTFOUND;
+	PJSUA_LOCK();
+	if (ACallIndex>=0 && ACallIndex<(int)pjsua_var.ua_cfg.max_calls && AMediaIndex>=0 && AMediaIndex<(int)pjsua_var.calls[ACallIndex].med_cnt)
+	{
+		pjsua_call_media *media = &pjsua_var.calls[ACallIndex].media[AMediaIndex];
+		pjmedia_vid_stream_info si;
+		if (media->type==PJMEDIA_TYPE_VIDEO && media->strm.v.stream!=NULL && pjmedia_vid_stream_get_info(media->strm.v.stream,&si)==PJ_SUCCESS && si.codec_param!=NULL)
+		{
+			pjmedia_vid_codec_param param = *si.codec_param;
+			param.enc_fmt.det.vid.size.w = ALevel.width;
+			param.enc_fmt.det.vid.size.h = ALevel.height;
+			param.enc_fmt.det.vid.fps.num = ALevel.fps;
+			param.enc_fmt.det.vid.fps.denum = 1;
+			param.enc_fmt.det.vid.avg_bps = ALevel.bitrate;
+			param.enc_fmt.det.vid.max_bps = ALevel.bitrate;
+			status = pjmedia_vid_stream_modify_codec_param(media->strm.v.stream,&param);
+		}
+	}
+	PJSUA_UNLOCK();
+	return status;
+#else
+	Q_UNUSED(ACallIndex);
+	Q_UNUSED(AMediaIndex);
+	Q_UNUSED(ALevel);
+	return PJ_ENOTSUP;
+#endif
+}
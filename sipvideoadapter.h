@@ -0,0 +1,46 @@
+#ifndef SIPVIDEOADAPTER_H
+#define SIPVIDEOADAPTER_H
+
+#include <pjsua.h>
+#include <interfaces/isipphone.h>
+
+struct SipVideoLevel
+{
+	quint16 width;
+	quint16 height;
+	quint8 fps;
+	quint32 bitrate;
+};
+
+class SipVideoAdapter
+{
+public:
+	SipVideoAdapter();
+	int level() const;
+	bool processSample(const ISipMediaStats &AStats);
+	void fillStats(ISipMediaStats &AStats) const;
+public:
+	static int levelCount();
+	static int defaultLevel();
+	static SipVideoLevel videoLevel(int ALevel);
+	static SipVideoLevel videoLevel(int ALevel, const SipVideoLevel &ACaps);
+	static int levelByName(const QString &AName);
+	static void setProfile(int ALevel, const SipVideoLevel &ACaps);
+	static void applyCodecParams(const SipVideoLevel &ALevel);
+	static bool isStreamParamsSupported();
+	static pj_status_t applyStreamParams(pjsua_call_id ACallIndex, int AMediaIndex, const SipVideoLevel &ALevel);
+private:
+	int FLevel;
+	int FMaxLevel;
+	int FBadCount;
+	int FGoodCount;
+	qint64 FChangeTime;
+	quint32 FLastTxPackets;
+	quint32 FLastTxLost;
+	float FLossRate;
+private:
+	static int FProfileLevel;
+	static SipVideoLevel FProfileCaps;
+};
+
+#endif // SIPVIDEOADAPTER_H
@@ -1,253 +1,574 @@
-#include "sipworker.h"
-
-#include <QMetaType>
-#include <QMetaObject>
-
-// SipTask
-quint32 SipTask::FTaskCount = 0;
-SipTask::SipTask(Type AType)
-{
-	FType = AType;
-	FStatus = -1;
-	FTaskId = QString("SipTask_%1").arg(++FTaskCount);
-
-	setAutoDelete(false);
-}
-
-SipTask::~SipTask()
-{
-
-}
-
-SipTask::Type SipTask::type() const
-{
-	return FType;
-}
-
-QString SipTask::taskId() const
-{
-	return FTaskId;
-}
-
-pj_status_t SipTask::status() const
-{
-	return FStatus;
-}
-
-// SipTaskCreateStack
-SipTaskCreateStack::SipTaskCreateStack(const Params &AParams) : SipTask(CreateStack)
-{
-	FParams = AParams;
-}
-
-void SipTaskCreateStack::run()
-{
-	FStatus = pjsua_create();
-	if (FStatus == PJ_SUCCESS)
-	{
-		// PJSUA Configuration
-		pjsua_config uc;
-		pjsua_config_default(&uc);
-
-		QByteArray stun = FParams.stun.toLocal8Bit();
-		if (!stun.isEmpty())
-		{
-			uc.stun_srv_cnt = 1;
-			uc.stun_srv[0] = pj_str(stun.data());
-		}
-
-		QByteArray userAgent = FParams.userAgent.toLocal8Bit();
-		uc.user_agent = pj_str(userAgent.data());
-
-		uc.cb = FParams.callBack;
-
-		// PJSUA Logging Configuration
-		pjsua_logging_config lc;
-		pjsua_logging_config_default(&lc);
-		QByteArray logFileName = FParams.logFileName.toLocal8Bit();
-		lc.log_filename = pj_str(logFileName.data());
-		lc.msg_logging = PJ_TRUE;
-
-		// PJSUA Media Configuration
-		pjsua_media_config mc;
-		pjsua_media_config_default(&mc);
-		mc.enable_ice = FParams.enableIce ? PJ_TRUE : PJ_FALSE;
-
-		FStatus = pjsua_init(&uc, &lc, &mc);
-		if (FStatus == PJ_SUCCESS)
-		{
-			pjsua_transport_id uid,tid;
-			pjsua_transport_config utc,ttc;
-
-			pjsua_transport_config_default(&utc);
-			pjsua_transport_config_default(&ttc);
-
-			utc.port = FParams.udpPort;
-			pj_status_t status_udp = pjsua_transport_create(PJSIP_TRANSPORT_UDP, &utc, &uid);
-			if (status_udp!=PJ_SUCCESS && utc.port!=0)
-			{
-				utc.port = 0;
-				status_udp = pjsua_transport_create(PJSIP_TRANSPORT_UDP, &utc, &uid);
-			}
-
-			ttc.port = FParams.tcpPort;
-			pj_status_t status_tcp = pjsua_transport_create(PJSIP_TRANSPORT_TCP, &ttc, &tid);
-			if (status_tcp!=PJ_SUCCESS && ttc.port!=0)
-			{
-				ttc.port = 0;
-				status_tcp = pjsua_transport_create(PJSIP_TRANSPORT_TCP, &ttc, &tid);
-			}
-
-			FStatus = status_udp!=PJ_SUCCESS ? status_udp : status_tcp;
-
-			if (FStatus == PJ_SUCCESS)
-			{
-				FStatus = pjmedia_vid_register_factory(FParams.vdf,NULL);
-				if (FStatus == PJ_SUCCESS)
-				{
-					FStatus = pjsua_start();
-					if (FStatus == PJ_SUCCESS)
-						pjsua_dump(PJ_FALSE);
-				}
-			}
-		}
-
-		if (FStatus != PJ_SUCCESS)
-			pjsua_destroy();
-	}
-}
-
-// SipTaskDestroyStack
-SipTaskDestroyStack::SipTaskDestroyStack() : SipTask(DestroyStack)
-{
-
-}
-
-void SipTaskDestroyStack::run()
-{
-	FStatus = pjsua_destroy();
-}
-
-// SipTaskStartPreview
-SipTaskStartPreview::SipTaskStartPreview(int ACapDev, int ARendDev) : SipTask(StartPreview)
-{
-	FCapDev = ACapDev;
-	FRendDev = ARendDev;
-
-	FWindow = NULL;
-	FWindowType = PJMEDIA_VID_DEV_HWND_TYPE_NONE;
-}
-
-int SipTaskStartPreview::captureDev() const
-{
-	return FCapDev;
-}
-
-int SipTaskStartPreview::renderDev() const
-{
-	return FRendDev;
-}
-
-void *SipTaskStartPreview::window() const
-{
-	return FWindow;
-}
-
-int SipTaskStartPreview::windowType() const
-{
-	return FWindowType;
-}
-
-void SipTaskStartPreview::run()
-{
-	pjsua_vid_preview_param pp;
-	pjsua_vid_preview_param_default(&pp);
-	pp.show = PJ_FALSE;
-	pp.rend_id = FRendDev;
-
-	FStatus = pjsua_vid_preview_start(FCapDev,&pp);
-	if (FStatus == PJ_SUCCESS)
-	{
-		pjsua_vid_win_info wi;
-		FStatus = pjsua_vid_win_get_info(pjsua_vid_preview_get_win(FCapDev),&wi);
-		if (FStatus == PJ_SUCCESS)
-		{
-			FWindow = wi.hwnd.info.window;
-			FWindowType = wi.hwnd.type;
-		}
-		else
-		{
-			pjsua_vid_preview_stop(FCapDev);
-		}
-	}
-}
-
-
-// SipTaskStopPreview
-SipTaskStopPreview::SipTaskStopPreview(int ACapDev) : SipTask(StopPreview)
-{
-	FCapDev = ACapDev;
-}
-
-int SipTaskStopPreview::captureDev() const
-{
-	return FCapDev;
-}
-
-void SipTaskStopPreview::run()
-{
-	FStatus = pjsua_vid_preview_stop(FCapDev);
-}
-
-// SipWorker
-SipWorker::SipWorker(QObject *AParent) : QThread(AParent)
-{
-	FQuit = false;
-	qRegisterMetaType<SipTask *>("SipTask *");
-	start();
-}
-
-SipWorker::~SipWorker()
-{
-	quit();
-	wait();
-}
-
-bool SipWorker::startTask(SipTask *ATask)
-{
-	QMutexLocker locker(&FMutex);
-	if (!FQuit)
-	{
-		FTasks.enqueue(ATask);
-		FTaskReady.wakeAll();
-		return true;
-	}
-	return false;
-}
-
-void SipWorker::quit()
-{
-	QMutexLocker locker(&FMutex);
-	FQuit = true;
-	FTaskReady.wakeAll();
-}
-
-void SipWorker::run()
-{
-	QMutexLocker locker(&FMutex);
-	while (!FQuit || !FTasks.isEmpty())
-	{
-		SipTask *task = !FTasks.isEmpty() ? FTasks.dequeue() : NULL;
-		if (task)
-		{
-			locker.unlock();
-			task->run();
-			QMetaObject::invokeMethod(this,"taskFinished",Qt::QueuedConnection,Q_ARG(SipTask *,task));
-			locker.relock();
-		}
-		else
-		{
-			FTaskReady.wait(locker.mutex());
-		}
-	}
-}
+#include "sipworker.h"
+
+#include <QMetaType>
+#include <QMetaObject>
+#include <QVector>
+#include <QElapsedTimer>
+#include "sipvideoadapter.h"
+#include "sipaudiodevice.h"
+#include "sipbridgebypass.h"
+
+#define BENCHMARK_FRAMES          30
+#define BENCHMARK_CPU_BUDGET      500000   // usec of encoding per second of video
+#define EC_BENCHMARK_FRAMES       100
+#define EC_CPU_BUDGET_PERCENT     25       // of frame time spent in echo canceller
+
+struct SipLatencyProfile
+{
+	const char *name;
+	unsigned recLatency;    // msec
+	unsigned playLatency;   // msec
+	unsigned framePtime;    // msec
+	int jbInit;             // msec, -1 for pjsua default
+	int jbMinPre;
+	int jbMaxPre;
+	int jbMax;
+};
+
+static const SipLatencyProfile LatencyProfiles[] = {
+	{ "low-latency", 40,  60,  10, 20,  10, 60,  200  },
+	{ "robust",      150, 200, 20, 100, 60, 240, 1000 }
+};
+
+// SipTask
+quint32 SipTask::FTaskCount = 0;
+SipTask::SipTask(Type AType)
+{
+	FType = AType;
+	FStatus = -1;
+	FTaskId = QString("SipTask_%1").arg(++FTaskCount);
+
+	setAutoDelete(false);
+}
+
+SipTask::~SipTask()
+{
+
+}
+
+SipTask::Type SipTask::type() const
+{
+	return FType;
+}
+
+QString SipTask::taskId() const
+{
+	return FTaskId;
+}
+
+pj_status_t SipTask::status() const
+{
+	return FStatus;
+}
+
+// SipTaskCreateStack
+SipTaskCreateStack::SipTaskCreateStack(const Params &AParams) : SipTask(CreateStack)
+{
+	FParams = AParams;
+}
+
+void SipTaskCreateStack::run()
+{
+	FStatus = pjsua_create();
+	if (FStatus == PJ_SUCCESS)
+	{
+		// PJSUA Configuration
+		pjsua_config uc;
+		pjsua_config_default(&uc);
+
+		QByteArray stun = FParams.stun.toLocal8Bit();
+		if (!stun.isEmpty())
+		{
+			uc.stun_srv_cnt = 1;
+			uc.stun_srv[0] = pj_str(stun.data());
+		}
+
+		QByteArray userAgent = FParams.userAgent.toLocal8Bit();
+		uc.user_agent = pj_str(userAgent.data());
+
+		uc.cb = FParams.callBack;
+		uc.thread_cnt = qMax(FParams.sipThreads,1U);
+		if (FParams.maxCalls > 0)
+			uc.max_calls = FParams.maxCalls;
+
+		// PJSUA Logging Configuration
+		pjsua_logging_config lc;
+		pjsua_logging_config_default(&lc);
+		QByteArray logFileName = FParams.logFileName.toLocal8Bit();
+		lc.log_filename = pj_str(logFileName.data());
+		lc.msg_logging = PJ_TRUE;
+
+		// PJSUA Media Configuration
+		pjsua_media_config mc;
+		pjsua_media_config_default(&mc);
+		mc.enable_ice = FParams.enableIce ? PJ_TRUE : PJ_FALSE;
+		mc.has_ioqueue = FParams.mediaIoqueue ? PJ_TRUE : PJ_FALSE;
+		mc.thread_cnt = qMax(FParams.mediaThreads,1U);
+		// Each call may hold an audio port and a tone generator port in conference bridge
+		mc.max_media_ports = qMax(mc.max_media_ports,uc.max_calls*2+4);
+		if (FParams.clockRate > 0)
+			mc.clock_rate = FParams.clockRate;
+		mc.no_vad = FParams.audioVad ? PJ_FALSE : PJ_TRUE;
+		mc.ec_tail_len = FParams.ecTailLen;
+		mc.ec_options = FParams.ecOptions;
+		mc.snd_auto_close_time = FParams.sndAutoCloseTime;
+		if (FParams.audioPtime > 0)
+			mc.ptime = FParams.audioPtime;
+
+		// Unknown profile names keep pjsua defaults
+		for (unsigned i=0; i<PJ_ARRAY_SIZE(LatencyProfiles); i++)
+		{
+			const SipLatencyProfile &lp = LatencyProfiles[i];
+			if (FParams.latencyProfile == lp.name)
+			{
+				mc.snd_rec_latency = lp.recLatency;
+				mc.snd_play_latency = lp.playLatency;
+				mc.audio_frame_ptime = lp.framePtime;
+				mc.jb_init = lp.jbInit;
+				mc.jb_min_pre = lp.jbMinPre;
+				mc.jb_max_pre = lp.jbMaxPre;
+				mc.jb_max = lp.jbMax;
+			}
+		}
+
+		FStatus = pjsua_init(&uc, &lc, &mc);
+		if (FStatus == PJ_SUCCESS)
+		{
+			pjsua_transport_id uid,tid;
+			pjsua_transport_config utc,ttc;
+
+			pjsua_transport_config_default(&utc);
+			pjsua_transport_config_default(&ttc);
+
+			utc.port = FParams.udpPort;
+			pj_status_t status_udp = pjsua_transport_create(PJSIP_TRANSPORT_UDP, &utc, &uid);
+			if (status_udp!=PJ_SUCCESS && utc.port!=0)
+			{
+				utc.port = 0;
+				status_udp = pjsua_transport_create(PJSIP_TRANSPORT_UDP, &utc, &uid);
+			}
+
+			ttc.port = FParams.tcpPort;
+			pj_status_t status_tcp = pjsua_transport_create(PJSIP_TRANSPORT_TCP, &ttc, &tid);
+			if (status_tcp!=PJ_SUCCESS && ttc.port!=0)
+			{
+				ttc.port = 0;
+				status_tcp = pjsua_transport_create(PJSIP_TRANSPORT_TCP, &ttc, &tid);
+			}
+
+			FStatus = status_udp!=PJ_SUCCESS ? status_udp : status_tcp;
+
+			if (FStatus == PJ_SUCCESS)
+			{
+				FStatus = pjmedia_vid_register_factory(FParams.vdf,NULL);
+				if (FStatus == PJ_SUCCESS)
+				{
+					FStatus = pjsua_start();
+					if (FStatus == PJ_SUCCESS)
+						pjsua_dump(PJ_FALSE);
+				}
+			}
+		}
+
+		if (FStatus != PJ_SUCCESS)
+			pjsua_destroy();
+	}
+}
+
+// SipTaskDestroyStack
+SipTaskDestroyStack::SipTaskDestroyStack() : SipTask(DestroyStack)
+{
+
+}
+
+void SipTaskDestroyStack::run()
+{
+	FStatus = pjsua_destroy();
+}
+
+// SipTaskStartPreview
+SipTaskStartPreview::SipTaskStartPreview(int ACapDev, int ARendDev) : SipTask(StartPreview)
+{
+	FCapDev = ACapDev;
+	FRendDev = ARendDev;
+
+	FWindow = NULL;
+	FWindowType = PJMEDIA_VID_DEV_HWND_TYPE_NONE;
+}
+
+int SipTaskStartPreview::captureDev() const
+{
+	return FCapDev;
+}
+
+int SipTaskStartPreview::renderDev() const
+{
+	return FRendDev;
+}
+
+void *SipTaskStartPreview::window() const
+{
+	return FWindow;
+}
+
+int SipTaskStartPreview::windowType() const
+{
+	return FWindowType;
+}
+
+void SipTaskStartPreview::run()
+{
+	pjsua_vid_preview_param pp;
+	pjsua_vid_preview_param_default(&pp);
+	pp.show = PJ_FALSE;
+	pp.rend_id = FRendDev;
+
+	FStatus = pjsua_vid_preview_start(FCapDev,&pp);
+	if (FStatus == PJ_SUCCESS)
+	{
+		pjsua_vid_win_info wi;
+		FStatus = pjsua_vid_win_get_info(pjsua_vid_preview_get_win(FCapDev),&wi);
+		if (FStatus == PJ_SUCCESS)
+		{
+			FWindow = wi.hwnd.info.window;
+			FWindowType = wi.hwnd.type;
+		}
+		else
+		{
+			pjsua_vid_preview_stop(FCapDev);
+		}
+	}
+}
+
+
+// SipTaskStopPreview
+SipTaskStopPreview::SipTaskStopPreview(int ACapDev) : SipTask(StopPreview)
+{
+	FCapDev = ACapDev;
+}
+
+int SipTaskStopPreview::captureDev() const
+{
+	return FCapDev;
+}
+
+void SipTaskStopPreview::run()
+{
+	FStatus = pjsua_vid_preview_stop(FCapDev);
+}
+
+// SipTaskVideoBenchmark
+SipTaskVideoBenchmark::SipTaskVideoBenchmark(const QString &ACodecId, int AConcurrentCalls, const SipVideoLevel &ACaps) : SipTask(VideoBenchmark)
+{
+	FLevel = 0;
+	FCodecId = ACodecId;
+	FConcurrentCalls = qMax(AConcurrentCalls,1);
+	FCaps = ACaps;
+}
+
+QString SipTaskVideoBenchmark::codecId() const
+{
+	return FCodecId;
+}
+
+int SipTaskVideoBenchmark::concurrentCalls() const
+{
+	return FConcurrentCalls;
+}
+
+int SipTaskVideoBenchmark::level() const
+{
+	return FLevel;
+}
+
+void SipTaskVideoBenchmark::run()
+{
+	QByteArray codecId = FCodecId.toLatin1();
+	pj_str_t id = pj_str(codecId.data());
+
+	unsigned count = 1;
+	const pjmedia_vid_codec_info *info = NULL;
+	FStatus = pjmedia_vid_codec_mgr_find_codecs_by_id(NULL,&id,&count,&info,NULL);
+	if (FStatus==PJ_SUCCESS && count>0)
+	{
+		pj_pool_t *pool = pjsua_pool_create("video-benchmark",4096,4096);
+
+		// Highest level whose encoding fits CPU budget for all concurrent calls
+		bool measured = false;
+		for (FLevel=SipVideoAdapter::levelCount()-1; FLevel>0; FLevel--)
+		{
+			qint64 usecs = measureEncodeTime(info,FLevel,pool);
+			measured = measured || usecs>=0;
+			if (usecs>=0 && usecs*SipVideoAdapter::videoLevel(FLevel,FCaps).fps*FConcurrentCalls <= BENCHMARK_CPU_BUDGET)
+				break;
+		}
+		if (!measured && measureEncodeTime(info,0,pool)<0)
+			FStatus = PJ_EINVALIDOP;
+
+		pj_pool_release(pool);
+	}
+}
+
+qint64 SipTaskVideoBenchmark::measureEncodeTime(const pjmedia_vid_codec_info *AInfo, int ALevel, pj_pool_t *APool) const
+{
+	qint64 usecs = -1;
+	// Caps are copied into task, profile state is owned by GUI thread
+	SipVideoLevel vl = SipVideoAdapter::videoLevel(ALevel,FCaps);
+
+	pjmedia_vid_codec_param param;
+	pjmedia_vid_codec *codec = NULL;
+	if (pjmedia_vid_codec_mgr_get_default_param(NULL,AInfo,&param)==PJ_SUCCESS && pjmedia_vid_codec_mgr_alloc_codec(NULL,AInfo,&codec)==PJ_SUCCESS)
+	{
+		param.dir = PJMEDIA_DIR_ENCODING;
+		param.enc_fmt.det.vid.size.w = param.dec_fmt.det.vid.size.w = vl.width;
+		param.enc_fmt.det.vid.size.h = param.dec_fmt.det.vid.size.h = vl.height;
+		param.enc_fmt.det.vid.fps.num = param.dec_fmt.det.vid.fps.num = vl.fps;
+		param.enc_fmt.det.vid.fps.denum = param.dec_fmt.det.vid.fps.denum = 1;
+		param.enc_fmt.det.vid.avg_bps = param.enc_fmt.det.vid.max_bps = vl.bitrate;
+
+		if (pjmedia_vid_codec_init(codec,APool)==PJ_SUCCESS && pjmedia_vid_codec_open(codec,&param)==PJ_SUCCESS)
+		{
+			// I420 input with moving gradient to keep encoder from skipping frames
+			QByteArray input(vl.width*vl.height*3/2,0);
+			QByteArray output(vl.width*vl.height*3/2,0);
+
+			pjmedia_frame in;
+			pj_bzero(&in,sizeof(in));
+			in.type = PJMEDIA_FRAME_TYPE_VIDEO;
+			in.buf = input.data();
+			in.size = input.size();
+
+			QElapsedTimer clock;
+			clock.start();
+			for (int frame=0; frame<BENCHMARK_FRAMES; frame++)
+			{
+				char *data = input.data();
+				for (int i=0; i<vl.width*vl.height; i++)
+					data[i] = (char)(i%vl.width + frame*4);
+				in.timestamp.u64 = frame*(90000/vl.fps);
+
+				pjmedia_frame out;
+				pj_bzero(&out,sizeof(out));
+				out.buf = output.data();
+				out.size = output.size();
+
+				pj_bool_t hasMore = PJ_FALSE;
+				pj_status_t status = pjmedia_vid_codec_encode_begin(codec,NULL,&in,output.size(),&out,&hasMore);
+				while (status==PJ_SUCCESS && hasMore)
+				{
+					out.size = output.size();
+					status = pjmedia_vid_codec_encode_more(codec,output.size(),&out,&hasMore);
+				}
+				if (status != PJ_SUCCESS)
+					break;
+				if (frame == BENCHMARK_FRAMES-1)
+					usecs = clock.nsecsElapsed()/1000/BENCHMARK_FRAMES;
+			}
+			pjmedia_vid_codec_close(codec);
+		}
+		pjmedia_vid_codec_mgr_dealloc_codec(NULL,codec);
+	}
+	return usecs;
+}
+
+// SipTaskEchoBenchmark
+static const char *EchoAlgorithmNames[] = {
+	"none", "simple", "speex", "webrtc", "webrtc-aec3", "default"
+};
+
+SipTaskEchoBenchmark::SipTaskEchoBenchmark(int AAlgorithm, unsigned ATailLen, unsigned AFlags, unsigned AClockRate, unsigned AFramePtime) : SipTask(EchoBenchmark)
+{
+	FRequested = AAlgorithm;
+	FAlgorithm = EcNone;
+	FTailLen = ATailLen;
+	FFlags = AFlags;
+	FClockRate = AClockRate;
+	FFramePtime = AFramePtime;
+	FFrameCost = 0;
+}
+
+int SipTaskEchoBenchmark::requestedAlgorithm() const
+{
+	return FRequested;
+}
+
+int SipTaskEchoBenchmark::algorithm() const
+{
+	return FAlgorithm;
+}
+
+quint32 SipTaskEchoBenchmark::frameCost() const
+{
+	return FFrameCost;
+}
+
+unsigned SipTaskEchoBenchmark::frameTime() const
+{
+	return FFramePtime*1000;
+}
+
+int SipTaskEchoBenchmark::algorithmByName(const QString &AName)
+{
+	for (int i=0; i<(int)PJ_ARRAY_SIZE(EchoAlgorithmNames); i++)
+		if (AName == EchoAlgorithmNames[i])
+			return i;
+	return EcDefault;
+}
+
+QString SipTaskEchoBenchmark::algorithmName(int AAlgorithm)
+{
+	return AAlgorithm>=0 && AAlgorithm<(int)PJ_ARRAY_SIZE(EchoAlgorithmNames) ? QString(EchoAlgorithmNames[AAlgorithm]) : QString();
+}
+
+unsigned SipTaskEchoBenchmark::echoOptions(int AAlgorithm, unsigned AFlags)
+{
+	switch (AAlgorithm)
+	{
+	case EcSimple:
+		return PJMEDIA_ECHO_SIMPLE;
+	case EcSpeex:
+		return PJMEDIA_ECHO_SPEEX;
+#if PJ_VERSION_NUM >= 0x02070000
+	case EcWebRtc:
+		return PJMEDIA_ECHO_WEBRTC | AFlags;
+#endif
+#if PJ_VERSION_NUM >= 0x020D0000
+	case EcWebRtcAec3:
+		return PJMEDIA_ECHO_WEBRTC_AEC3 | AFlags;
+#endif
+	default:
+		return PJMEDIA_ECHO_DEFAULT;
+	}
+}
+
+void SipTaskEchoBenchmark::run()
+{
+	FStatus = PJ_SUCCESS;
+	pj_pool_t *pool = pjsua_pool_create("echo-benchmark",4096,4096);
+	if (pool != NULL)
+	{
+		// Cheaper algorithms are tried until one fits the per-frame CPU budget
+		FAlgorithm = FRequested;
+		while (FAlgorithm != EcNone)
+		{
+			qint64 usecs = measureFrameCost(FAlgorithm,pool);
+			if (usecs>=0 && usecs*100<=(qint64)frameTime()*EC_CPU_BUDGET_PERCENT)
+			{
+				FFrameCost = (quint32)usecs;
+				break;
+			}
+			FAlgorithm = FAlgorithm==EcDefault ? EcSimple : FAlgorithm-1;
+		}
+		pj_pool_release(pool);
+	}
+	else
+	{
+		FStatus = PJ_ENOMEM;
+	}
+}
+
+qint64 SipTaskEchoBenchmark::measureFrameCost(int AAlgorithm, pj_pool_t *APool) const
+{
+	qint64 usecs = -1;
+	unsigned samplesPerFrame = FClockRate*FFramePtime/1000;
+
+	pjmedia_echo_state *ec = NULL;
+	if (samplesPerFrame>0 && pjmedia_echo_create2(APool,FClockRate,1,samplesPerFrame,FTailLen,0,echoOptions(AAlgorithm,FFlags)|PJMEDIA_ECHO_NO_LOCK,&ec)==PJ_SUCCESS)
+	{
+		// Playback noise is fed back attenuated to keep adaptive filter busy
+		QVector<pj_int16_t> play(samplesPerFrame), rec(samplesPerFrame);
+		quint32 seed = 1;
+
+		QElapsedTimer clock;
+		clock.start();
+		for (int frame=0; frame<EC_BENCHMARK_FRAMES; frame++)
+		{
+			for (unsigned i=0; i<samplesPerFrame; i++)
+			{
+				seed = seed*1103515245 + 12345;
+				play[i] = (pj_int16_t)((seed>>16) & 0x3FFF) - 0x2000;
+				rec[i] = play[i]/4;
+			}
+			pjmedia_echo_cancel(ec,rec.data(),play.data(),0,NULL);
+		}
+		usecs = clock.nsecsElapsed()/1000/EC_BENCHMARK_FRAMES;
+
+		pjmedia_echo_destroy(ec);
+	}
+	return usecs;
+}
+
+// SipTaskWakeupSound
+SipTaskWakeupSound::SipTaskWakeupSound() : SipTask(WakeupSound)
+{
+
+}
+
+void SipTaskWakeupSound::run()
+{
+	FStatus = SipAudioDevice::wakeup();
+}
+
+// SipTaskBridgeBypass
+SipTaskBridgeBypass::SipTaskBridgeBypass() : SipTask(BridgeBypass)
+{
+
+}
+
+void SipTaskBridgeBypass::run()
+{
+	FStatus = SipBridgeBypass::update();
+}
+
+// SipWorker
+SipWorker::SipWorker(QObject *AParent) : QThread(AParent)
+{
+	FQuit = false;
+	qRegisterMetaType<SipTask *>("SipTask *");
+	start();
+}
+
+SipWorker::~SipWorker()
+{
+	quit();
+	wait();
+}
+
+bool SipWorker::startTask(SipTask *ATask)
+{
+	QMutexLocker locker(&FMutex);
+	if (!FQuit)
+	{
+		FTasks.enqueue(ATask);
+		FTaskReady.wakeAll();
+		return true;
+	}
+	return false;
+}
+
+void SipWorker::quit()
+{
+	QMutexLocker locker(&FMutex);
+	FQuit = true;
+	FTaskReady.wakeAll();
+}
+
+void SipWorker::run()
+{
+	QMutexLocker locker(&FMutex);
+	while (!FQuit || !FTasks.isEmpty())
+	{
+		SipTask *task = !FTasks.isEmpty() ? FTasks.dequeue() : NULL;
+		if (task)
+		{
+			locker.unlock();
+			task->run();
+			QMetaObject::invokeMethod(this,"taskFinished",Qt::QueuedConnection,Q_ARG(SipTask *,task));
+			locker.relock();
+		}
+		else
+		{
+			FTaskReady.wait(locker.mutex());
+		}
+	}
+}
@@ -1,118 +1,204 @@
-#ifndef SIPWORKER_H
-#define SIPWORKER_H
-
-#include <QQueue>
-#include <QMutex>
-#include <QThread>
-#include <QRunnable>
-#include <QWaitCondition>
-#include <interfaces/isipphone.h>
-#include <pjsua.h>
-
-class SipTask :
-	public QRunnable
-{
-	friend class SipWorker;
-public:
-	enum Type {
-		CreateStack,
-		DestroyStack,
-		StartPreview,
-		StopPreview,
-	};
-public:
-	SipTask(Type AType);
-	virtual ~SipTask();
-	Type type() const;
-	QString taskId() const;
-	pj_status_t status() const;
-protected:
-	Type FType;
-	QString FTaskId;
-	pj_status_t FStatus;
-private:
-	static quint32 FTaskCount;
-};
-
-class SipTaskCreateStack :
-	public SipTask
-{
-public:
-	struct Params {
-		QString stun;
-		bool enableIce;
-		quint16 udpPort;
-		quint16 tcpPort;
-		QString userAgent;
-		QString logFileName;
-		pjsua_callback callBack;
-		pjmedia_vid_dev_factory_create_func_ptr vdf;
-	};
-	SipTaskCreateStack(const Params &AParams);
-protected:
-	void run();
-private:
-	Params FParams;
-};
-
-class SipTaskDestroyStack :
-	public SipTask
-{
-public:
-	SipTaskDestroyStack();
-protected:
-	void run();
-};
-
-class SipTaskStartPreview :
-	public SipTask
-{
-public:
-	SipTaskStartPreview(int ACapDev, int ARendDev);
-	int captureDev() const;
-	int renderDev() const;
-	void *window() const;
-	int windowType() const;
-protected:
-	void run();
-private:
-	int FCapDev;
-	int FRendDev;
-	void *FWindow;
-	int FWindowType;
-};
-
-class SipTaskStopPreview :
-	public SipTask
-{
-public:
-	SipTaskStopPreview(int ACapDev);
-	int captureDev() const;
-protected:
-	void run();
-private:
-	int FCapDev;
-};
-
-class SipWorker : 
-	public QThread
-{
-	Q_OBJECT;
-public:
-	SipWorker(QObject *AParent);
-	~SipWorker();
-	bool startTask(SipTask *ATask);
-public slots:
-	void quit();
-signals:
-	void taskFinished(SipTask *ATask);
-protected:
-	void run();
-private:
-	bool FQuit;
-	QMutex FMutex;
-	QWaitCondition FTaskReady;
-	QQueue<SipTask *> FTasks;
-};
-
-#endif // SIPWORKER_H
+#ifndef SIPWORKER_H
+#define SIPWORKER_H
+
+#include <QQueue>
+#include <QMutex>
+#include <QThread>
+#include <QRunnable>
+#include <QWaitCondition>
+#include <interfaces/isipphone.h>
+#include <pjsua.h>
+#include "sipvideoadapter.h"
+
+class SipTask :
+	public QRunnable
+{
+	friend class SipWorker;
+public:
+	enum Type {
+		CreateStack,
+		DestroyStack,
+		StartPreview,
+		StopPreview,
+		VideoBenchmark,
+		EchoBenchmark,
+		WakeupSound,
+		BridgeBypass,
+	};
+public:
+	SipTask(Type AType);
+	virtual ~SipTask();
+	Type type() const;
+	QString taskId() const;
+	pj_status_t status() const;
+protected:
+	Type FType;
+	QString FTaskId;
+	pj_status_t FStatus;
+private:
+	static quint32 FTaskCount;
+};
+
+class SipTaskCreateStack :
+	public SipTask
+{
+public:
+	struct Params {
+		QString stun;
+		bool enableIce;
+		quint16 udpPort;
+		quint16 tcpPort;
+		QString userAgent;
+		QString logFileName;
+		unsigned maxCalls;
+		unsigned sipThreads;
+		unsigned mediaThreads;
+		bool mediaIoqueue;
+		unsigned clockRate;
+		int sndAutoCloseTime;
+		QString latencyProfile;
+		unsigned ecTailLen;
+		unsigned ecOptions;
+		unsigned audioPtime;
+		bool audioVad;
+		pjsua_callback callBack;
+		pjmedia_vid_dev_factory_create_func_ptr vdf;
+	};
+	SipTaskCreateStack(const Params &AParams);
+protected:
+	void run();
+private:
+	Params FParams;
+};
+
+class SipTaskDestroyStack :
+	public SipTask
+{
+public:
+	SipTaskDestroyStack();
+protected:
+	void run();
+};
+
+class SipTaskStartPreview :
+	public SipTask
+{
+public:
+	SipTaskStartPreview(int ACapDev, int ARendDev);
+	int captureDev() const;
+	int renderDev() const;
+	void *window() const;
+	int windowType() const;
+protected:
+	void run();
+private:
+	int FCapDev;
+	int FRendDev;
+	void *FWindow;
+	int FWindowType;
+};
+
+class SipTaskStopPreview :
+	public SipTask
+{
+public:
+	SipTaskStopPreview(int ACapDev);
+	int captureDev() const;
+protected:
+	void run();
+private:
+	int FCapDev;
+};
+
+class SipTaskVideoBenchmark :
+	public SipTask
+{
+public:
+	SipTaskVideoBenchmark(const QString &ACodecId, int AConcurrentCalls, const SipVideoLevel &ACaps);
+	QString codecId() const;
+	int concurrentCalls() const;
+	int level() const;
+protected:
+	void run();
+	qint64 measureEncodeTime(const pjmedia_vid_codec_info *AInfo, int ALevel, pj_pool_t *APool) const;
+private:
+	int FLevel;
+	QString FCodecId;
+	int FConcurrentCalls;
+	SipVideoLevel FCaps;
+};
+
+class SipTaskEchoBenchmark :
+	public SipTask
+{
+public:
+	enum Algorithm {
+		EcNone,
+		EcSimple,
+		EcSpeex,
+		EcWebRtc,
+		EcWebRtcAec3,
+		EcDefault
+	};
+	SipTaskEchoBenchmark(int AAlgorithm, unsigned ATailLen, unsigned AFlags, unsigned AClockRate, unsigned AFramePtime);
+	int requestedAlgorithm() const;
+	int algorithm() const;
+	quint32 frameCost() const;
+	unsigned frameTime() const;
+public:
+	static int algorithmByName(const QString &AName);
+	static QString algorithmName(int AAlgorithm);
+	static unsigned echoOptions(int AAlgorithm, unsigned AFlags);
+protected:
+	void run();
+	qint64 measureFrameCost(int AAlgorithm, pj_pool_t *APool) const;
+private:
+	int FRequested;
+	int FAlgorithm;
+	unsigned FTailLen;
+	unsigned FFlags;
+	unsigned FClockRate;
+	unsigned FFramePtime;
+	quint32 FFrameCost;
+};
+
+class SipTaskWakeupSound :
+	public SipTask
+{
+public:
+	SipTaskWakeupSound();
+protected:
+	void run();
+};
+
+class SipTaskBridgeBypass :
+	public SipTask
+{
+public:
+	SipTaskBridgeBypass();
+protected:
+	void run();
+};
+
+class SipWorker : 
+	public QThread
+{
+	Q_OBJECT;
+public:
+	SipWorker(QObject *AParent);
+	~SipWorker();
+	bool startTask(SipTask *ATask);
+public slots:
+	void quit();
+signals:
+	void taskFinished(SipTask *ATask);
+protected:
+	void run();
+private:
+	bool FQuit;
+	QMutex FMutex;
+	QWaitCondition FTaskReady;
+	QQueue<SipTask *> FTasks;
+};
+
+#endif // SIPWORKER_H